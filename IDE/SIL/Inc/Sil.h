@@ -0,0 +1,86 @@
+/**
+******************************************************************************
+* @file    /IDE/SIL/Inc/Sil.h
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Software-in-the-loop (SIL) build. The application in /Src runs on Linux against a stub HAL.
+*          Time is virtual: it only advances when the application waits for an interrupt (__WFI), so a
+*          simulated hour completes in seconds. Code executes in zero virtual time.
+******************************************************************************
+*/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIL_H
+#define __SIL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "stm32f4xx_hal.h"
+
+#define SIL_CPU_FREQ         180000000ULL
+#define SIL_PCLK1_FREQ        45000000ULL
+#define SIL_PCLK2_FREQ        90000000ULL
+#define SIL_APB1_TIMER_FREQ   90000000ULL
+#define SIL_CYCLES_PER_MS    (SIL_CPU_FREQ / 1000ULL)
+#define SIL_US_TO_CYCLES(Us) ((uint64_t)(Us) * (SIL_CPU_FREQ / 1000000ULL))
+
+#define SIL_NUM_EVENTS  32
+
+typedef void (*Sil_EventFunc)(void *Arg);
+
+typedef struct
+{
+  uint64_t Time;               // Virtual time (CPU cycles) when the event fires
+  Sil_EventFunc Func;
+  void *Arg;
+  uint8_t Active;
+} Sil_Event;
+
+typedef struct
+{
+  uint64_t EndTime;            // Simulation stops when virtual time reaches this (CPU cycles)
+  int Verbose;                 // Echo terminal output on stdout
+  const char *TerminalFile;    // If set, all terminal output (USART3 Tx) is written to this file
+  const char *TerminalInput;   // If set, the lines of this file are typed on the terminal (USART3 Rx)
+  uint32_t ModbusPeriodMs;     // Time between Modbus requests, 0 = back to back
+  int ModbusRateSweep;         // Step the slave through its baud rates (FC 6) and measure the requests per second at each
+  int ModbusScript;            // First send requests of all function codes and check the responses
+  int IsrProfile;              // Measure the host time of each interrupt handler, entry to exit
+} Sil_Config;
+
+extern Sil_Config SilConfig;
+
+// ------ Sil_Hal.c ------
+void     Sil_InitMemory(void);
+uint64_t Sil_Now(void);
+int      Sil_ScheduleEvent(uint64_t Time, Sil_EventFunc Func, void *Arg);
+void     Sil_CancelEvent(int Handle);
+void     Sil_PendIrq(IRQn_Type IRQn);
+void    *Sil_Alias(volatile void *FirmwareAddress);   // Side effect free view of a peripheral register
+void     Sil_SetReadTrap(volatile void *Register, int Armed);   // Report reads on the page of the register
+void     Sil_FlashEraseSector(uint32_t Sector);
+void     Sil_IsrProfileReport(FILE *Out);
+
+// ------ Sil_Peripherals.c ------
+void Sil_PeripheralsInit(void);
+void Sil_PeripheralsPoll(void);
+void Sil_PeripheralsUpdateCounters(uint64_t Now);
+void Sil_RegisterRead(uintptr_t Address);
+void Sil_UartRxByte(USART_TypeDef *Usart, uint8_t Byte);
+typedef void (*Sil_UartSink)(const uint8_t *Data, uint32_t Length);
+void Sil_UartSetSink(USART_TypeDef *Usart, Sil_UartSink Sink);
+uint32_t Sil_UartBaudRate(USART_TypeDef *Usart);
+uint64_t Sil_UartCharTime(USART_TypeDef *Usart);
+void Sil_TimCapture(TIM_TypeDef *Tim, uint32_t Channel);
+void Sil_AdcSetBuffer(volatile uint16_t *Buffer, uint32_t Length);
+
+// ------ Sil_Plant.c ------
+void Sil_PlantInit(void);
+void Sil_PlantAdcUpdate(volatile uint16_t *Buffer, uint32_t Length);
+int  Sil_PlantReport(FILE *Out);
+
+// ------ Sil_Main.c ------
+void Sil_Finish(void);
+
+#endif // __SIL_H
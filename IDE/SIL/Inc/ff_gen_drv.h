@@ -0,0 +1,10 @@
+/* SIL build: USB mass storage and FatFs are not simulated, see Sil_Stubs.c */
+#ifndef __SIL_FF_GEN_DRV_H
+#define __SIL_FF_GEN_DRV_H
+
+typedef struct
+{
+  int Unused;
+} Diskio_drvTypeDef;
+
+#endif // __SIL_FF_GEN_DRV_H
@@ -0,0 +1,78 @@
+/* Host test of ModbusTcp.c: the part of the lwIP raw TCP API it uses. The pcbs and pbufs are simulated by
+   Sil_ModbusTcp.c, which records what the server writes, acknowledges and closes. */
+#ifndef __SIL_LWIP_TCP_H
+#define __SIL_LWIP_TCP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int8_t   err_t;
+typedef uint8_t  u8_t;
+typedef uint16_t u16_t;
+
+#define ERR_OK    0
+#define ERR_MEM   -1
+#define ERR_VAL   -6
+#define ERR_ABRT  -13
+
+#define TCP_WRITE_FLAG_COPY  0x01
+#define TCP_PRIO_MIN         1
+#define TCP_SND_QUEUELEN     8
+#define IP_ADDR_ANY          NULL
+
+#define LWIP_UNUSED_ARG(x)  (void)(x)
+
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  u16_t tot_len;              // This and the following pbufs of the chain
+  u16_t len;
+};
+
+struct tcp_pcb;
+typedef err_t (*tcp_accept_fn)(void *arg, struct tcp_pcb *newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *tpcb);
+typedef void  (*tcp_err_fn)(void *arg, err_t err);
+
+struct tcp_pcb {
+  u16_t snd_buf;              // Free space in the send buffer
+  u16_t snd_queuelen;
+  void *callback_arg;
+  tcp_accept_fn accept;
+  tcp_recv_fn recv;
+  tcp_sent_fn sent;
+  tcp_poll_fn poll;
+  tcp_err_fn errf;
+  uint8_t written[2048];      // Sent by tcp_write
+  u16_t written_len;
+  uint32_t recved;            // Acknowledged by tcp_recved
+  int closed;
+  int aborted;
+};
+
+#define tcp_sndbuf(pcb)       ((pcb)->snd_buf)
+#define tcp_sndqueuelen(pcb)  ((pcb)->snd_queuelen)
+
+u16_t pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset);
+u8_t  pbuf_free(struct pbuf *p);
+void  pbuf_cat(struct pbuf *head, struct pbuf *tail);
+
+struct tcp_pcb *tcp_new(void);
+err_t tcp_bind(struct tcp_pcb *pcb, const void *ipaddr, u16_t port);
+struct tcp_pcb *tcp_listen(struct tcp_pcb *pcb);
+void  tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept);
+void  tcp_arg(struct tcp_pcb *pcb, void *arg);
+void  tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void  tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+void  tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval);
+void  tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+void  tcp_setprio(struct tcp_pcb *pcb, u8_t prio);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+void  tcp_recved(struct tcp_pcb *pcb, u16_t len);
+err_t tcp_close(struct tcp_pcb *pcb);
+void  tcp_abort(struct tcp_pcb *pcb);
+
+#endif // __SIL_LWIP_TCP_H
@@ -0,0 +1,709 @@
+/**
+******************************************************************************
+* @file    /IDE/SIL/Inc/stm32f4xx_hal.h
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Stand-in for the STM32Cube HAL/CMSIS headers when the application is built for Linux (SIL).
+*          Only the subset of registers, bits, types and functions used by the application is declared.
+*          Peripherals keep their real base addresses. Sil_Hal.c maps memory at these addresses at startup,
+*          so register access, address compares and "case (uint32_t)TIM2:" work unchanged.
+******************************************************************************
+*/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SIL_STM32F4XX_HAL_H
+#define __SIL_STM32F4XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SIL
+
+#define __IO  volatile
+#define __I   volatile const
+#define __O   volatile
+
+// ------ Cortex-M4 core and interrupt numbers (STM32F429/446) ------
+typedef enum
+{
+  NonMaskableInt_IRQn   = -14,
+  MemoryManagement_IRQn = -12,
+  BusFault_IRQn         = -11,
+  UsageFault_IRQn       = -10,
+  SVCall_IRQn           = -5,
+  DebugMonitor_IRQn     = -4,
+  PendSV_IRQn           = -2,
+  SysTick_IRQn          = -1,
+  WWDG_IRQn             = 0,
+  FLASH_IRQn            = 4,
+  RCC_IRQn              = 5,
+  DMA1_Stream0_IRQn     = 11,
+  DMA1_Stream1_IRQn     = 12,
+  DMA1_Stream2_IRQn     = 13,
+  DMA1_Stream3_IRQn     = 14,
+  DMA1_Stream4_IRQn     = 15,
+  DMA1_Stream5_IRQn     = 16,
+  DMA1_Stream6_IRQn     = 17,
+  ADC_IRQn              = 18,
+  CAN1_TX_IRQn          = 19,
+  CAN1_RX0_IRQn         = 20,
+  CAN1_RX1_IRQn         = 21,
+  CAN1_SCE_IRQn         = 22,
+  TIM2_IRQn             = 28,
+  TIM3_IRQn             = 29,
+  TIM4_IRQn             = 30,
+  USART3_IRQn           = 39,
+  TIM8_UP_TIM13_IRQn    = 44,
+  TIM8_TRG_COM_TIM14_IRQn = 45,
+  DMA1_Stream7_IRQn     = 47,
+  TIM5_IRQn             = 50,
+  TIM6_DAC_IRQn         = 54,
+  TIM7_IRQn             = 55,
+  DMA2_Stream0_IRQn     = 56,
+  DMA2_Stream1_IRQn     = 57,
+  DMA2_Stream2_IRQn     = 58,
+  DMA2_Stream3_IRQn     = 59,
+  DMA2_Stream4_IRQn     = 60,
+  ETH_IRQn              = 61,
+  CAN2_TX_IRQn          = 63,
+  CAN2_RX0_IRQn         = 64,
+  CAN2_RX1_IRQn         = 65,
+  CAN2_SCE_IRQn         = 66,
+  OTG_FS_IRQn           = 67,
+  DMA2_Stream5_IRQn     = 68,
+  DMA2_Stream6_IRQn     = 69,
+  DMA2_Stream7_IRQn     = 70,
+  USART6_IRQn           = 71,
+} IRQn_Type;
+
+#define SIL_NUM_IRQ  97
+
+// ------ Peripheral register layouts ------
+typedef struct
+{
+  __IO uint32_t CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR, RCR, CCR1, CCR2, CCR3, CCR4, BDTR, DCR, DMAR, OR;
+} TIM_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t SR, DR, BRR, CR1, CR2, CR3, GTPR;
+} USART_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t CR, NDTR, PAR, M0AR, M1AR, FCR;
+} DMA_Stream_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t LISR, HISR, LIFCR, HIFCR;
+} DMA_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR, BSRR, LCKR, AFR[2];
+} GPIO_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t SR, CR1, CR2, SMPR1, SMPR2, JOFR1, JOFR2, JOFR3, JOFR4, HTR, LTR, SQR1, SQR2, SQR3, JSQR, JDR1, JDR2, JDR3, JDR4, DR;
+} ADC_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t ACR, KEYR, OPTKEYR, SR, CR, OPTCR, OPTCR1;
+} FLASH_TypeDef;
+
+typedef struct
+{
+  __IO uint32_t CR, PLLCFGR, CFGR, CIR, AHB1RSTR, AHB2RSTR, AHB3RSTR, RESERVED0, APB1RSTR, APB2RSTR, RESERVED1[2], AHB1ENR, AHB2ENR, AHB3ENR, RESERVED2, APB1ENR, APB2ENR;
+} RCC_TypeDef;
+
+typedef struct
+{
+  __I  uint32_t CPUID;
+  __IO uint32_t ICSR, VTOR, AIRCR, SCR, CCR;
+  __IO uint8_t  SHP[12];
+  __IO uint32_t SHCSR, CFSR, HFSR, DFSR, MMFAR, BFAR, AFSR;
+} SCB_Type;
+
+typedef struct
+{
+  __IO uint32_t CTRL, LOAD, VAL;
+  __I  uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct
+{
+  __IO uint32_t CTRL, CYCCNT, CPICNT, EXCCNT, SLEEPCNT, LSUCNT, FOLDCNT;
+  __I  uint32_t PCSR;
+} DWT_Type;
+
+typedef struct
+{
+  __IO uint32_t DHCSR;
+  __O  uint32_t DCRSR;
+  __IO uint32_t DCRDR, DEMCR;
+} CoreDebug_Type;
+
+// ------ Base addresses (real STM32F4 memory map) ------
+#define FLASH_BASE          0x08000000UL
+#define PERIPH_BASE         0x40000000UL
+#define APB1PERIPH_BASE     PERIPH_BASE
+#define APB2PERIPH_BASE     (PERIPH_BASE + 0x00010000UL)
+#define AHB1PERIPH_BASE     (PERIPH_BASE + 0x00020000UL)
+
+#define TIM2   ((TIM_TypeDef *)(APB1PERIPH_BASE + 0x0000UL))
+#define TIM3   ((TIM_TypeDef *)(APB1PERIPH_BASE + 0x0400UL))
+#define TIM4   ((TIM_TypeDef *)(APB1PERIPH_BASE + 0x0800UL))
+#define TIM5   ((TIM_TypeDef *)(APB1PERIPH_BASE + 0x0C00UL))
+#define TIM6   ((TIM_TypeDef *)(APB1PERIPH_BASE + 0x1000UL))
+#define TIM7   ((TIM_TypeDef *)(APB1PERIPH_BASE + 0x1400UL))
+#define TIM13  ((TIM_TypeDef *)(APB1PERIPH_BASE + 0x1C00UL))
+#define TIM14  ((TIM_TypeDef *)(APB1PERIPH_BASE + 0x2000UL))
+#define USART2 ((USART_TypeDef *)(APB1PERIPH_BASE + 0x4400UL))
+#define USART3 ((USART_TypeDef *)(APB1PERIPH_BASE + 0x4800UL))
+#define UART4  ((USART_TypeDef *)(APB1PERIPH_BASE + 0x4C00UL))
+#define UART5  ((USART_TypeDef *)(APB1PERIPH_BASE + 0x5000UL))
+#define USART1 ((USART_TypeDef *)(APB2PERIPH_BASE + 0x1000UL))
+#define USART6 ((USART_TypeDef *)(APB2PERIPH_BASE + 0x1400UL))
+#define ADC1   ((ADC_TypeDef *)(APB2PERIPH_BASE + 0x2000UL))
+
+#define GPIOA  ((GPIO_TypeDef *)(AHB1PERIPH_BASE + 0x0000UL))
+#define GPIOB  ((GPIO_TypeDef *)(AHB1PERIPH_BASE + 0x0400UL))
+#define GPIOC  ((GPIO_TypeDef *)(AHB1PERIPH_BASE + 0x0800UL))
+#define GPIOD  ((GPIO_TypeDef *)(AHB1PERIPH_BASE + 0x0C00UL))
+#define GPIOE  ((GPIO_TypeDef *)(AHB1PERIPH_BASE + 0x1000UL))
+#define GPIOF  ((GPIO_TypeDef *)(AHB1PERIPH_BASE + 0x1400UL))
+#define GPIOG  ((GPIO_TypeDef *)(AHB1PERIPH_BASE + 0x1800UL))
+#define RCC    ((RCC_TypeDef *)(AHB1PERIPH_BASE + 0x3800UL))
+#define FLASH  ((FLASH_TypeDef *)(AHB1PERIPH_BASE + 0x3C00UL))
+
+#define DMA1_BASE  (AHB1PERIPH_BASE + 0x6000UL)
+#define DMA2_BASE  (AHB1PERIPH_BASE + 0x6400UL)
+#define DMA1          ((DMA_TypeDef *)DMA1_BASE)
+#define DMA2          ((DMA_TypeDef *)DMA2_BASE)
+#define DMA1_Stream0  ((DMA_Stream_TypeDef *)(DMA1_BASE + 0x010UL))
+#define DMA1_Stream1  ((DMA_Stream_TypeDef *)(DMA1_BASE + 0x028UL))
+#define DMA1_Stream2  ((DMA_Stream_TypeDef *)(DMA1_BASE + 0x040UL))
+#define DMA1_Stream3  ((DMA_Stream_TypeDef *)(DMA1_BASE + 0x058UL))
+#define DMA1_Stream4  ((DMA_Stream_TypeDef *)(DMA1_BASE + 0x070UL))
+#define DMA1_Stream5  ((DMA_Stream_TypeDef *)(DMA1_BASE + 0x088UL))
+#define DMA1_Stream6  ((DMA_Stream_TypeDef *)(DMA1_BASE + 0x0A0UL))
+#define DMA1_Stream7  ((DMA_Stream_TypeDef *)(DMA1_BASE + 0x0B8UL))
+#define DMA2_Stream0  ((DMA_Stream_TypeDef *)(DMA2_BASE + 0x010UL))
+#define DMA2_Stream1  ((DMA_Stream_TypeDef *)(DMA2_BASE + 0x028UL))
+#define DMA2_Stream2  ((DMA_Stream_TypeDef *)(DMA2_BASE + 0x040UL))
+#define DMA2_Stream3  ((DMA_Stream_TypeDef *)(DMA2_BASE + 0x058UL))
+#define DMA2_Stream4  ((DMA_Stream_TypeDef *)(DMA2_BASE + 0x070UL))
+#define DMA2_Stream5  ((DMA_Stream_TypeDef *)(DMA2_BASE + 0x088UL))
+#define DMA2_Stream6  ((DMA_Stream_TypeDef *)(DMA2_BASE + 0x0A0UL))
+#define DMA2_Stream7  ((DMA_Stream_TypeDef *)(DMA2_BASE + 0x0B8UL))
+
+#define SCS_BASE        0xE000E000UL
+#define SysTick         ((SysTick_Type *)(SCS_BASE + 0x0010UL))
+#define SCB             ((SCB_Type *)(SCS_BASE + 0x0D00UL))
+#define CoreDebug       ((CoreDebug_Type *)0xE000EDF0UL)
+#define DWT             ((DWT_Type *)0xE0001000UL)
+
+// ------ Register bits ------
+#define TIM_CR1_CEN       0x0001U
+#define TIM_CR1_OPM       0x0008U
+#define TIM_CR1_URS       0x0004U
+#define TIM_DIER_UIE      0x0001U
+#define TIM_DIER_CC1IE    0x0002U
+#define TIM_DIER_CC2IE    0x0004U
+#define TIM_DIER_CC3IE    0x0008U
+#define TIM_DIER_CC4IE    0x0010U
+#define TIM_SR_UIF        0x0001U
+#define TIM_SR_CC1IF      0x0002U
+#define TIM_SR_CC2IF      0x0004U
+#define TIM_SR_CC3IF      0x0008U
+#define TIM_SR_CC4IF      0x0010U
+#define TIM_EGR_UG        0x0001U
+
+#define USART_SR_PE       0x0001U
+#define USART_SR_FE       0x0002U
+#define USART_SR_NE       0x0004U
+#define USART_SR_ORE      0x0008U
+#define USART_SR_IDLE     0x0010U
+#define USART_SR_RXNE     0x0020U
+#define USART_SR_TC       0x0040U
+#define USART_SR_TXE      0x0080U
+#define USART_CR1_RE      0x0004U
+#define USART_CR1_TE      0x0008U
+#define USART_CR1_IDLEIE  0x0010U
+#define USART_CR1_RXNEIE  0x0020U
+#define USART_CR1_TCIE    0x0040U
+#define USART_CR1_TXEIE   0x0080U
+#define USART_CR1_PEIE    0x0100U
+#define USART_CR1_PS      0x0200U
+#define USART_CR1_PCE     0x0400U
+#define USART_CR1_M       0x1000U
+#define USART_CR1_UE      0x2000U
+#define USART_CR2_STOP_1  0x2000U
+#define USART_CR3_EIE     0x0001U
+#define USART_CR3_DMAR    0x0040U
+#define USART_CR3_DMAT    0x0080U
+
+#define DMA_SxCR_EN       0x00000001U
+#define DMA_SxCR_DMEIE    0x00000002U
+#define DMA_SxCR_TEIE     0x00000004U
+#define DMA_SxCR_HTIE     0x00000008U
+#define DMA_SxCR_TCIE     0x00000010U
+#define DMA_SxCR_CIRC     0x00000100U
+#define DMA_SxCR_MINC     0x00000400U
+
+#define FLASH_SR_EOP      0x00000001U
+#define FLASH_SR_OPERR    0x00000002U
+#define FLASH_SR_WRPERR   0x00000010U
+#define FLASH_SR_PGAERR   0x00000020U
+#define FLASH_SR_PGPERR   0x00000040U
+#define FLASH_SR_PGSERR   0x00000080U
+#define FLASH_SR_BSY      0x00010000U
+#define FLASH_CR_PG       0x00000001U
+#define FLASH_CR_SER      0x00000002U
+#define FLASH_CR_SNB_Pos  3U
+#define FLASH_CR_SNB      0x000000F8U
+#define FLASH_CR_PSIZE_1  0x00000200U
+#define FLASH_CR_STRT     0x00010000U
+#define FLASH_CR_EOPIE    0x01000000U
+#define FLASH_CR_LOCK     0x80000000U
+#define FLASH_PSIZE_WORD  FLASH_CR_PSIZE_1
+
+#define SCB_ICSR_PENDSVSET_Msk       (1UL << 28)
+#define SCB_ICSR_PENDSVCLR_Msk       (1UL << 27)
+#define SCB_ICSR_VECTACTIVE_Msk      0x1FFUL
+#define SCB_SCR_SLEEPONEXIT_Msk      (1UL << 1)
+#define SCB_SCR_SEVONPEND_Msk        (1UL << 4)
+#define SysTick_CTRL_COUNTFLAG_Msk   (1UL << 16)
+#define DWT_CTRL_CYCCNTENA_Msk       (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk   (1UL << 24)
+
+#define __NVIC_PRIO_BITS  4U
+
+// ------ HAL types ------
+typedef enum { RESET = 0U, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0U, ENABLE = !DISABLE } FunctionalState;
+typedef enum { HAL_OK = 0x00U, HAL_ERROR = 0x01U, HAL_BUSY = 0x02U, HAL_TIMEOUT = 0x03U } HAL_StatusTypeDef;
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+
+typedef struct
+{
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef struct
+{
+  uint32_t Prescaler;
+  uint32_t CounterMode;
+  uint32_t Period;
+  uint32_t ClockDivision;
+  uint32_t RepetitionCounter;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+  TIM_TypeDef          *Instance;
+  TIM_Base_InitTypeDef Init;
+  uint32_t             Channel;
+} TIM_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t ICPolarity;
+  uint32_t ICSelection;
+  uint32_t ICPrescaler;
+  uint32_t ICFilter;
+} TIM_IC_InitTypeDef;
+
+typedef struct
+{
+  uint32_t OCMode;
+  uint32_t Pulse;
+  uint32_t OCPolarity;
+  uint32_t OCNPolarity;
+  uint32_t OCFastMode;
+  uint32_t OCIdleState;
+  uint32_t OCNIdleState;
+} TIM_OC_InitTypeDef;
+
+typedef struct
+{
+  uint32_t Channel;
+  uint32_t Direction;
+  uint32_t PeriphInc;
+  uint32_t MemInc;
+  uint32_t PeriphDataAlignment;
+  uint32_t MemDataAlignment;
+  uint32_t Mode;
+  uint32_t Priority;
+  uint32_t FIFOMode;
+  uint32_t FIFOThreshold;
+  uint32_t MemBurst;
+  uint32_t PeriphBurst;
+} DMA_InitTypeDef;
+
+typedef struct
+{
+  DMA_Stream_TypeDef *Instance;
+  DMA_InitTypeDef    Init;
+  void               *Parent;
+} DMA_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t ClockPrescaler;
+  uint32_t Resolution;
+  uint32_t DataAlign;
+  uint32_t ScanConvMode;
+  uint32_t EOCSelection;
+  uint32_t ContinuousConvMode;
+  uint32_t NbrOfConversion;
+  uint32_t DiscontinuousConvMode;
+  uint32_t NbrOfDiscConversion;
+  uint32_t ExternalTrigConv;
+  uint32_t ExternalTrigConvEdge;
+  uint32_t DMAContinuousRequests;
+} ADC_InitTypeDef;
+
+typedef struct
+{
+  ADC_TypeDef       *Instance;
+  ADC_InitTypeDef   Init;
+  DMA_HandleTypeDef *DMA_Handle;
+} ADC_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t Channel;
+  uint32_t Rank;
+  uint32_t SamplingTime;
+  uint32_t Offset;
+} ADC_ChannelConfTypeDef;
+
+typedef struct
+{
+  uint32_t PLLState;
+  uint32_t PLLSource;
+  uint32_t PLLM;
+  uint32_t PLLN;
+  uint32_t PLLP;
+  uint32_t PLLQ;
+  uint32_t PLLR;
+} RCC_PLLInitTypeDef;
+
+typedef struct
+{
+  uint32_t OscillatorType;
+  uint32_t HSEState;
+  uint32_t LSEState;
+  uint32_t HSIState;
+  uint32_t HSICalibrationValue;
+  uint32_t LSIState;
+  RCC_PLLInitTypeDef PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct
+{
+  uint32_t ClockType;
+  uint32_t SYSCLKSource;
+  uint32_t AHBCLKDivider;
+  uint32_t APB1CLKDivider;
+  uint32_t APB2CLKDivider;
+} RCC_ClkInitTypeDef;
+
+typedef struct
+{
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Sector;
+  uint32_t NbSectors;
+  uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+typedef struct
+{
+  void *Instance;
+  void *pData;
+} HCD_HandleTypeDef;
+
+typedef struct
+{
+  USART_TypeDef *Instance;
+  DMA_HandleTypeDef *hdmatx;
+  DMA_HandleTypeDef *hdmarx;
+} UART_HandleTypeDef;
+
+// ------ HAL constants ------
+#define GPIO_PIN_0    ((uint16_t)0x0001)
+#define GPIO_PIN_1    ((uint16_t)0x0002)
+#define GPIO_PIN_2    ((uint16_t)0x0004)
+#define GPIO_PIN_3    ((uint16_t)0x0008)
+#define GPIO_PIN_4    ((uint16_t)0x0010)
+#define GPIO_PIN_5    ((uint16_t)0x0020)
+#define GPIO_PIN_6    ((uint16_t)0x0040)
+#define GPIO_PIN_7    ((uint16_t)0x0080)
+#define GPIO_PIN_8    ((uint16_t)0x0100)
+#define GPIO_PIN_9    ((uint16_t)0x0200)
+#define GPIO_PIN_10   ((uint16_t)0x0400)
+#define GPIO_PIN_11   ((uint16_t)0x0800)
+#define GPIO_PIN_12   ((uint16_t)0x1000)
+#define GPIO_PIN_13   ((uint16_t)0x2000)
+#define GPIO_PIN_14   ((uint16_t)0x4000)
+#define GPIO_PIN_15   ((uint16_t)0x8000)
+
+#define GPIO_MODE_INPUT      0x00000000U
+#define GPIO_MODE_OUTPUT_PP  0x00000001U
+#define GPIO_MODE_OUTPUT_OD  0x00000011U
+#define GPIO_MODE_AF_PP      0x00000002U
+#define GPIO_MODE_AF_OD      0x00000012U
+#define GPIO_MODE_ANALOG     0x00000003U
+#define GPIO_NOPULL          0x00000000U
+#define GPIO_PULLUP          0x00000001U
+#define GPIO_PULLDOWN        0x00000002U
+#define GPIO_SPEED_FREQ_LOW        0x00000000U
+#define GPIO_SPEED_FREQ_VERY_HIGH  0x00000003U
+
+#define GPIO_AF1_TIM2     0x01U
+#define GPIO_AF2_TIM3     0x02U
+#define GPIO_AF2_TIM4     0x02U
+#define GPIO_AF2_TIM5     0x02U
+#define GPIO_AF7_USART3   0x07U
+#define GPIO_AF8_USART6   0x08U
+#define GPIO_AF9_TIM13    0x09U
+#define GPIO_AF9_TIM14    0x09U
+
+#define TIM_CHANNEL_1     0x00000000U
+#define TIM_CHANNEL_2     0x00000004U
+#define TIM_CHANNEL_3     0x00000008U
+#define TIM_CHANNEL_4     0x0000000CU
+#define TIM_COUNTERMODE_UP        0x00000000U
+#define TIM_ICPOLARITY_RISING     0x00000000U
+#define TIM_ICPOLARITY_FALLING    0x00000002U
+#define TIM_ICPOLARITY_BOTHEDGE   0x0000000AU
+#define TIM_ICSELECTION_DIRECTTI  0x00000001U
+#define TIM_ICPSC_DIV1            0x00000000U
+#define TIM_OCMODE_PWM1           0x00000060U
+#define TIM_OCPOLARITY_HIGH       0x00000000U
+#define TIM_OCNPOLARITY_HIGH      0x00000000U
+#define TIM_OCFAST_DISABLE        0x00000000U
+#define TIM_OCIDLESTATE_RESET     0x00000000U
+#define TIM_OCNIDLESTATE_RESET    0x00000000U
+#define TIM_FLAG_UPDATE           TIM_SR_UIF
+#define TIM_IT_UPDATE             TIM_DIER_UIE
+
+#define DMA_CHANNEL_0            0x00000000U
+#define DMA_CHANNEL_4            0x08000000U
+#define DMA_CHANNEL_5            0x0A000000U
+#define DMA_PERIPH_TO_MEMORY     0x00000000U
+#define DMA_MEMORY_TO_PERIPH     0x00000040U
+#define DMA_PINC_DISABLE         0x00000000U
+#define DMA_MINC_ENABLE          DMA_SxCR_MINC
+#define DMA_PDATAALIGN_BYTE      0x00000000U
+#define DMA_PDATAALIGN_HALFWORD  0x00000800U
+#define DMA_MDATAALIGN_WORD      0x00004000U
+#define DMA_NORMAL               0x00000000U
+#define DMA_CIRCULAR             DMA_SxCR_CIRC
+#define DMA_PRIORITY_VERY_HIGH   0x00030000U
+#define DMA_FIFOMODE_DISABLE     0x00000000U
+#define DMA_FIFO_THRESHOLD_HALFFULL 0x00000001U
+#define DMA_MBURST_SINGLE        0x00000000U
+#define DMA_PBURST_SINGLE        0x00000000U
+#define DMA_IT_TC                DMA_SxCR_TCIE
+#define DMA_IT_HT                DMA_SxCR_HTIE
+#define DMA_IT_TE                DMA_SxCR_TEIE
+#define DMA_IT_DME               DMA_SxCR_DMEIE
+
+#define DMA_FLAG_FEIF0_4   0x00000001U
+#define DMA_FLAG_DMEIF0_4  0x00000004U
+#define DMA_FLAG_TEIF0_4   0x00000008U
+#define DMA_FLAG_HTIF0_4   0x00000010U
+#define DMA_FLAG_TCIF0_4   0x00000020U
+#define DMA_FLAG_FEIF1_5   0x00000040U
+#define DMA_FLAG_DMEIF1_5  0x00000100U
+#define DMA_FLAG_TEIF1_5   0x00000200U
+#define DMA_FLAG_HTIF1_5   0x00000400U
+#define DMA_FLAG_TCIF1_5   0x00000800U
+#define DMA_FLAG_FEIF2_6   0x00010000U
+#define DMA_FLAG_DMEIF2_6  0x00040000U
+#define DMA_FLAG_TEIF2_6   0x00080000U
+#define DMA_FLAG_HTIF2_6   0x00100000U
+#define DMA_FLAG_TCIF2_6   0x00200000U
+#define DMA_FLAG_FEIF3_7   0x00400000U
+#define DMA_FLAG_DMEIF3_7  0x01000000U
+#define DMA_FLAG_TEIF3_7   0x02000000U
+#define DMA_FLAG_HTIF3_7   0x04000000U
+#define DMA_FLAG_TCIF3_7   0x08000000U
+
+#define ADC_CLOCK_SYNC_PCLK_DIV4      0x00010000U
+#define ADC_RESOLUTION_12B            0x00000000U
+#define ADC_DATAALIGN_RIGHT           0x00000000U
+#define ADC_EXTERNALTRIGCONVEDGE_NONE 0x00000000U
+#define ADC_EXTERNALTRIGCONV_T1_CC1   0x00000000U
+#define ADC_CHANNEL_10                0x0000000AU
+#define ADC_CHANNEL_13                0x0000000DU
+#define ADC_SAMPLETIME_3CYCLES        0x00000000U
+#define ADC_EOC_SEQ_CONV              0x00000000U
+
+#define RCC_OSCILLATORTYPE_HSE   0x00000001U
+#define RCC_HSE_BYPASS           0x00050000U
+#define RCC_PLL_ON               0x00000002U
+#define RCC_PLLSOURCE_HSE        0x00400000U
+#define RCC_PLLP_DIV4            0x00000004U
+#define RCC_CLOCKTYPE_SYSCLK     0x00000001U
+#define RCC_CLOCKTYPE_HCLK       0x00000002U
+#define RCC_CLOCKTYPE_PCLK1      0x00000004U
+#define RCC_CLOCKTYPE_PCLK2      0x00000008U
+#define RCC_SYSCLKSOURCE_PLLCLK  0x00000002U
+#define RCC_SYSCLK_DIV1          0x00000000U
+#define RCC_HCLK_DIV1            0x00000000U
+#define RCC_HCLK_DIV2            0x00001000U
+#define RCC_HCLK_DIV4            0x00001400U
+#define FLASH_LATENCY_5          0x00000005U
+#define PWR_REGULATOR_VOLTAGE_SCALE1 0x0000C000U
+
+#define FLASH_TYPEERASE_SECTORS  0x00000000U
+#define FLASH_TYPEPROGRAM_WORD   0x00000002U
+#define FLASH_VOLTAGE_RANGE_3    0x00000002U
+#define FLASH_SECTOR_3           3U
+#define FLASH_KEY1               0x45670123U
+#define FLASH_KEY2               0xCDEF89ABU
+
+#define UART_BRR_SAMPLING16(_PCLK_, _BAUD_)  ((uint32_t)(((_PCLK_) + ((_BAUD_) / 2U)) / (_BAUD_)))
+
+// ------ HAL macros ------
+#define __HAL_RCC_GPIOA_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_GPIOD_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_GPIOE_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_GPIOF_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_GPIOG_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_TIM2_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_TIM3_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_TIM4_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_TIM5_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_TIM6_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_TIM7_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_TIM13_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_TIM14_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_USART1_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_USART2_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_USART3_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_UART4_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_UART5_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_USART6_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_DMA1_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_DMA2_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_ADC1_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_PWR_CLK_ENABLE()     do { } while (0)
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(__REGULATOR__)  do { } while (0)
+
+#define __HAL_LINKDMA(__HANDLE__, __PPP_DMA_FIELD__, __DMA_HANDLE__)  \
+  do { (__HANDLE__)->__PPP_DMA_FIELD__ = &(__DMA_HANDLE__); (__DMA_HANDLE__).Parent = (__HANDLE__); } while (0)
+
+#define __HAL_TIM_GET_FLAG(__HANDLE__, __FLAG__)          (((__HANDLE__)->Instance->SR & (__FLAG__)) == (__FLAG__))
+#define __HAL_TIM_CLEAR_FLAG(__HANDLE__, __FLAG__)        ((__HANDLE__)->Instance->SR = ~(__FLAG__))
+#define __HAL_TIM_GET_IT_SOURCE(__HANDLE__, __INTERRUPT__) ((((__HANDLE__)->Instance->DIER & (__INTERRUPT__)) == (__INTERRUPT__)) ? SET : RESET)
+#define __HAL_TIM_CLEAR_IT(__HANDLE__, __INTERRUPT__)     ((__HANDLE__)->Instance->SR = ~(__INTERRUPT__))
+
+#define UNUSED(X)  (void)X
+
+// ------ CMSIS core functions. Interrupt masking and pending is emulated by Sil_Hal.c ------
+extern uint32_t SystemCoreClock;
+
+void     NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+uint32_t NVIC_GetPriority(IRQn_Type IRQn);
+void     NVIC_EnableIRQ(IRQn_Type IRQn);
+void     NVIC_DisableIRQ(IRQn_Type IRQn);
+void     NVIC_SetPendingIRQ(IRQn_Type IRQn);
+void     NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn);
+uint32_t NVIC_GetActive(IRQn_Type IRQn);
+
+void     __enable_irq(void);
+void     __disable_irq(void);
+uint32_t __get_PRIMASK(void);
+void     __set_PRIMASK(uint32_t priMask);
+uint32_t __get_BASEPRI(void);
+void     __set_BASEPRI(uint32_t basePri);
+void     __set_BASEPRI_MAX(uint32_t basePri);
+uint32_t __get_MSP(void);
+uint32_t __get_IPSR(void);
+void     __WFI(void);
+void     __WFE(void);
+void     __SEV(void);
+void     __NOP(void);
+#define  __DMB()  __sync_synchronize()
+#define  __DSB()  __sync_synchronize()
+#define  __ISB()  __sync_synchronize()
+#define  __REV16(x)  ((uint32_t)((((uint32_t)(x) & 0xFF00FF00UL) >> 8) | (((uint32_t)(x) & 0x00FF00FFUL) << 8)))
+#define  __REV(x)    __builtin_bswap32(x)
+#define  __CLZ(x)    ((x) ? (uint8_t)__builtin_clz(x) : 32U)
+
+// ------ HAL functions ------
+HAL_StatusTypeDef HAL_Init(void);
+void     HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void     HAL_Delay(uint32_t Delay);
+
+void     HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void     HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void     HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+void          HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void          HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void          HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency);
+void     HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t *pFLatency);
+uint32_t HAL_RCC_GetSysClockFreq(void);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+HAL_StatusTypeDef HAL_PWREx_EnableOverDrive(void);
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_IC_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_IC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_IC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_IC_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_IC_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_OC_Stop(TIM_HandleTypeDef *htim, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+void     HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim);
+void     HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+void     HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc);
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig);
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length);
+void     HAL_ADC_MspInit(ADC_HandleTypeDef *hadc);
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_DMAStop(UART_HandleTypeDef *huart);
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError);
+
+void     HAL_HCD_IRQHandler(HCD_HandleTypeDef *hhcd);
+
+#endif // __SIL_STM32F4XX_HAL_H
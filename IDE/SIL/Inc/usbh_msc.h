@@ -0,0 +1,5 @@
+/* SIL build: USB mass storage and FatFs are not simulated, see Sil_Stubs.c */
+#ifndef __SIL_USBH_MSC_H
+#define __SIL_USBH_MSC_H
+
+#endif // __SIL_USBH_MSC_H
@@ -0,0 +1,868 @@
+/**
+******************************************************************************
+* @file    /IDE/SIL/Src/Sil_Hal.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Stub HAL and Cortex-M4 core for the SIL build.
+*          - Peripheral, flash and system control space is mapped at the real addresses.
+*          - Registers with read side effects (TIMx CCRx, USART DR) live on pages that are protected while such a
+*            flag is set. An access traps, is single stepped and then reported to Sil_RegisterRead().
+*            Models write through an alias mapping.
+*          - NVIC is emulated: priorities, pending bits, PRIMASK/BASEPRI and preemption when a higher
+*            priority interrupt is pended from a handler.
+*          - Virtual time advances to the next scheduled event in __WFI().
+*          - Code takes no virtual time, so the ISR profile (-p) measures the handlers in host time. Compare it between
+*            builds on the same host, it does not give the times on the target.
+******************************************************************************
+*/
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "Sil.h"
+
+#define SIL_PERIPH_SIZE   0x00080000UL
+#define SIL_FLASH_SIZE    0x00080000UL
+#define SIL_SCS_BASE      0xE0000000UL
+#define SIL_SCS_SIZE      0x00100000UL
+#define SIL_PAGE_SIZE     0x1000UL
+
+#define SIL_EXC_OFFSET    16       // Index in the tables below is IRQn + 16
+#define SIL_NUM_VECTORS   (SIL_EXC_OFFSET + SIL_NUM_IRQ)
+#define SIL_THREAD_PRIO   256
+
+uint32_t SystemCoreClock = (uint32_t)SIL_CPU_FREQ;
+__IO uint32_t uwTick;
+
+// Pages holding registers with read side effects
+static const uintptr_t ProtectedPages[] =
+{
+  APB1PERIPH_BASE,              // TIM2..TIM5: reading CCRx clears CCxIF
+  APB1PERIPH_BASE + 0x4000UL,   // USART3: reading DR clears RXNE/IDLE
+  APB2PERIPH_BASE + 0x1000UL,   // USART6
+};
+#define NUM_PROTECTED_PAGES  (sizeof(ProtectedPages) / sizeof(ProtectedPages[0]))
+
+static uint8_t *PeriphAlias;
+static volatile uintptr_t TrappedAddress;
+static volatile int TrappedIsWrite;
+static volatile int InTrap;
+static uint8_t PageArmed[NUM_PROTECTED_PAGES];
+
+// ------ Virtual time ------
+static uint64_t Now;
+static Sil_Event Events[SIL_NUM_EVENTS];
+
+// ------ NVIC ------
+typedef void (*Sil_Handler)(void);
+static Sil_Handler VectorTable[SIL_NUM_VECTORS];
+static uint8_t  IrqPrio[SIL_NUM_VECTORS];
+static uint8_t  IrqEnabled[SIL_NUM_VECTORS];
+static uint8_t  IrqPending[SIL_NUM_VECTORS];
+static uint8_t  IrqActive[SIL_NUM_VECTORS];
+static uint32_t Primask = 0;
+static uint32_t Basepri = 0;
+static uint32_t ExecPrio = SIL_THREAD_PRIO;
+static uint32_t Ipsr = 0;
+
+// ------ ISR profile, host time entry to exit incl. preemption ------
+typedef struct
+{
+  uint64_t Count;
+  uint64_t TotalNs;
+  uint64_t MaxNs;
+} Sil_IsrTime;
+
+static Sil_IsrTime IsrTimes[SIL_NUM_VECTORS];
+
+// Handlers of the application. Weak so that handlers not (yet) implemented are simply absent.
+#define SIL_HANDLER_LIST(X) \
+  X(PendSV_Handler, PendSV_IRQn) \
+  X(SysTick_Handler, SysTick_IRQn) \
+  X(FLASH_IRQHandler, FLASH_IRQn) \
+  X(DMA1_Stream1_IRQHandler, DMA1_Stream1_IRQn) \
+  X(DMA1_Stream3_IRQHandler, DMA1_Stream3_IRQn) \
+  X(CAN1_TX_IRQHandler, CAN1_TX_IRQn) \
+  X(CAN1_RX0_IRQHandler, CAN1_RX0_IRQn) \
+  X(CAN1_RX1_IRQHandler, CAN1_RX1_IRQn) \
+  X(CAN1_SCE_IRQHandler, CAN1_SCE_IRQn) \
+  X(TIM2_IRQHandler, TIM2_IRQn) \
+  X(USART3_IRQHandler, USART3_IRQn) \
+  X(TIM8_UP_TIM13_IRQHandler, TIM8_UP_TIM13_IRQn) \
+  X(TIM8_TRG_COM_TIM14_IRQHandler, TIM8_TRG_COM_TIM14_IRQn) \
+  X(TIM5_IRQHandler, TIM5_IRQn) \
+  X(TIM6_DAC_IRQHandler, TIM6_DAC_IRQn) \
+  X(TIM7_IRQHandler, TIM7_IRQn) \
+  X(DMA2_Stream1_IRQHandler, DMA2_Stream1_IRQn) \
+  X(ETH_IRQHandler, ETH_IRQn) \
+  X(CAN2_TX_IRQHandler, CAN2_TX_IRQn) \
+  X(CAN2_RX0_IRQHandler, CAN2_RX0_IRQn) \
+  X(CAN2_RX1_IRQHandler, CAN2_RX1_IRQn) \
+  X(CAN2_SCE_IRQHandler, CAN2_SCE_IRQn) \
+  X(OTG_FS_IRQHandler, OTG_FS_IRQn) \
+  X(DMA2_Stream7_IRQHandler, DMA2_Stream7_IRQn) \
+  X(USART6_IRQHandler, USART6_IRQn)
+
+#define SIL_DECLARE_HANDLER(Name, IRQn)  extern void Name(void) __attribute__((weak));
+SIL_HANDLER_LIST(SIL_DECLARE_HANDLER)
+
+#define SIL_HANDLER_NAME(Name, IRQn)  [IRQn + SIL_EXC_OFFSET] = #Name,
+static const char *const HandlerNames[SIL_NUM_VECTORS] = { SIL_HANDLER_LIST(SIL_HANDLER_NAME) };
+
+static void Sil_Dispatch(void);
+static void Sil_AdvanceTime(void);
+
+// -----------------------------------------------------------------------
+// ------ Memory map and register side effects ------
+
+static int Sil_ProtectedPage(uintptr_t Address)
+{
+  for (uint32_t i = 0; i < NUM_PROTECTED_PAGES; i++)
+  {
+    if ((Address & ~(SIL_PAGE_SIZE - 1)) == ProtectedPages[i])
+    {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+// Armed pages are inaccessible, all others are read/write
+static void Sil_ProtectPages(void)
+{
+  for (uint32_t i = 0; i < NUM_PROTECTED_PAGES; i++)
+  {
+    (void)mprotect((void *)ProtectedPages[i], SIL_PAGE_SIZE, PageArmed[i] ? PROT_NONE : (PROT_READ | PROT_WRITE));
+  }
+}
+
+// A trap costs two signals. The models arm it only while a flag with a read side effect is set, so reading
+// CNT of a free running timer or polling a status register is a plain memory access most of the time.
+void Sil_SetReadTrap(volatile void *Register, int Armed)
+{
+  int Page = Sil_ProtectedPage((uintptr_t)Register);
+
+  if (Page >= 0 && PageArmed[Page] != (Armed != 0))
+  {
+    PageArmed[Page] = (Armed != 0);
+    if (!InTrap)
+    {
+      (void)mprotect((void *)ProtectedPages[Page], SIL_PAGE_SIZE, Armed ? PROT_NONE : (PROT_READ | PROT_WRITE));
+    }
+  }
+}
+
+#if defined(__x86_64__)
+// First trap: let the instruction execute with the page accessible and single step it (trap flag)
+static void Sil_SegvHandler(int Sig, siginfo_t *Info, void *Context)
+{
+  ucontext_t *Uc = (ucontext_t *)Context;
+  uintptr_t Address = (uintptr_t)Info->si_addr;
+
+  int Page = Sil_ProtectedPage(Address);
+
+  if (Page < 0 || !PageArmed[Page])
+  {
+    signal(SIGSEGV, SIG_DFL);   // A real crash. Let it happen again without the handler.
+    return;
+  }
+  TrappedAddress = Address;
+  TrappedIsWrite = (Uc->uc_mcontext.gregs[REG_ERR] & 0x2) != 0;
+  InTrap = 1;
+  (void)mprotect((void *)ProtectedPages[Page], SIL_PAGE_SIZE, PROT_READ | PROT_WRITE);
+  Uc->uc_mcontext.gregs[REG_EFL] |= 0x100;
+}
+
+// Second trap: the instruction has executed. Protect the pages again and apply the side effect.
+static void Sil_TrapHandler(int Sig, siginfo_t *Info, void *Context)
+{
+  ucontext_t *Uc = (ucontext_t *)Context;
+
+  Uc->uc_mcontext.gregs[REG_EFL] &= ~0x100;
+  if (!TrappedIsWrite)
+  {
+    Sil_RegisterRead(TrappedAddress);
+  }
+  InTrap = 0;
+  Sil_ProtectPages();
+}
+#endif
+
+static void Sil_MapFixed(uintptr_t Address, size_t Size)
+{
+  void *p = mmap((void *)Address, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if (p != (void *)Address)
+  {
+    fprintf(stderr, "SIL: unable to map 0x%08lX\n", (unsigned long)Address);
+    exit(2);
+  }
+}
+
+void Sil_InitMemory(void)
+{
+  int Fd;
+  void *p;
+
+  // Flash (erased state is all ones) and the Cortex-M4 system control space
+  Sil_MapFixed(FLASH_BASE, SIL_FLASH_SIZE);
+  memset((void *)FLASH_BASE, 0xFF, SIL_FLASH_SIZE);
+  Sil_MapFixed(SIL_SCS_BASE, SIL_SCS_SIZE);
+
+  // Peripherals: the same memory is mapped twice, at the real address for the application and at an alias for the models
+  Fd = memfd_create("sil_periph", 0);
+  if (Fd < 0 || ftruncate(Fd, SIL_PERIPH_SIZE) != 0)
+  {
+    fprintf(stderr, "SIL: unable to create peripheral memory\n");
+    exit(2);
+  }
+  p = mmap((void *)PERIPH_BASE, SIL_PERIPH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE, Fd, 0);
+  PeriphAlias = mmap(NULL, SIL_PERIPH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+  if (p != (void *)PERIPH_BASE || PeriphAlias == MAP_FAILED)
+  {
+    fprintf(stderr, "SIL: unable to map peripherals\n");
+    exit(2);
+  }
+
+#if defined(__x86_64__)
+  struct sigaction Sa;
+  memset(&Sa, 0, sizeof(Sa));
+  Sa.sa_flags = SA_SIGINFO;
+  Sa.sa_sigaction = Sil_SegvHandler;
+  sigaction(SIGSEGV, &Sa, NULL);
+  Sa.sa_sigaction = Sil_TrapHandler;
+  sigaction(SIGTRAP, &Sa, NULL);
+#endif
+
+  // Vector table and reset values of the core
+#define SIL_INSTALL_HANDLER(Name, IRQn)  VectorTable[(IRQn) + SIL_EXC_OFFSET] = Name;
+  SIL_HANDLER_LIST(SIL_INSTALL_HANDLER)
+  for (int i = 0; i < SIL_EXC_OFFSET; i++)
+  {
+    IrqEnabled[i] = 1;    // System exceptions can not be disabled
+  }
+}
+
+void *Sil_Alias(volatile void *FirmwareAddress)
+{
+  return PeriphAlias + ((uintptr_t)FirmwareAddress - PERIPH_BASE);
+}
+
+// -----------------------------------------------------------------------
+// ------ Virtual time ------
+
+uint64_t Sil_Now(void)
+{
+  return Now;
+}
+
+int Sil_ScheduleEvent(uint64_t Time, Sil_EventFunc Func, void *Arg)
+{
+  for (int i = 0; i < SIL_NUM_EVENTS; i++)
+  {
+    if (!Events[i].Active)
+    {
+      Events[i].Time = Time < Now ? Now : Time;
+      Events[i].Func = Func;
+      Events[i].Arg = Arg;
+      Events[i].Active = 1;
+      return i;
+    }
+  }
+  fprintf(stderr, "SIL: event table full\n");
+  exit(2);
+}
+
+void Sil_CancelEvent(int Handle)
+{
+  if (Handle >= 0 && Handle < SIL_NUM_EVENTS)
+  {
+    Events[Handle].Active = 0;
+  }
+}
+
+// Move time forward to the next event and fire all events that are due
+static void Sil_AdvanceTime(void)
+{
+  uint64_t Next = UINT64_MAX;
+
+  for (int i = 0; i < SIL_NUM_EVENTS; i++)
+  {
+    if (Events[i].Active && Events[i].Time < Next)
+    {
+      Next = Events[i].Time;
+    }
+  }
+  if (Next == UINT64_MAX)
+  {
+    Next = Now + SIL_CYCLES_PER_MS;
+  }
+  if (Next >= SilConfig.EndTime)
+  {
+    Now = SilConfig.EndTime;
+    Sil_PeripheralsUpdateCounters(Now);
+    Sil_Finish();
+  }
+
+  Now = Next;
+  Sil_PeripheralsUpdateCounters(Now);
+
+  for (int i = 0; i < SIL_NUM_EVENTS; i++)
+  {
+    if (Events[i].Active && Events[i].Time <= Now)
+    {
+      Events[i].Active = 0;
+      Events[i].Func(Events[i].Arg);
+    }
+  }
+}
+
+static void Sil_SysTickEvent(void *Arg)
+{
+  SysTick->CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+  Sil_PendIrq(SysTick_IRQn);
+  (void)Sil_ScheduleEvent(Now + SIL_CYCLES_PER_MS, Sil_SysTickEvent, NULL);
+}
+
+// -----------------------------------------------------------------------
+// ------ NVIC and core registers ------
+
+// Returns vector index of the pending interrupt that would be taken now (ignoring PRIMASK), or -1
+static int Sil_NextIrq(void)
+{
+  int Best = -1;
+  uint32_t BestPrio = SIL_THREAD_PRIO;
+
+  if (SCB->ICSR & SCB_ICSR_PENDSVSET_Msk)
+  {
+    SCB->ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+    IrqPending[PendSV_IRQn + SIL_EXC_OFFSET] = 1;
+  }
+
+  for (int i = 0; i < SIL_NUM_VECTORS; i++)
+  {
+    if (IrqPending[i] && IrqEnabled[i] && IrqPrio[i] < BestPrio)
+    {
+      Best = i;
+      BestPrio = IrqPrio[i];
+    }
+  }
+  if (Best < 0 || BestPrio >= ExecPrio || (Basepri != 0 && BestPrio >= (Basepri >> (8 - __NVIC_PRIO_BITS))))
+  {
+    return -1;
+  }
+  return Best;
+}
+
+static uint64_t Sil_HostNs(void)
+{
+  struct timespec Time;
+
+  clock_gettime(CLOCK_MONOTONIC, &Time);
+  return (uint64_t)Time.tv_sec * 1000000000ULL + (uint64_t)Time.tv_nsec;
+}
+
+static void Sil_ProfiledCall(int Vector)
+{
+  uint64_t Start = Sil_HostNs();
+  uint64_t Elapsed;
+
+  VectorTable[Vector]();
+  Elapsed = Sil_HostNs() - Start;
+  IsrTimes[Vector].Count++;
+  IsrTimes[Vector].TotalNs += Elapsed;
+  if (Elapsed > IsrTimes[Vector].MaxNs)
+  {
+    IsrTimes[Vector].MaxNs = Elapsed;
+  }
+}
+
+void Sil_IsrProfileReport(FILE *Out)
+{
+  fprintf(Out, "ISR profile [host ns]:      count      mean       max\n");
+  for (int i = 0; i < SIL_NUM_VECTORS; i++)
+  {
+    if (IsrTimes[i].Count != 0)
+    {
+      fprintf(Out, "  %-30s %10llu %9llu %9llu\n", HandlerNames[i] != NULL ? HandlerNames[i] : "?",
+              (unsigned long long)IsrTimes[i].Count, (unsigned long long)(IsrTimes[i].TotalNs / IsrTimes[i].Count),
+              (unsigned long long)IsrTimes[i].MaxNs);
+    }
+  }
+}
+
+static void Sil_Dispatch(void)
+{
+  int Vector;
+
+  for (;;)
+  {
+    Sil_PeripheralsPoll();
+    if (Primask || (Vector = Sil_NextIrq()) < 0)
+    {
+      return;
+    }
+    uint32_t SavedPrio = ExecPrio;
+    uint32_t SavedIpsr = Ipsr;
+
+    IrqPending[Vector] = 0;
+    IrqActive[Vector] = 1;
+    ExecPrio = IrqPrio[Vector];
+    Ipsr = (uint32_t)Vector;
+    if (VectorTable[Vector] != NULL)
+    {
+      if (SilConfig.IsrProfile)
+      {
+        Sil_ProfiledCall(Vector);
+      }
+      else
+      {
+        VectorTable[Vector]();
+      }
+    }
+    IrqActive[Vector] = 0;
+    ExecPrio = SavedPrio;
+    Ipsr = SavedIpsr;
+  }
+}
+
+void Sil_PendIrq(IRQn_Type IRQn)
+{
+  IrqPending[IRQn + SIL_EXC_OFFSET] = 1;
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+  IrqPrio[IRQn + SIL_EXC_OFFSET] = (uint8_t)(priority & 0xF);
+}
+
+uint32_t NVIC_GetPriority(IRQn_Type IRQn)
+{
+  return IrqPrio[IRQn + SIL_EXC_OFFSET];
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  IrqEnabled[IRQn + SIL_EXC_OFFSET] = 1;
+  Sil_Dispatch();
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  if (IRQn >= 0)
+  {
+    IrqEnabled[IRQn + SIL_EXC_OFFSET] = 0;
+  }
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+  IrqPending[IRQn + SIL_EXC_OFFSET] = 1;
+  Sil_Dispatch();           // Preempts right away if priority is higher than current execution priority
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+  IrqPending[IRQn + SIL_EXC_OFFSET] = 0;
+}
+
+uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn)
+{
+  return IrqPending[IRQn + SIL_EXC_OFFSET];
+}
+
+uint32_t NVIC_GetActive(IRQn_Type IRQn)
+{
+  return IrqActive[IRQn + SIL_EXC_OFFSET];
+}
+
+void __enable_irq(void)
+{
+  Primask = 0;
+  Sil_Dispatch();
+}
+
+void __disable_irq(void)
+{
+  Primask = 1;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+  return Primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+  Primask = priMask & 1;
+  Sil_Dispatch();
+}
+
+uint32_t __get_BASEPRI(void)
+{
+  return Basepri;
+}
+
+void __set_BASEPRI(uint32_t basePri)
+{
+  Basepri = basePri & 0xFF;
+  Sil_Dispatch();
+}
+
+void __set_BASEPRI_MAX(uint32_t basePri)
+{
+  basePri &= 0xFF;
+  if (basePri != 0 && (Basepri == 0 || basePri < Basepri))
+  {
+    Basepri = basePri;
+  }
+}
+
+uint32_t __get_MSP(void)
+{
+  return (uint32_t)(uintptr_t)__builtin_frame_address(0);
+}
+
+uint32_t __get_IPSR(void)
+{
+  return Ipsr;
+}
+
+// Sleep until an interrupt is pending. With PRIMASK set the core wakes up but the handler runs first at __enable_irq().
+void __WFI(void)
+{
+  Sil_PeripheralsPoll();
+  uint32_t SavedPrimask = Primask;
+  Primask = 0;
+  int Ready = Sil_NextIrq();
+  Primask = SavedPrimask;
+
+  if (Ready < 0)
+  {
+    Sil_AdvanceTime();
+  }
+  Sil_Dispatch();
+}
+
+void __WFE(void)
+{
+  __WFI();
+}
+
+void __SEV(void)
+{
+}
+
+void __NOP(void)
+{
+}
+
+// -----------------------------------------------------------------------
+// ------ HAL ------
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+  SysTick->LOAD = (uint32_t)(SIL_CYCLES_PER_MS - 1);
+  SysTick->CTRL = 0x7;
+  HAL_NVIC_SetPriority(SysTick_IRQn, 0x08U, 0U);   // TICK_INT_PRIORITY in stm32f4xx_hal_conf.h
+  (void)Sil_ScheduleEvent(Now + SIL_CYCLES_PER_MS, Sil_SysTickEvent, NULL);
+  return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+  return uwTick;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+  uint32_t TickStart = HAL_GetTick();
+
+  while ((HAL_GetTick() - TickStart) < Delay + 1U)
+  {
+    __WFI();
+  }
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+  NVIC_SetPriority(IRQn, PreemptPriority);
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  NVIC_EnableIRQ(IRQn);
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  NVIC_DisableIRQ(IRQn);
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+  if (PinState == GPIO_PIN_SET)
+  {
+    GPIOx->ODR |= GPIO_Pin;
+  }
+  else
+  {
+    GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+  }
+  GPIOx->IDR = GPIOx->ODR;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+  GPIOx->ODR ^= GPIO_Pin;
+  GPIOx->IDR = GPIOx->ODR;
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency)
+{
+  return HAL_OK;
+}
+
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t *pFLatency)
+{
+  RCC_ClkInitStruct->ClockType = RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+  RCC_ClkInitStruct->SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+  RCC_ClkInitStruct->AHBCLKDivider = RCC_SYSCLK_DIV1;
+  RCC_ClkInitStruct->APB1CLKDivider = RCC_HCLK_DIV4;
+  RCC_ClkInitStruct->APB2CLKDivider = RCC_HCLK_DIV2;
+  *pFLatency = FLASH_LATENCY_5;
+}
+
+uint32_t HAL_RCC_GetSysClockFreq(void)
+{
+  return (uint32_t)SIL_CPU_FREQ;
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+  return (uint32_t)SIL_CPU_FREQ;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+  return (uint32_t)SIL_PCLK1_FREQ;
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void)
+{
+  return (uint32_t)SIL_PCLK2_FREQ;
+}
+
+HAL_StatusTypeDef HAL_PWREx_EnableOverDrive(void)
+{
+  return HAL_OK;
+}
+
+static void Sil_TimInit(TIM_HandleTypeDef *htim)
+{
+  htim->Instance->PSC = htim->Init.Prescaler;
+  htim->Instance->ARR = htim->Init.Period;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+  Sil_TimInit(htim);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+  htim->Instance->DIER |= TIM_DIER_UIE;
+  htim->Instance->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim)
+{
+  htim->Instance->DIER &= ~TIM_DIER_UIE;
+  htim->Instance->CR1 &= ~TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Init(TIM_HandleTypeDef *htim)
+{
+  Sil_TimInit(htim);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_IC_InitTypeDef *sConfig, uint32_t Channel)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  htim->Instance->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_Start_IT(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  htim->Instance->DIER |= (TIM_DIER_CC1IE << (Channel / 4U));
+  htim->Instance->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_Init(TIM_HandleTypeDef *htim)
+{
+  Sil_TimInit(htim);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_OC_Stop(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim)
+{
+  Sil_TimInit(htim);
+  HAL_TIM_PWM_MspInit(htim);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig, uint32_t Channel)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+  htim->Instance->CR1 |= TIM_CR1_CEN;
+  return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim)
+{
+}
+
+__attribute__((weak)) void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim)
+{
+  if ((htim->Instance->SR & TIM_SR_UIF) && (htim->Instance->DIER & TIM_DIER_UIE))
+  {
+    htim->Instance->SR = ~TIM_SR_UIF;
+    HAL_TIM_PeriodElapsedCallback(htim);
+  }
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+  return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_ADC_MspInit(ADC_HandleTypeDef *hadc)
+{
+}
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc)
+{
+  HAL_ADC_MspInit(hadc);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *pData, uint32_t Length)
+{
+  Sil_AdcSetBuffer((volatile uint16_t *)pData, Length);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DMAStop(UART_HandleTypeDef *huart)
+{
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+  FLASH->CR &= ~FLASH_CR_LOCK;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+  FLASH->CR |= FLASH_CR_LOCK;
+  return HAL_OK;
+}
+
+// Programming can only clear bits, like real flash
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+  if (Address < FLASH_BASE || Address >= FLASH_BASE + SIL_FLASH_SIZE || TypeProgram != FLASH_TYPEPROGRAM_WORD)
+  {
+    return HAL_ERROR;
+  }
+  *(volatile uint32_t *)(uintptr_t)Address &= (uint32_t)Data;
+  return HAL_OK;
+}
+
+void Sil_FlashEraseSector(uint32_t Sector)
+{
+  static const uint32_t SectorStart[] = { 0x00000, 0x04000, 0x08000, 0x0C000, 0x10000, 0x20000, 0x40000, 0x60000, 0x80000 };
+
+  if (Sector < 8)
+  {
+    memset((void *)(FLASH_BASE + SectorStart[Sector]), 0xFF, SectorStart[Sector + 1] - SectorStart[Sector]);
+  }
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError)
+{
+  for (uint32_t i = 0; i < pEraseInit->NbSectors; i++)
+  {
+    Sil_FlashEraseSector(pEraseInit->Sector + i);
+  }
+  *SectorError = 0xFFFFFFFFU;
+  return HAL_OK;
+}
+
+void HAL_HCD_IRQHandler(HCD_HandleTypeDef *hhcd)
+{
+}
@@ -0,0 +1,133 @@
+/**
+******************************************************************************
+* @file    /IDE/SIL/Src/Sil_Main.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Entry point of the SIL build. Sets up the simulated MCU and runs main() of the application
+*          (compiled as App_main) until the requested virtual time has passed.
+*
+*          Usage: Nucleo_446ZE_Sil [-t seconds] [-v] [-o terminal_file] [-i terminal_input] [-m modbus_period_ms] [-r] [-f]
+*                                  [-p]
+*          Exit code is 0 if the plant models saw the expected behaviour, otherwise 1.
+******************************************************************************
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "Sil.h"
+
+#define SIL_APP_STACK_SIZE  (1024U * 1024U)
+
+int App_main(void);
+
+Sil_Config SilConfig =
+{
+  .EndTime = 10U * SIL_CPU_FREQ,
+  .Verbose = 0,
+  .TerminalFile = NULL,
+  .TerminalInput = NULL,
+  .ModbusPeriodMs = 10U,
+  .ModbusRateSweep = 0,
+  .ModbusScript = 0,
+  .IsrProfile = 0,
+};
+
+static struct timespec HostStart;
+static ucontext_t HostContext;
+static ucontext_t AppContext;
+
+void Sil_Finish(void)
+{
+  struct timespec HostEnd;
+  double HostSeconds, SimSeconds;
+  int Result;
+
+  clock_gettime(CLOCK_MONOTONIC, &HostEnd);
+  HostSeconds = (double)(HostEnd.tv_sec - HostStart.tv_sec) + (double)(HostEnd.tv_nsec - HostStart.tv_nsec) * 1e-9;
+  SimSeconds = (double)Sil_Now() / (double)SIL_CPU_FREQ;
+
+  fflush(stdout);
+  printf("\nSIL: %.3f s simulated in %.3f s host time\n", SimSeconds, HostSeconds);
+  if (SilConfig.IsrProfile)
+  {
+    Sil_IsrProfileReport(stdout);
+  }
+  Result = Sil_PlantReport(stdout);
+  printf("SIL: %s\n", Result == 0 ? "PASS" : "FAIL");
+  fflush(stdout);
+  exit(Result);
+}
+
+static void Sil_RunApp(void)
+{
+  (void)App_main();
+  fprintf(stderr, "SIL: main() returned\n");
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  int Opt;
+  void *Stack;
+
+  while ((Opt = getopt(argc, argv, "t:vo:i:m:rfp")) != -1)
+  {
+    switch (Opt)
+    {
+    case 't':
+      SilConfig.EndTime = (uint64_t)(atof(optarg) * (double)SIL_CPU_FREQ);
+      break;
+    case 'v':
+      SilConfig.Verbose = 1;
+      break;
+    case 'o':
+      SilConfig.TerminalFile = optarg;
+      break;
+    case 'i':
+      SilConfig.TerminalInput = optarg;
+      break;
+    case 'm':
+      SilConfig.ModbusPeriodMs = (uint32_t)atoi(optarg);
+      break;
+    case 'r':
+      SilConfig.ModbusRateSweep = 1;
+      break;
+    case 'f':
+      SilConfig.ModbusScript = 1;
+      break;
+    case 'p':
+      SilConfig.IsrProfile = 1;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-t seconds] [-v] [-o terminal_file] [-i terminal_input] [-m modbus_period_ms] [-r] [-f] [-p]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &HostStart);
+  Sil_InitMemory();
+  Sil_PeripheralsInit();
+  Sil_PlantInit();
+
+  // The application stores addresses in 32-bit DMA registers, so its stack must be in the low 4 GB like the data segment (non-PIE)
+  Stack = mmap(NULL, SIL_APP_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+  if (Stack == MAP_FAILED)
+  {
+    fprintf(stderr, "SIL: unable to allocate application stack\n");
+    return 2;
+  }
+  getcontext(&AppContext);
+  AppContext.uc_stack.ss_sp = Stack;
+  AppContext.uc_stack.ss_size = SIL_APP_STACK_SIZE;
+  AppContext.uc_link = &HostContext;
+  makecontext(&AppContext, Sil_RunApp, 0);
+  swapcontext(&HostContext, &AppContext);
+  return 2;
+}
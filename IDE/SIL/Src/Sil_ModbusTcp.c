@@ -0,0 +1,344 @@
+/**
+******************************************************************************
+* @file    /IDE/SIL/Src/Sil_ModbusTcp.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Host test of the Modbus TCP framing in ModbusTcp.c, without lwIP: the raw API of lwip/tcp.h is simulated
+*          with heap pbufs and pcbs that record what the server writes, acknowledges (tcp_recved) and closes.
+*          Modbus_ServePdu() is replaced by an echo of the request PDU, so each response can be matched to its
+*          request. Covers requests split over segments, pipelined requests, a full send buffer, a bad MBAP header,
+*          the close by the client and the connection limit. Every pbuf given to the server shall be freed.
+*          Exit code is 0 if all checks pass, otherwise 1.
+******************************************************************************
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lwip/tcp.h"
+#include "ProjectDefs.h"
+#include "Modbus.h"
+#include "ModbusTcp.h"
+
+#define TEST_SND_BUF  4096           // Send buffer of a pcb with room for a response
+
+static struct tcp_pcb ListenPcb;
+static struct tcp_pcb Clients[MODBUS_TCP_MAX_CLIENTS + 1];
+static uint32_t PbufsAllocated;
+static uint32_t PbufsFreed;
+static int Locked;                   // Scheduler_Lock() is held
+static uint32_t ServedUnlocked;
+static uint32_t Checks;
+static uint32_t Failures;
+
+// FC 3 and FC 4 requests, MBAP header with transaction identifiers 1 and 2, unit identifier 0xFF
+static const uint8_t RequestA[] = { 0x00, 0x01, 0x00, 0x00, 0x00, 0x06, 0xFF, 0x03, 0x10, 0x00, 0x00, 0x02 };
+static const uint8_t RequestB[] = { 0x00, 0x02, 0x00, 0x00, 0x00, 0x06, 0xFF, 0x04, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t BadProtocol[] = { 0x00, 0x03, 0x00, 0x01, 0x00, 0x06, 0xFF, 0x03, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t BadLength[] = { 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0xFF };
+
+// -----------------------------------------------------------------------
+// ------ Simulated lwIP ------
+
+u16_t pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset)
+{
+  u16_t Copied = 0;
+  u16_t Length;
+
+  for ( ; (buf != NULL) && (Copied < len); buf = buf->next)
+  {
+    if (offset >= buf->len)
+    {
+      offset -= buf->len;
+      continue;
+    }
+    Length = (u16_t)(buf->len - offset);
+    if (Length > len - Copied)
+    {
+      Length = (u16_t)(len - Copied);
+    }
+    memcpy((uint8_t *)dataptr + Copied, (const uint8_t *)buf->payload + offset, Length);
+    Copied += Length;
+    offset = 0;
+  }
+  return Copied;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+  struct pbuf *Next;
+  u8_t Count = 0;
+
+  for ( ; p != NULL; p = Next)
+  {
+    Next = p->next;
+    free(p->payload);
+    free(p);
+    PbufsFreed++;
+    Count++;
+  }
+  return Count;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail)
+{
+  for ( ; head->next != NULL; head = head->next)
+  {
+    head->tot_len += tail->tot_len;
+  }
+  head->tot_len += tail->tot_len;
+  head->next = tail;
+}
+
+struct tcp_pcb *tcp_new(void)
+{
+  return &ListenPcb;
+}
+
+err_t tcp_bind(struct tcp_pcb *pcb, const void *ipaddr, u16_t port)
+{
+  return (port == MODBUS_TCP_PORT) ? ERR_OK : ERR_VAL;
+}
+
+struct tcp_pcb *tcp_listen(struct tcp_pcb *pcb)
+{
+  return pcb;
+}
+
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept) { pcb->accept = accept; }
+void tcp_arg(struct tcp_pcb *pcb, void *arg) { pcb->callback_arg = arg; }
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) { pcb->recv = recv; }
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) { pcb->sent = sent; }
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval) { pcb->poll = poll; }
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) { pcb->errf = err; }
+void tcp_setprio(struct tcp_pcb *pcb, u8_t prio) { }
+err_t tcp_output(struct tcp_pcb *pcb) { return ERR_OK; }
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) { pcb->recved += len; }
+void tcp_abort(struct tcp_pcb *pcb) { pcb->aborted = 1; }
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags)
+{
+  if ((len > pcb->snd_buf) || (pcb->written_len + len > sizeof(pcb->written)))
+  {
+    return ERR_MEM;
+  }
+  memcpy(&pcb->written[pcb->written_len], dataptr, len);
+  pcb->written_len += len;
+  return ERR_OK;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb)
+{
+  pcb->closed = 1;
+  return ERR_OK;
+}
+
+// -----------------------------------------------------------------------
+// ------ Replaced application functions ------
+
+uint32_t Scheduler_Lock(void)
+{
+  Locked = 1;
+  return 0;
+}
+
+void Scheduler_Unlock(uint32_t PrevLock)
+{
+  Locked = 0;
+}
+
+// The response is the request PDU
+uint16_t Modbus_ServePdu(const uint8_t *Request, uint16_t Length, uint8_t *Response)
+{
+  if (!Locked)
+  {
+    ServedUnlocked++;
+  }
+  memcpy(Response, Request, Length);
+  return Length;
+}
+
+// -----------------------------------------------------------------------
+// ------ Test cases ------
+
+static void Check(int Ok, const char *Name)
+{
+  Checks++;
+  if (!Ok)
+  {
+    Failures++;
+    printf("ModbusTcp: FAIL %s\n", Name);
+  }
+}
+
+static struct pbuf *Segment(const uint8_t *Data, u16_t Length)
+{
+  struct pbuf *p = calloc(1, sizeof(*p));
+
+  p->payload = malloc(Length);
+  memcpy(p->payload, Data, Length);
+  p->len = p->tot_len = Length;
+  PbufsAllocated++;
+  return p;
+}
+
+static struct tcp_pcb *Connect(int Indx)
+{
+  struct tcp_pcb *Pcb = &Clients[Indx];
+
+  memset(Pcb, 0, sizeof(*Pcb));
+  Pcb->snd_buf = TEST_SND_BUF;
+  Pcb->callback_arg = NULL;
+  Check(ListenPcb.accept(NULL, Pcb, ERR_OK) == ERR_OK, "accept");
+  return Pcb;
+}
+
+static err_t Receive(struct tcp_pcb *Pcb, const uint8_t *Data, u16_t Length)
+{
+  if (Pcb->recv == NULL)
+  {
+    Check(FALSE, "receive: closed by the server");
+    return ERR_OK;
+  }
+  return Pcb->recv(Pcb->callback_arg, Pcb, Segment(Data, Length), ERR_OK);
+}
+
+// The client closes, the server shall free the queue and the slot
+static void Disconnect(struct tcp_pcb *Pcb)
+{
+  if (!Pcb->closed && (Pcb->recv != NULL))
+  {
+    (void)Pcb->recv(Pcb->callback_arg, Pcb, NULL, ERR_OK);
+  }
+  Check(Pcb->closed, "closed by the client");
+}
+
+// The header, 3 bytes and the rest of a request in separate segments
+static void Test_SplitSegments(void)
+{
+  struct tcp_pcb *Pcb = Connect(0);
+
+  (void)Receive(Pcb, RequestA, 5);
+  (void)Receive(Pcb, &RequestA[5], 4);
+  Check((Pcb->written_len == 0) && (Pcb->recved == 0), "split: nothing served before the request is complete");
+  (void)Receive(Pcb, &RequestA[9], sizeof(RequestA) - 9);
+  Check((Pcb->written_len == sizeof(RequestA)) && (memcmp(Pcb->written, RequestA, sizeof(RequestA)) == 0),
+        "split: response");
+  Check(Pcb->recved == sizeof(RequestA), "split: window opened for the request");
+  Check(PbufsFreed == PbufsAllocated, "split: segments freed");
+  Disconnect(Pcb);
+}
+
+// Two requests in one segment, then a request that continues in the next segment
+static void Test_Pipelined(void)
+{
+  struct tcp_pcb *Pcb = Connect(0);
+  uint8_t Stream[2 * sizeof(RequestA)];
+
+  memcpy(Stream, RequestA, sizeof(RequestA));
+  memcpy(&Stream[sizeof(RequestA)], RequestB, sizeof(RequestB));
+  (void)Receive(Pcb, Stream, sizeof(Stream));
+  Check((Pcb->written_len == sizeof(Stream)) && (memcmp(Pcb->written, Stream, sizeof(Stream)) == 0),
+        "pipelined: both responses in order");
+  Check((Pcb->recved == sizeof(Stream)) && (PbufsFreed == PbufsAllocated), "pipelined: segment served and freed");
+
+  Pcb->written_len = 0;
+  Pcb->recved = 0;
+  (void)Receive(Pcb, Stream, sizeof(RequestA) + 3);
+  Check((Pcb->written_len == sizeof(RequestA)) && (Pcb->recved == sizeof(RequestA)), "pipelined: first of two served");
+  Check(PbufsFreed + 1 == PbufsAllocated, "pipelined: segment kept for the second request");
+  (void)Receive(Pcb, &Stream[sizeof(RequestA) + 3], sizeof(RequestB) - 3);
+  Check((Pcb->written_len == sizeof(Stream)) && (memcmp(Pcb->written, Stream, sizeof(Stream)) == 0),
+        "pipelined: second response");
+  Check((Pcb->recved == sizeof(Stream)) && (PbufsFreed == PbufsAllocated), "pipelined: both segments freed");
+  Disconnect(Pcb);
+}
+
+// The request waits in the queue while the send buffer has no room for a response, the window stays closed
+static void Test_SendBufferFull(void)
+{
+  struct tcp_pcb *Pcb = Connect(0);
+
+  Pcb->snd_buf = 10;
+  (void)Receive(Pcb, RequestA, sizeof(RequestA));
+  Check((Pcb->written_len == 0) && (Pcb->recved == 0), "send buffer full: request held");
+  Pcb->snd_buf = TEST_SND_BUF;
+  if (Pcb->sent != NULL)
+  {
+    (void)Pcb->sent(Pcb->callback_arg, Pcb, 10);
+  }
+  Check((Pcb->written_len == sizeof(RequestA)) && (Pcb->recved == sizeof(RequestA)),
+        "send buffer full: served when acknowledged");
+  Check(PbufsFreed == PbufsAllocated, "send buffer full: segment freed");
+  Disconnect(Pcb);
+}
+
+// A stream that is not Modbus is closed without a response, also after a valid request
+static void Test_BadHeader(void)
+{
+  struct tcp_pcb *Pcb = Connect(0);
+  uint8_t Stream[sizeof(RequestA) + sizeof(BadProtocol)];
+
+  memcpy(Stream, RequestA, sizeof(RequestA));
+  memcpy(&Stream[sizeof(RequestA)], BadProtocol, sizeof(BadProtocol));
+  (void)Receive(Pcb, Stream, sizeof(Stream));
+  Check(Pcb->closed && (Pcb->written_len == sizeof(RequestA)), "bad protocol id: closed after the valid request");
+  Check(PbufsFreed == PbufsAllocated, "bad protocol id: queue freed");
+  Disconnect(Pcb);                    // Only if it was not closed, the slot is then free for the next case
+
+  Pcb = Connect(0);
+  (void)Receive(Pcb, BadLength, sizeof(BadLength));
+  Check(Pcb->closed && (Pcb->written_len == 0), "bad length: closed");
+  Check(PbufsFreed == PbufsAllocated, "bad length: queue freed");
+  Disconnect(Pcb);
+}
+
+// The client closes with a partial request in the queue
+static void Test_CloseWithQueue(void)
+{
+  struct tcp_pcb *Pcb = Connect(0);
+
+  (void)Receive(Pcb, RequestA, 8);
+  Disconnect(Pcb);
+  Check(PbufsFreed == PbufsAllocated, "close: partial request freed");
+}
+
+// The connection after the last free slot is refused, each connection keeps its own stream
+static void Test_ConnectionLimit(void)
+{
+  struct tcp_pcb *Extra = &Clients[MODBUS_TCP_MAX_CLIENTS];
+  int Indx;
+
+  for (Indx = 0; Indx < MODBUS_TCP_MAX_CLIENTS; Indx++)
+  {
+    (void)Connect(Indx);
+    (void)Receive(&Clients[Indx], RequestA, 5);
+  }
+  memset(Extra, 0, sizeof(*Extra));
+  Check((ListenPcb.accept(NULL, Extra, ERR_OK) == ERR_ABRT) && Extra->aborted, "limit: extra connection refused");
+  for (Indx = 0; Indx < MODBUS_TCP_MAX_CLIENTS; Indx++)
+  {
+    (void)Receive(&Clients[Indx], &RequestA[5], sizeof(RequestA) - 5);
+    Check(Clients[Indx].written_len == sizeof(RequestA), "limit: each connection served");
+    Disconnect(&Clients[Indx]);
+  }
+  Check(PbufsFreed == PbufsAllocated, "limit: all segments freed");
+}
+
+int main(void)
+{
+  ModbusTcp_Init();
+  Check(ListenPcb.accept != NULL, "listening");
+
+  Test_SplitSegments();
+  Test_Pipelined();
+  Test_SendBufferFull();
+  Test_BadHeader();
+  Test_CloseWithQueue();
+  Test_ConnectionLimit();
+  Check(ServedUnlocked == 0, "served with Scheduler_Lock() held");
+
+  printf("ModbusTcp: %u of %u checks passed, %s\n", Checks - Failures, Checks, (Failures == 0) ? "PASS" : "FAIL");
+  return (Failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,521 @@
+/**
+******************************************************************************
+* @file    /IDE/SIL/Src/Sil_Peripherals.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Register level models of the peripherals the application drives directly:
+*          - Free running capture timers (TIM2..TIM5) and update interrupt timers (TIM6, TIM7, TIM13, TIM14)
+*          - USART3/USART6 with their DMA streams. Bytes take real wire time at the configured baud rate.
+*          - DWT cycle counter and SysTick counter
+*          Models access registers through Sil_Alias() so that they do not trigger read side effects.
+******************************************************************************
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include "Sil.h"
+
+#define SIL_TIMER_CYCLES_PER_TICK(Tim)  ((SIL_CPU_FREQ / SIL_APB1_TIMER_FREQ) * ((uint64_t)(Tim)->PSC + 1U))
+
+// DMA interrupt flags, relative to the flag position of the stream in LISR/HISR
+#define DMA_FLAG_TE   0x08U
+#define DMA_FLAG_HT   0x10U
+#define DMA_FLAG_TC   0x20U
+
+typedef struct
+{
+  TIM_TypeDef *Tim;
+  IRQn_Type Irq;
+  int Running;
+  int Event;
+  uint64_t PeriodStart;
+} Sil_UpdateTimer;
+
+typedef struct
+{
+  DMA_TypeDef *Dma;
+  DMA_Stream_TypeDef *Stream;
+  uint32_t StreamNo;
+  IRQn_Type Irq;
+} Sil_DmaStream;
+
+typedef struct
+{
+  USART_TypeDef *Usart;
+  IRQn_Type Irq;
+  uint64_t PclkFreq;
+  Sil_DmaStream Rx;
+  Sil_DmaStream Tx;
+  Sil_UartSink Sink;
+  // Receiver
+  uint32_t RxReload;        // NDTR value at start of current cycle (circular reload)
+  uint32_t RxShadowNdtr;
+  int RxShadowEn;
+  int IdleEvent;
+  // Transmitter
+  int TxBusy;
+  int TxEvent;
+  uint32_t TxLength;
+  uint32_t TxAddress;
+  uint64_t TxLineFree;      // Time when the shift register has sent its last bit
+} Sil_Uart;
+
+static Sil_UpdateTimer UpdateTimers[] =
+{
+  { TIM6, TIM6_DAC_IRQn, 0, -1, 0 },
+  { TIM7, TIM7_IRQn, 0, -1, 0 },
+  { TIM13, TIM8_UP_TIM13_IRQn, 0, -1, 0 },
+  { TIM14, TIM8_TRG_COM_TIM14_IRQn, 0, -1, 0 },
+};
+#define NUM_UPDATE_TIMERS  (sizeof(UpdateTimers) / sizeof(UpdateTimers[0]))
+
+static Sil_Uart Uarts[] =
+{
+  { .Usart = USART3, .Irq = USART3_IRQn, .PclkFreq = SIL_PCLK1_FREQ,
+    .Rx = { DMA1, DMA1_Stream1, 1, DMA1_Stream1_IRQn }, .Tx = { DMA1, DMA1_Stream3, 3, DMA1_Stream3_IRQn } },
+  { .Usart = USART6, .Irq = USART6_IRQn, .PclkFreq = SIL_PCLK2_FREQ,
+    .Rx = { DMA2, DMA2_Stream1, 1, DMA2_Stream1_IRQn }, .Tx = { DMA2, DMA2_Stream7, 7, DMA2_Stream7_IRQn } },
+};
+#define NUM_UARTS  (sizeof(Uarts) / sizeof(Uarts[0]))
+
+static volatile uint16_t *AdcBuffer;
+static uint32_t AdcLength;
+
+// -----------------------------------------------------------------------
+// ------ Timers ------
+
+static void Sil_UpdateTimerEvent(void *Arg)
+{
+  Sil_UpdateTimer *Ut = (Sil_UpdateTimer *)Arg;
+  TIM_TypeDef *Tim = Sil_Alias(Ut->Tim);
+
+  Ut->Event = -1;
+  if (!(Tim->CR1 & TIM_CR1_CEN))
+  {
+    Ut->Running = 0;
+    return;
+  }
+  Tim->SR |= TIM_SR_UIF;
+  if (Tim->DIER & TIM_DIER_UIE)
+  {
+    Sil_PendIrq(Ut->Irq);
+  }
+  if (Tim->CR1 & TIM_CR1_OPM)
+  {
+    Tim->CR1 &= ~TIM_CR1_CEN;
+    Ut->Running = 0;
+    return;
+  }
+  Ut->PeriodStart = Sil_Now();
+  Tim->CNT = 0U;              // Counters were updated before the event fired
+  Ut->Event = Sil_ScheduleEvent(Ut->PeriodStart + ((uint64_t)Tim->ARR + 1U) * SIL_TIMER_CYCLES_PER_TICK(Tim), Sil_UpdateTimerEvent, Ut);
+}
+
+static void Sil_UpdateTimersPoll(void)
+{
+  for (uint32_t i = 0; i < NUM_UPDATE_TIMERS; i++)
+  {
+    Sil_UpdateTimer *Ut = &UpdateTimers[i];
+    TIM_TypeDef *Tim = Sil_Alias(Ut->Tim);
+
+    if (Tim->EGR & TIM_EGR_UG)
+    {
+      // Update generation restarts the count from 0 (the update flag is not set, as with URS)
+      Tim->EGR = 0U;
+      Tim->CNT = 0U;
+      if (Ut->Running)
+      {
+        Sil_CancelEvent(Ut->Event);
+        Ut->Event = -1;
+        Ut->Running = 0;
+      }
+    }
+    if ((Tim->CR1 & TIM_CR1_CEN) && !Ut->Running)
+    {
+      // Counting starts from the current CNT value, i.e. the first period can be shortened by writing CNT
+      uint64_t Remaining = ((uint64_t)Tim->ARR + 1U) - ((Tim->CNT <= Tim->ARR) ? Tim->CNT : 0U);
+
+      Ut->Running = 1;
+      Ut->PeriodStart = Sil_Now() - (uint64_t)Tim->CNT * SIL_TIMER_CYCLES_PER_TICK(Tim);
+      Ut->Event = Sil_ScheduleEvent(Sil_Now() + Remaining * SIL_TIMER_CYCLES_PER_TICK(Tim), Sil_UpdateTimerEvent, Ut);
+    }
+    else if (!(Tim->CR1 & TIM_CR1_CEN) && Ut->Running)
+    {
+      Sil_CancelEvent(Ut->Event);
+      Ut->Event = -1;
+      Ut->Running = 0;
+    }
+  }
+}
+
+// Reads of TIM2..TIM5 are trapped while a capture flag is set, reading CCRx clears it
+static void Sil_TimUpdateTrap(void)
+{
+  TIM_TypeDef *Tims[4] = { TIM2, TIM3, TIM4, TIM5 };
+  int Armed = 0;
+
+  for (uint32_t i = 0; i < 4U; i++)
+  {
+    TIM_TypeDef *T = Sil_Alias(Tims[i]);
+    Armed |= (T->SR & (TIM_SR_CC1IF | TIM_SR_CC2IF | TIM_SR_CC3IF | TIM_SR_CC4IF)) != 0U;
+  }
+  Sil_SetReadTrap(TIM2, Armed);
+}
+
+// Capture the current counter value on an input capture channel (TIM_CHANNEL_x)
+void Sil_TimCapture(TIM_TypeDef *Tim, uint32_t Channel)
+{
+  TIM_TypeDef *T = Sil_Alias(Tim);
+  uint32_t Index = Channel / 4U;
+  uint32_t Flag = TIM_SR_CC1IF << Index;
+  IRQn_Type Irq = (Tim == TIM2) ? TIM2_IRQn : TIM5_IRQn;
+
+  if (!(T->CR1 & TIM_CR1_CEN))
+  {
+    return;
+  }
+  (&T->CCR1)[Index] = T->CNT;
+  if (T->SR & Flag)
+  {
+    T->SR |= (Flag << 8);     // Over-capture, CCxOF
+  }
+  T->SR |= Flag;
+  Sil_TimUpdateTrap();
+  if (T->DIER & (TIM_DIER_CC1IE << Index))
+  {
+    Sil_PendIrq(Irq);
+  }
+}
+
+// -----------------------------------------------------------------------
+// ------ USART and DMA ------
+
+static Sil_Uart *Sil_FindUart(USART_TypeDef *Usart)
+{
+  for (uint32_t i = 0; i < NUM_UARTS; i++)
+  {
+    if (Uarts[i].Usart == Usart)
+    {
+      return &Uarts[i];
+    }
+  }
+  return NULL;
+}
+
+// Reads of the USART are trapped while a flag cleared by reading DR is set
+static void Sil_UartUpdateTrap(const Sil_Uart *U)
+{
+  USART_TypeDef *Reg = Sil_Alias(U->Usart);
+
+  Sil_SetReadTrap(U->Usart, (Reg->SR & (USART_SR_RXNE | USART_SR_IDLE | USART_SR_ORE | USART_SR_FE | USART_SR_NE | USART_SR_PE)) != 0U);
+}
+
+static volatile uint32_t *Sil_DmaIsr(const Sil_DmaStream *Ds)
+{
+  DMA_TypeDef *Dma = Sil_Alias(Ds->Dma);
+  return (Ds->StreamNo < 4U) ? &Dma->LISR : &Dma->HISR;
+}
+
+static uint32_t Sil_DmaFlagShift(const Sil_DmaStream *Ds)
+{
+  static const uint32_t Shift[4] = { 0U, 6U, 16U, 22U };
+  return Shift[Ds->StreamNo % 4U];
+}
+
+static void Sil_DmaSetFlag(const Sil_DmaStream *Ds, uint32_t Flag)
+{
+  DMA_Stream_TypeDef *St = Sil_Alias(Ds->Stream);
+
+  *Sil_DmaIsr(Ds) |= Flag << Sil_DmaFlagShift(Ds);
+  if (((Flag & DMA_FLAG_TC) && (St->CR & DMA_SxCR_TCIE)) || ((Flag & DMA_FLAG_HT) && (St->CR & DMA_SxCR_HTIE)))
+  {
+    Sil_PendIrq(Ds->Irq);
+  }
+}
+
+uint32_t Sil_UartBaudRate(USART_TypeDef *Usart)
+{
+  Sil_Uart *U = Sil_FindUart(Usart);
+  USART_TypeDef *Reg = Sil_Alias(Usart);
+
+  if (U == NULL || Reg->BRR == 0U)
+  {
+    return 0U;
+  }
+  return (uint32_t)(U->PclkFreq / Reg->BRR);
+}
+
+// Time for one character on the wire: start bit, data bits (incl. parity) and stop bits
+uint64_t Sil_UartCharTime(USART_TypeDef *Usart)
+{
+  USART_TypeDef *Reg = Sil_Alias(Usart);
+  uint64_t Bits = 10U;
+  uint32_t Baud = Sil_UartBaudRate(Usart);
+
+  if (Reg->CR1 & USART_CR1_M)
+  {
+    Bits++;
+  }
+  if (Reg->CR2 & USART_CR2_STOP_1)
+  {
+    Bits++;
+  }
+  return (Baud != 0U) ? (Bits * SIL_CPU_FREQ + Baud - 1U) / Baud : SIL_CPU_FREQ;
+}
+
+void Sil_UartSetSink(USART_TypeDef *Usart, Sil_UartSink Sink)
+{
+  Sil_Uart *U = Sil_FindUart(Usart);
+
+  if (U != NULL)
+  {
+    U->Sink = Sink;
+  }
+}
+
+static void Sil_UartIdleEvent(void *Arg)
+{
+  Sil_Uart *U = (Sil_Uart *)Arg;
+  USART_TypeDef *Reg = Sil_Alias(U->Usart);
+
+  U->IdleEvent = -1;
+  Reg->SR |= USART_SR_IDLE;
+  Sil_UartUpdateTrap(U);
+  if (Reg->CR1 & USART_CR1_IDLEIE)
+  {
+    Sil_PendIrq(U->Irq);
+  }
+}
+
+// A byte has been completely received (stop bit) on the Rx pin of the USART
+void Sil_UartRxByte(USART_TypeDef *Usart, uint8_t Byte)
+{
+  Sil_Uart *U = Sil_FindUart(Usart);
+  USART_TypeDef *Reg = Sil_Alias(Usart);
+
+  if (U == NULL || (Reg->CR1 & (USART_CR1_UE | USART_CR1_RE)) != (USART_CR1_UE | USART_CR1_RE))
+  {
+    return;
+  }
+  Sil_PeripheralsPoll();
+  Reg->SR &= ~USART_SR_IDLE;
+
+  DMA_Stream_TypeDef *St = Sil_Alias(U->Rx.Stream);
+  if ((Reg->CR3 & USART_CR3_DMAR) && (St->CR & DMA_SxCR_EN) && St->NDTR != 0U)
+  {
+    uint32_t Index = U->RxReload - St->NDTR;
+
+    *(uint8_t *)(uintptr_t)(St->M0AR + ((St->CR & DMA_SxCR_MINC) ? Index : 0U)) = Byte;
+    St->NDTR--;
+    if (St->NDTR == U->RxReload / 2U)
+    {
+      Sil_DmaSetFlag(&U->Rx, DMA_FLAG_HT);
+    }
+    if (St->NDTR == 0U)
+    {
+      Sil_DmaSetFlag(&U->Rx, DMA_FLAG_TC);
+      if (St->CR & DMA_SxCR_CIRC)
+      {
+        St->NDTR = U->RxReload;
+      }
+      else
+      {
+        St->CR &= ~DMA_SxCR_EN;
+      }
+    }
+    U->RxShadowNdtr = St->NDTR;
+    U->RxShadowEn = (St->CR & DMA_SxCR_EN) != 0U;
+  }
+  else
+  {
+    if (Reg->SR & USART_SR_RXNE)
+    {
+      Reg->SR |= USART_SR_ORE;
+    }
+    Reg->DR = Byte;
+    Reg->SR |= USART_SR_RXNE;
+    Sil_UartUpdateTrap(U);
+    if (Reg->CR1 & USART_CR1_RXNEIE)
+    {
+      Sil_PendIrq(U->Irq);
+    }
+  }
+
+  // Idle line is detected when a full character time has passed without a new start bit
+  Sil_CancelEvent(U->IdleEvent);
+  U->IdleEvent = Sil_ScheduleEvent(Sil_Now() + Sil_UartCharTime(Usart), Sil_UartIdleEvent, U);
+}
+
+static void Sil_UartTxCompleteEvent(void *Arg)
+{
+  Sil_Uart *U = (Sil_Uart *)Arg;
+  USART_TypeDef *Reg = Sil_Alias(U->Usart);
+
+  if (!U->TxBusy && Sil_Now() >= U->TxLineFree)
+  {
+    Reg->SR |= USART_SR_TC;
+    if (Reg->CR1 & USART_CR1_TCIE)
+    {
+      Sil_PendIrq(U->Irq);
+    }
+  }
+}
+
+// DMA has moved the last byte of the block to DR. One character remains in the shift register.
+static void Sil_UartTxDmaDoneEvent(void *Arg)
+{
+  Sil_Uart *U = (Sil_Uart *)Arg;
+  DMA_Stream_TypeDef *St = Sil_Alias(U->Tx.Stream);
+
+  U->TxEvent = -1;
+  U->TxBusy = 0;
+  if (U->Sink != NULL)
+  {
+    U->Sink((const uint8_t *)(uintptr_t)U->TxAddress, U->TxLength);
+  }
+  St->NDTR = 0U;
+  St->CR &= ~DMA_SxCR_EN;
+  Sil_DmaSetFlag(&U->Tx, DMA_FLAG_TC);
+  (void)Sil_ScheduleEvent(U->TxLineFree, Sil_UartTxCompleteEvent, U);
+}
+
+static void Sil_UartPoll(Sil_Uart *U)
+{
+  USART_TypeDef *Reg = Sil_Alias(U->Usart);
+  DMA_Stream_TypeDef *Rx = Sil_Alias(U->Rx.Stream);
+  DMA_Stream_TypeDef *Tx = Sil_Alias(U->Tx.Stream);
+  int RxEn = (Rx->CR & DMA_SxCR_EN) != 0U;
+
+  // Receiver: a (re)started stream starts a new cycle with the programmed length
+  if ((RxEn && !U->RxShadowEn) || (RxEn && Rx->NDTR > U->RxShadowNdtr))
+  {
+    U->RxReload = Rx->NDTR;
+  }
+  U->RxShadowEn = RxEn;
+  U->RxShadowNdtr = Rx->NDTR;
+
+  // Transmitter: a started stream sends NDTR bytes from M0AR. DR is free one character before the line is.
+  if (!U->TxBusy && (Tx->CR & DMA_SxCR_EN) && Tx->NDTR != 0U && (Reg->CR3 & USART_CR3_DMAT) && (Reg->CR1 & USART_CR1_TE))
+  {
+    uint64_t CharTime = Sil_UartCharTime(U->Usart);
+    uint64_t Start = Sil_Now();
+
+    if (U->TxLineFree > Start)
+    {
+      Start = U->TxLineFree;      // Chained transfer: the first byte waits in DR until the shift register is free
+    }
+    U->TxBusy = 1;
+    U->TxLength = Tx->NDTR;
+    U->TxAddress = Tx->M0AR;
+    U->TxLineFree = Start + U->TxLength * CharTime;
+    Reg->SR &= ~USART_SR_TC;
+    U->TxEvent = Sil_ScheduleEvent(U->TxLineFree - CharTime, Sil_UartTxDmaDoneEvent, U);
+  }
+  else if (U->TxBusy && !(Tx->CR & DMA_SxCR_EN))
+  {
+    // Transfer aborted by the application
+    Sil_CancelEvent(U->TxEvent);
+    U->TxEvent = -1;
+    U->TxBusy = 0;
+    U->TxLineFree = Sil_Now();
+  }
+}
+
+// -----------------------------------------------------------------------
+
+void Sil_RegisterRead(uintptr_t Address)
+{
+  // Timer capture registers: reading CCRx clears CCxIF
+  if (Address >= (uintptr_t)TIM2 && Address < (uintptr_t)TIM5 + sizeof(TIM_TypeDef))
+  {
+    TIM_TypeDef *Tim = (TIM_TypeDef *)(Address & ~0x3FFUL);
+    uintptr_t Offset = Address - (uintptr_t)Tim;
+
+    if (Offset >= offsetof(TIM_TypeDef, CCR1) && Offset <= offsetof(TIM_TypeDef, CCR4))
+    {
+      TIM_TypeDef *T = Sil_Alias(Tim);
+      T->SR &= ~(TIM_SR_CC1IF << ((Offset - offsetof(TIM_TypeDef, CCR1)) / 4U));
+      Sil_TimUpdateTrap();
+    }
+    return;
+  }
+  // USART data register: reading DR clears RXNE, and (after a read of SR) IDLE and the error flags
+  for (uint32_t i = 0; i < NUM_UARTS; i++)
+  {
+    if (Address == (uintptr_t)&Uarts[i].Usart->DR)
+    {
+      USART_TypeDef *Reg = Sil_Alias(Uarts[i].Usart);
+      Reg->SR &= ~(USART_SR_RXNE | USART_SR_IDLE | USART_SR_ORE | USART_SR_FE | USART_SR_NE | USART_SR_PE);
+      Sil_UartUpdateTrap(&Uarts[i]);
+    }
+  }
+}
+
+void Sil_AdcSetBuffer(volatile uint16_t *Buffer, uint32_t Length)
+{
+  AdcBuffer = Buffer;
+  AdcLength = Length;
+  Sil_PlantAdcUpdate(AdcBuffer, AdcLength);
+}
+
+void Sil_PeripheralsInit(void)
+{
+  for (uint32_t i = 0; i < NUM_UARTS; i++)
+  {
+    USART_TypeDef *Reg = Sil_Alias(Uarts[i].Usart);
+
+    Reg->SR = USART_SR_TC | USART_SR_TXE;   // Reset value
+    Uarts[i].IdleEvent = -1;
+    Uarts[i].TxEvent = -1;
+  }
+  CoreDebug->DEMCR = 0U;
+  DWT->CTRL = 0x40000000U;   // Number of comparators, counter disabled
+}
+
+void Sil_PeripheralsPoll(void)
+{
+  // Flag clear registers of the DMA controllers
+  DMA_TypeDef *Dma[2] = { DMA1, DMA2 };
+  for (uint32_t i = 0; i < 2U; i++)
+  {
+    Dma[i]->LISR &= ~Dma[i]->LIFCR;
+    Dma[i]->HISR &= ~Dma[i]->HIFCR;
+    Dma[i]->LIFCR = 0U;
+    Dma[i]->HIFCR = 0U;
+  }
+  Sil_UpdateTimersPoll();
+  for (uint32_t i = 0; i < NUM_UARTS; i++)
+  {
+    Sil_UartPoll(&Uarts[i]);
+    Sil_UartUpdateTrap(&Uarts[i]);     // The application may also clear flags by writing SR
+  }
+  Sil_TimUpdateTrap();
+}
+
+void Sil_PeripheralsUpdateCounters(uint64_t Now)
+{
+  TIM_TypeDef *Free[2] = { Sil_Alias(TIM2), Sil_Alias(TIM5) };
+
+  for (uint32_t i = 0; i < 2U; i++)
+  {
+    if (Free[i]->CR1 & TIM_CR1_CEN)
+    {
+      uint64_t Modulo = (uint64_t)Free[i]->ARR + 1U;
+      Free[i]->CNT = (uint32_t)((Now / SIL_TIMER_CYCLES_PER_TICK(Free[i])) % Modulo);
+    }
+  }
+  for (uint32_t i = 0; i < NUM_UPDATE_TIMERS; i++)
+  {
+    if (UpdateTimers[i].Running)
+    {
+      TIM_TypeDef *Tim = Sil_Alias(UpdateTimers[i].Tim);
+      Tim->CNT = (uint32_t)((Now - UpdateTimers[i].PeriodStart) / SIL_TIMER_CYCLES_PER_TICK(Tim));
+    }
+  }
+  if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)
+  {
+    DWT->CYCCNT = (uint32_t)Now;
+  }
+  SysTick->VAL = (uint32_t)(SysTick->LOAD - (Now % (SysTick->LOAD + 1U)));
+}
@@ -0,0 +1,486 @@
+/**
+******************************************************************************
+* @file    /IDE/SIL/Src/Sil_Plant.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   The world outside the MCU in the SIL build:
+*          - Speed sensor pulses on TIM2 CH1..CH3 (IG53 A/B with 90 degrees phase lag, M5)
+*          - ADC input values
+*          - A Modbus master polling the slave on USART6 and checking every response. It keeps t3.5 between the
+*            frames and can step the slave through its baud rates, measuring the requests per second at each.
+*            It can first run a script of requests of all function codes, checking the responses byte by byte.
+*          - The terminal on USART3, written to stdout and/or a file, and a user typing the lines of a file on it
+******************************************************************************
+*/
+
+#include <string.h>
+#include "Sil.h"
+#include "Crc.h"
+
+#define MODBUS_SLAVE_ADDRESS   0x0A
+#define MODBUS_NUM_SIGNALS     8
+#define MODBUS_TIMEOUT_MS      200
+#define MODBUS_MAX_FRAME       256
+#define MODBUS_BAUD_RATE_REG   0x1008   // FC 6 register of the parameter E2P_MODBUS_BAUD_RATE
+#define MODBUS_NUM_BAUD_RATES  8        // Its values
+#define MODBUS_SWEEP_MS        1000     // Requests at each baud rate
+#define MODBUS_SWEEP_SETTLE_MS 20       // The slave changes the baud rate after the response, at its next 4 ms tick
+#define TERMINAL_INPUT_START_MS 1000    // After boot
+#define TERMINAL_LINE_PAUSE_MS  300     // After each line, for the output of the command
+#define TERMINAL_MAX_INPUT      4096
+
+typedef struct
+{
+  uint32_t Channel;
+  uint64_t Period;           // CPU cycles
+  uint64_t Phase;            // CPU cycles
+} Sil_SpeedSensor;
+
+typedef struct
+{
+  uint32_t BaudRate;
+  uint32_t Ok;
+  uint32_t Errors;
+  uint32_t Timeouts;
+} Sil_ModbusRate;
+
+// A request of the function code script and its expected response, both without address and CRC
+typedef struct
+{
+  const char *Name;
+  uint8_t  Request[32];
+  uint16_t RequestLength;
+  uint8_t  Response[32];
+  uint16_t ResponseLength;
+  uint16_t CompareLength;    // Leading bytes of the response compared, 0 = all
+} Sil_ModbusStep;
+
+typedef struct
+{
+  uint8_t  Request[MODBUS_MAX_FRAME];
+  uint16_t RequestLength;
+  uint16_t TxIndx;
+  uint16_t ExpectedLength;
+  uint64_t RequestEnd;       // Time when the last byte of the request has been received by the slave
+  uint8_t  Response[MODBUS_MAX_FRAME];   // Assembled from the DMA blocks of the slave, it may send a frame in several
+  uint16_t ResponseLength;
+  uint64_t ResponseStart;    // Time when the first byte of the response was on the line
+  uint64_t LineFree;         // Time when the last byte of the response has been sent
+  int      TimeoutEvent;
+  uint32_t Requests;
+  uint32_t Ok;
+  uint32_t Errors;
+  uint32_t Timeouts;
+  uint64_t LatencyMin;
+  uint64_t LatencyMax;
+  uint64_t LatencySum;
+  uint32_t SweepIndx;        // Baud rates set so far
+  uint64_t SweepEnd;         // End of the measurement at the current baud rate
+  Sil_ModbusRate Rates[MODBUS_NUM_BAUD_RATES];
+  const Sil_ModbusStep *Step;  // Script request waiting for its response
+  uint32_t StepIndx;         // Script requests sent so far
+  uint32_t StepsFailed;
+} Sil_ModbusMaster;
+
+static Sil_SpeedSensor SpeedSensors[] =
+{
+  { TIM_CHANNEL_1, SIL_US_TO_CYCLES(5000), 0 },      // IG53A, 200 Hz
+  { TIM_CHANNEL_2, SIL_US_TO_CYCLES(5000), SIL_US_TO_CYCLES(1250) },   // IG53B, 90 degrees after A
+  { TIM_CHANNEL_3, SIL_US_TO_CYCLES(10000), SIL_US_TO_CYCLES(300) },   // M5, 100 Hz
+};
+#define NUM_SPEED_SENSORS  (sizeof(SpeedSensors) / sizeof(SpeedSensors[0]))
+
+// Parameters 0..6 are set as a calibration set and read back, parameter 7 (0..2) is written as coils 0x70..0x7F.
+// The 32-bit signals from 0x2000 are the uptime and the core clock.
+#define STEP(NAME, REQUEST, RESPONSE)  { NAME, REQUEST, sizeof((uint8_t[])REQUEST), RESPONSE, sizeof((uint8_t[])RESPONSE), 0 }
+#define BYTES(...)                     { __VA_ARGS__ }
+static const Sil_ModbusStep ModbusScript[] =
+{
+  STEP("FC 16 calibration set", BYTES(0x10, 0x10, 0x00, 0x00, 0x07, 0x0E, 0x03, 0x2A, 0x02, 0x62, 0x00, 0xD2, 0x02, 0xC6,
+                                      0x00, 0xA0, 0x01, 0x68, 0x02, 0xC6),
+       BYTES(0x10, 0x10, 0x00, 0x00, 0x07)),
+  STEP("FC 3 read back", BYTES(0x03, 0x10, 0x00, 0x00, 0x07),
+       BYTES(0x03, 0x0E, 0x03, 0x2A, 0x02, 0x62, 0x00, 0xD2, 0x02, 0xC6, 0x00, 0xA0, 0x01, 0x68, 0x02, 0xC6)),
+  STEP("FC 16 above max", BYTES(0x10, 0x10, 0x04, 0x00, 0x02, 0x04, 0x00, 0x64, 0x0B, 0xB8), BYTES(0x90, 0x03)),
+  STEP("FC 3 nothing written", BYTES(0x03, 0x10, 0x04, 0x00, 0x02), BYTES(0x03, 0x04, 0x00, 0xA0, 0x01, 0x68)),
+  STEP("FC 23 write and read", BYTES(0x17, 0x10, 0x00, 0x00, 0x02, 0x10, 0x02, 0x00, 0x01, 0x02, 0x00, 0xDC),
+       BYTES(0x17, 0x04, 0x03, 0x2A, 0x02, 0x62)),
+  STEP("FC 4 parameter", BYTES(0x04, 0x10, 0x02, 0x00, 0x01), BYTES(0x04, 0x02, 0x00, 0xDC)),
+  STEP("FC 6 single register", BYTES(0x06, 0x10, 0x07, 0x00, 0x01), BYTES(0x06, 0x10, 0x07, 0x00, 0x01)),
+  STEP("FC 1 coils", BYTES(0x01, 0x00, 0x70, 0x00, 0x03), BYTES(0x01, 0x01, 0x01)),
+  STEP("FC 5 above max", BYTES(0x05, 0x00, 0x71, 0xFF, 0x00), BYTES(0x85, 0x03)),
+  STEP("FC 5 bad value", BYTES(0x05, 0x00, 0x70, 0x12, 0x34), BYTES(0x85, 0x03)),
+  STEP("FC 5 single coil", BYTES(0x05, 0x00, 0x70, 0x00, 0x00), BYTES(0x05, 0x00, 0x70, 0x00, 0x00)),
+  STEP("FC 15 coils", BYTES(0x0F, 0x00, 0x70, 0x00, 0x02, 0x01, 0x02), BYTES(0x0F, 0x00, 0x70, 0x00, 0x02)),
+  STEP("FC 3 coils written", BYTES(0x03, 0x10, 0x07, 0x00, 0x01), BYTES(0x03, 0x02, 0x00, 0x02)),
+  { "FC 2 discrete inputs", BYTES(0x02, 0x00, 0x00, 0x00, 0x10), 5, BYTES(0x02, 0x02, 0x00, 0x00), 4, 2 },
+  STEP("FC 3 past the end", BYTES(0x03, 0x10, 0x00, 0x00, 0x0A), BYTES(0x83, 0x02)),
+  STEP("FC 3 no registers", BYTES(0x03, 0x00, 0x00, 0x00, 0x00), BYTES(0x83, 0x03)),
+  STEP("FC 6 read only", BYTES(0x06, 0x00, 0x00, 0x00, 0x01), BYTES(0x86, 0x02)),
+  STEP("FC 16 byte count", BYTES(0x10, 0x10, 0x00, 0x00, 0x02, 0x03, 0x00, 0x01, 0x02), BYTES(0x90, 0x03)),
+  STEP("FC 8 unsupported", BYTES(0x08, 0x00, 0x00, 0x12, 0x34), BYTES(0x88, 0x01)),
+  STEP("FC 4 32-bit core clock", BYTES(0x04, 0x20, 0x02, 0x00, 0x02), BYTES(0x04, 0x04, 0x0A, 0xBA, 0x95, 0x00)),
+  STEP("FC 4 32-bit past the end", BYTES(0x04, 0x20, 0x02, 0x00, 0x03), BYTES(0x84, 0x02)),
+  STEP("FC 16 32-bit read only", BYTES(0x10, 0x20, 0x00, 0x00, 0x02, 0x04, 0x00, 0x00, 0x00, 0x01), BYTES(0x90, 0x02)),
+  STEP("FC 3 unmapped", BYTES(0x03, 0x08, 0x00, 0x00, 0x01), BYTES(0x83, 0x02)),
+};
+#define MODBUS_NUM_STEPS  (sizeof(ModbusScript) / sizeof(ModbusScript[0]))
+
+static Sil_ModbusMaster Master;
+static FILE *TerminalOut;
+static char TerminalInput[TERMINAL_MAX_INPUT];
+static size_t TerminalInputLength;
+static size_t TerminalInputIndx;
+
+// -----------------------------------------------------------------------
+// ------ Sensors ------
+
+static void Sil_SpeedSensorEvent(void *Arg)
+{
+  Sil_SpeedSensor *Sensor = (Sil_SpeedSensor *)Arg;
+
+  Sil_TimCapture(TIM2, Sensor->Channel);
+  (void)Sil_ScheduleEvent(Sil_Now() + Sensor->Period, Sil_SpeedSensorEvent, Sensor);
+}
+
+void Sil_PlantAdcUpdate(volatile uint16_t *Buffer, uint32_t Length)
+{
+  for (uint32_t i = 0; i < Length; i++)
+  {
+    Buffer[i] = (uint16_t)(1000U + 500U * (i % 2U) + (uint32_t)((Sil_Now() / SIL_CYCLES_PER_MS) % 16U));
+  }
+}
+
+// -----------------------------------------------------------------------
+// ------ Modbus master ------
+
+static void Sil_ModbusSendRequest(void *Arg);
+
+// Silence the slave needs to find the end of a frame
+static uint64_t Sil_ModbusT35(void)
+{
+  return (Sil_UartBaudRate(USART6) > 19200U) ? SIL_US_TO_CYCLES(1750U) : (7U * Sil_UartCharTime(USART6) + 1U) / 2U;
+}
+
+// The measurement at the current baud rate of the sweep, NULL if none
+static Sil_ModbusRate *Sil_ModbusSweepRate(void)
+{
+  if (!SilConfig.ModbusRateSweep || (Master.SweepIndx == 0U) || (Sil_Now() > Master.SweepEnd))
+  {
+    return NULL;
+  }
+  return &Master.Rates[Master.SweepIndx - 1U];
+}
+
+static void Sil_ModbusNextRequest(void)
+{
+  uint64_t Next = Sil_Now() + SIL_US_TO_CYCLES(1000U * SilConfig.ModbusPeriodMs);
+  uint64_t Silence = Master.LineFree + Sil_ModbusT35();
+
+  Sil_CancelEvent(Master.TimeoutEvent);
+  Master.TimeoutEvent = -1;
+  (void)Sil_ScheduleEvent((Next > Silence) ? Next : Silence, Sil_ModbusSendRequest, NULL);
+}
+
+static void Sil_ModbusTimeout(void *Arg)
+{
+  Sil_ModbusRate *Rate = Sil_ModbusSweepRate();
+
+  Master.TimeoutEvent = -1;
+  Master.Timeouts++;
+  if (Master.Step != NULL)
+  {
+    fprintf(stderr, "SIL: Modbus %s: no response\n", Master.Step->Name);
+    Master.StepsFailed++;
+    Master.Step = NULL;
+  }
+  if (Rate != NULL)
+  {
+    Rate->Timeouts++;
+  }
+  Sil_ModbusNextRequest();
+}
+
+static void Sil_ModbusTxByte(void *Arg)
+{
+  Sil_UartRxByte(USART6, Master.Request[Master.TxIndx++]);
+  if (Master.TxIndx < Master.RequestLength)
+  {
+    (void)Sil_ScheduleEvent(Sil_Now() + Sil_UartCharTime(USART6), Sil_ModbusTxByte, NULL);
+  }
+  else
+  {
+    Master.RequestEnd = Sil_Now();
+    Master.TimeoutEvent = Sil_ScheduleEvent(Sil_Now() + SIL_US_TO_CYCLES(1000U * MODBUS_TIMEOUT_MS), Sil_ModbusTimeout, NULL);
+  }
+}
+
+// Sends the PDU (function code and data) with the address and CRC added
+static void Sil_ModbusSend(const uint8_t *Pdu, uint16_t Length, uint16_t ExpectedLength)
+{
+  uint16_t Crc;
+
+  Master.Request[0] = MODBUS_SLAVE_ADDRESS;
+  memcpy(&Master.Request[1], Pdu, Length);
+  Crc = Crc_CalcCrc16(Master.Request, (uint16_t)(Length + 1U));
+  Master.Request[Length + 1U] = (uint8_t)Crc;
+  Master.Request[Length + 2U] = (uint8_t)(Crc >> 8);
+  Master.RequestLength = (uint16_t)(Length + 3U);
+  Master.ExpectedLength = ExpectedLength;
+  Master.TxIndx = 0;
+  Master.ResponseLength = 0;
+  Master.Requests++;
+  (void)Sil_ScheduleEvent(Sil_Now() + Sil_UartCharTime(USART6), Sil_ModbusTxByte, NULL);
+}
+
+static void Sil_ModbusRequest(uint8_t Function, uint16_t Address, uint16_t Value, uint16_t ExpectedLength)
+{
+  const uint8_t Pdu[] = { Function, (uint8_t)(Address >> 8), (uint8_t)Address, (uint8_t)(Value >> 8), (uint8_t)Value };
+
+  Sil_ModbusSend(Pdu, sizeof(Pdu), ExpectedLength);
+}
+
+// The script runs first, if enabled. Then FC 4, read all exported signals. In the sweep the baud rate is changed (FC 6) when the time at the current one is up.
+static void Sil_ModbusSendRequest(void *Arg)
+{
+  if (Sil_UartBaudRate(USART6) == 0U)
+  {
+    Sil_ModbusNextRequest();    // Slave not initialized yet
+  }
+  else if (SilConfig.ModbusScript && (Master.StepIndx < MODBUS_NUM_STEPS))
+  {
+    Master.Step = &ModbusScript[Master.StepIndx++];
+    Sil_ModbusSend(Master.Step->Request, Master.Step->RequestLength, (uint16_t)(Master.Step->ResponseLength + 3U));
+  }
+  else if (!SilConfig.ModbusRateSweep || (Sil_Now() < Master.SweepEnd))
+  {
+    Sil_ModbusRequest(4, 0x0000, MODBUS_NUM_SIGNALS, 5 + 2 * MODBUS_NUM_SIGNALS);
+  }
+  else if (Master.SweepIndx < MODBUS_NUM_BAUD_RATES)
+  {
+    Sil_ModbusRequest(6, MODBUS_BAUD_RATE_REG, (uint16_t)Master.SweepIndx, 8);
+  }
+}
+
+static void Sil_ModbusCheckResponse(void)
+{
+  const uint8_t *Data = Master.Response;
+  uint16_t Length = Master.ResponseLength;
+  uint16_t Crc;
+
+  Crc = (Length >= 2U) ? Crc_CalcCrc16((uint8_t *)Data, (uint16_t)(Length - 2U)) : 0U;
+  Sil_ModbusRate *Rate = Sil_ModbusSweepRate();
+  const Sil_ModbusStep *Step = Master.Step;
+
+  if (Step != NULL)
+  {
+    uint16_t Compare = (Step->CompareLength != 0U) ? Step->CompareLength : Step->ResponseLength;
+
+    Master.Step = NULL;
+    if (Length != Master.ExpectedLength || Data[0] != MODBUS_SLAVE_ADDRESS || memcmp(&Data[1], Step->Response, Compare) != 0 ||
+        Data[Length - 2U] != (uint8_t)Crc || Data[Length - 1U] != (uint8_t)(Crc >> 8))
+    {
+      fprintf(stderr, "SIL: Modbus %s: unexpected response", Step->Name);
+      for (uint16_t i = 0; i < Length; i++)
+      {
+        fprintf(stderr, " %02X", Data[i]);
+      }
+      fprintf(stderr, "\n");
+      Master.StepsFailed++;
+    }
+    Sil_ModbusNextRequest();
+    return;
+  }
+
+  if (Length == Master.ExpectedLength && Data[0] == MODBUS_SLAVE_ADDRESS && Data[1] == Master.Request[1] &&
+      Data[Length - 2U] == (uint8_t)Crc && Data[Length - 1U] == (uint8_t)(Crc >> 8))
+  {
+    // Latency from end of request to first byte of response on the line
+    uint64_t Latency = Master.ResponseStart - Master.RequestEnd;
+
+    Master.Ok++;
+    Master.LatencySum += Latency;
+    Master.LatencyMax = (Latency > Master.LatencyMax) ? Latency : Master.LatencyMax;
+    Master.LatencyMin = (Master.LatencyMin == 0U || Latency < Master.LatencyMin) ? Latency : Master.LatencyMin;
+    if (Master.Request[1] == 6)
+    {
+      // The baud rate is changed: measure at the new one after the slave has switched
+      Master.SweepIndx++;
+      Master.SweepEnd = Master.LineFree + SIL_US_TO_CYCLES(1000U * (MODBUS_SWEEP_SETTLE_MS + MODBUS_SWEEP_MS));
+      (void)Sil_ScheduleEvent(Master.LineFree + SIL_US_TO_CYCLES(1000U * MODBUS_SWEEP_SETTLE_MS), Sil_ModbusSendRequest, NULL);
+      Sil_CancelEvent(Master.TimeoutEvent);
+      Master.TimeoutEvent = -1;
+      return;
+    }
+    if (Rate != NULL)
+    {
+      Rate->BaudRate = Sil_UartBaudRate(USART6);
+      Rate->Ok++;
+    }
+  }
+  else
+  {
+    Master.Errors++;
+    if (Rate != NULL)
+    {
+      Rate->Errors++;
+    }
+  }
+  Sil_ModbusNextRequest();
+}
+
+// Called when a DMA block of the slave has been moved to DR. The response is checked when the expected length has
+// arrived, a shorter one ends with the timeout.
+static void Sil_ModbusSink(const uint8_t *Data, uint32_t Length)
+{
+  if (Master.TimeoutEvent < 0)
+  {
+    Master.Errors++;          // Unsolicited or late response
+    return;
+  }
+  if (Master.ResponseLength == 0U)
+  {
+    Master.ResponseStart = Sil_Now() - (Length - 1U) * Sil_UartCharTime(USART6);
+  }
+  if (Master.ResponseLength + Length > MODBUS_MAX_FRAME)
+  {
+    Master.Errors++;
+    Sil_ModbusNextRequest();
+    return;
+  }
+  memcpy(&Master.Response[Master.ResponseLength], Data, Length);
+  Master.ResponseLength += (uint16_t)Length;
+  Master.LineFree = Sil_Now() + Sil_UartCharTime(USART6);      // Called when the last byte of the block is started
+  if (Master.ResponseLength >= Master.ExpectedLength)
+  {
+    Sil_ModbusCheckResponse();
+  }
+}
+
+// -----------------------------------------------------------------------
+
+static void Sil_TerminalSink(const uint8_t *Data, uint32_t Length)
+{
+  if (TerminalOut != NULL)
+  {
+    fwrite(Data, 1, Length, TerminalOut);
+  }
+  if (SilConfig.Verbose && (Length > 0) && !(Data[0] & 0x80))   // Binary trace records are transmitted in blocks of their own
+  {
+    fwrite(Data, 1, Length, stdout);
+  }
+}
+
+// One character per character time, the line end is typed as CR (Enter)
+static void Sil_TerminalTxByte(void *Arg)
+{
+  char Byte = TerminalInput[TerminalInputIndx++];
+  uint64_t Delay = Sil_UartCharTime(USART3);
+
+  if (Byte == '\n')
+  {
+    Byte = '\r';
+    Delay = SIL_US_TO_CYCLES(1000U * TERMINAL_LINE_PAUSE_MS);
+  }
+  Sil_UartRxByte(USART3, (uint8_t)Byte);
+  if (TerminalInputIndx < TerminalInputLength)
+  {
+    (void)Sil_ScheduleEvent(Sil_Now() + Delay, Sil_TerminalTxByte, NULL);
+  }
+}
+
+void Sil_PlantInit(void)
+{
+  for (uint32_t i = 0; i < NUM_SPEED_SENSORS; i++)
+  {
+    (void)Sil_ScheduleEvent(SpeedSensors[i].Phase + SpeedSensors[i].Period, Sil_SpeedSensorEvent, &SpeedSensors[i]);
+  }
+
+  if (SilConfig.TerminalFile != NULL)
+  {
+    TerminalOut = fopen(SilConfig.TerminalFile, "wb");
+  }
+  Sil_UartSetSink(USART3, Sil_TerminalSink);
+  if (SilConfig.TerminalInput != NULL)
+  {
+    FILE *In = fopen(SilConfig.TerminalInput, "rb");
+
+    if (In != NULL)
+    {
+      TerminalInputLength = fread(TerminalInput, 1, sizeof(TerminalInput), In);
+      fclose(In);
+    }
+    else
+    {
+      fprintf(stderr, "SIL: unable to open %s\n", SilConfig.TerminalInput);
+    }
+    if (TerminalInputLength > 0)
+    {
+      (void)Sil_ScheduleEvent(SIL_US_TO_CYCLES(1000U * TERMINAL_INPUT_START_MS), Sil_TerminalTxByte, NULL);
+    }
+  }
+  Sil_UartSetSink(USART6, Sil_ModbusSink);
+
+  memset(&Master, 0, sizeof(Master));
+  Master.TimeoutEvent = -1;
+  (void)Sil_ScheduleEvent(SIL_US_TO_CYCLES(500000U), Sil_ModbusSendRequest, NULL);   // First request after boot
+}
+
+// Returns 1 if the slave failed at any baud rate of the sweep
+static int Sil_ModbusSweepReport(FILE *Out)
+{
+  int Result = (Master.SweepIndx == MODBUS_NUM_BAUD_RATES) ? 0 : 1;
+
+  if (!SilConfig.ModbusRateSweep)
+  {
+    return 0;
+  }
+  for (uint32_t i = 0; i < Master.SweepIndx; i++)
+  {
+    Sil_ModbusRate *Rate = &Master.Rates[i];
+
+    fprintf(Out, "Modbus %6u baud: %4.0f requests/s, %u errors, %u timeouts\n", Rate->BaudRate,
+            Rate->Ok * 1000.0 / MODBUS_SWEEP_MS, Rate->Errors, Rate->Timeouts);
+    if (Rate->Ok == 0U || Rate->Errors != 0U || Rate->Timeouts != 0U)
+    {
+      Result = 1;
+    }
+  }
+  fprintf(Out, "Modbus rate sweep: %s\n", (Result == 0) ? "PASS" : "FAIL");
+  return Result;
+}
+
+// Returns 1 if a response of the function code script was wrong or missing
+static int Sil_ModbusScriptReport(FILE *Out)
+{
+  int Result = (Master.StepIndx == MODBUS_NUM_STEPS && Master.Step == NULL && Master.StepsFailed == 0U) ? 0 : 1;
+
+  if (!SilConfig.ModbusScript)
+  {
+    return 0;
+  }
+  fprintf(Out, "Modbus function codes: %u of %u requests answered as expected, %s\n",
+          Master.StepIndx - Master.StepsFailed, (uint32_t)MODBUS_NUM_STEPS, (Result == 0) ? "PASS" : "FAIL");
+  return Result;
+}
+
+// Prints the plant statistics. Returns 0 if the application behaved, otherwise 1.
+int Sil_PlantReport(FILE *Out)
+{
+  double CharUs = (double)Sil_UartCharTime(USART6) * 1e6 / (double)SIL_CPU_FREQ;
+
+  if (TerminalOut != NULL)
+  {
+    fclose(TerminalOut);
+    TerminalOut = NULL;
+  }
+  fprintf(Out, "Modbus: %u requests, %u ok, %u errors, %u timeouts\n", Master.Requests, Master.Ok, Master.Errors, Master.Timeouts);
+  if (Master.Ok > 0U)
+  {
+    fprintf(Out, "Modbus response latency [us]: min %.0f, mean %.0f, max %.0f (char time %.1f us, %u baud)\n",
+            (double)Master.LatencyMin * 1e6 / SIL_CPU_FREQ, (double)Master.LatencySum / Master.Ok * 1e6 / SIL_CPU_FREQ,
+            (double)Master.LatencyMax * 1e6 / SIL_CPU_FREQ, CharUs, Sil_UartBaudRate(USART6));
+  }
+  return (Master.Ok == 0U || Master.Errors != 0U || Sil_ModbusSweepReport(Out) != 0 || Sil_ModbusScriptReport(Out) != 0) ? 1 : 0;
+}
@@ -0,0 +1,52 @@
+/**
+******************************************************************************
+* @file    /IDE/SIL/Src/Sil_Stubs.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Modules that depend on middleware not available in the SIL build (USB host, lwIP, RTC).
+*          They are replaced by stubs with the same interface.
+******************************************************************************
+*/
+
+#include <string.h>
+#include "Sil.h"
+#include "Usb.h"
+#include "Network.h"
+#include "Rtc.h"
+
+HCD_HandleTypeDef hhcd;
+
+void Usb_Init(void)
+{
+}
+
+void Usb_500ms(void)
+{
+}
+
+void Network_Init(void)
+{
+}
+
+void Network_4ms(void)
+{
+}
+
+void RTC_Init(void)
+{
+}
+
+// Calendar starts at 2017-01-01 00:00:00 when the simulation starts
+void RTC_CalendarShow(char *showtime, char *showdate)
+{
+  uint32_t Seconds = RTC_GetTimeStamp();
+
+  sprintf(showtime, "%02u:%02u:%02u", (unsigned)((Seconds / 3600U) % 24U), (unsigned)((Seconds / 60U) % 60U), (unsigned)(Seconds % 60U));
+  sprintf(showdate, "%02u-%02u-%04u", 1U, 1U + (unsigned)(Seconds / 86400U), 2017U);
+}
+
+uint32_t RTC_GetTimeStamp(void)
+{
+  return (uint32_t)(Sil_Now() / SIL_CPU_FREQ);
+}
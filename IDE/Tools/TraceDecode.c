@@ -0,0 +1,597 @@
+/**
+******************************************************************************
+* @file    /IDE/Tools/TraceDecode.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Host decoder of the binary trace (see Inc/Trace.h). Reads a capture of the Terminal, where the 8 byte trace
+*          records are interleaved with the text, and writes the records as Chrome trace JSON (chrome://tracing, Perfetto).
+*          Text bytes are ASCII, a byte with the MSB set starts a record. The "#trace" text lines give the CPU clock and
+*          the names of the tasks, interrupts and events, they may be anywhere in the capture.
+*          LOG() messages (see Inc/Log.h) are expanded with the format strings in the log_fmt section of the ELF file.
+*
+*          Usage: TraceDecode [-c] [-o json_file] [-e elf_file] [-l log_file] capture_file
+*          -c  Check: exit code is 1 if the capture has framing errors, lost records, broken log messages or no records
+*          -e  ELF file of the application, needed to expand the log messages
+*          -l  Write the log messages as text lines with the time, else they are only in the JSON file
+******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Must match Inc/Trace.h
+#define TRACE_RECORD_MARK  0x80
+#define TRACE_RECORD_SIZE  8
+enum { TRACE_TASK_START = 0, TRACE_TASK_STOP, TRACE_ISR_ENTER, TRACE_ISR_EXIT, TRACE_EVENT, TRACE_LOST, TRACE_LOG,
+       TRACE_LOG_ARG, TRACE_NUM_TYPES };
+#define LOG_MAX_ARGS  4
+#define LOG_FMT_SECTION  "log_fmt"
+
+#define MAX_IDS       256
+#define MAX_NAME_LEN  32
+#define MAX_LINE_LEN  128
+#define MAX_MSG_LEN   256
+
+// Chrome trace threads, one per task and interrupt
+#define TID_TASK    100
+#define TID_ISR     200
+#define TID_EVENTS  300
+#define TID_LOG     400
+
+typedef struct {
+  uint8_t Type;
+  uint8_t Id;
+  uint16_t Data;
+  uint64_t Cycles;                  // Unwrapped timestamp
+  uint32_t Args[LOG_MAX_ARGS];      // TRACE_LOG: the arguments from the TRACE_LOG_ARG records
+} Record;
+
+typedef struct {
+  char Names[3][MAX_IDS][MAX_NAME_LEN];   // [Task, Interrupt, Event][Id]
+  uint32_t CpuFreq;
+  Record *Records;
+  uint32_t NumRecords;
+  uint32_t FramingErrors;
+  uint32_t Lost;
+  uint32_t Unpaired;                // Stop/exit without start/entry, or start/entry twice
+  char *LogFmt;                     // Contents of the log_fmt section, NULL without ELF file
+  uint32_t LogFmtSize;
+  uint32_t LogErrors;               // Missing arguments or unknown format ID
+} Trace;
+
+enum { NAMES_TASK = 0, NAMES_ISR, NAMES_EVENT };
+
+static void Trace_ParseLine(Trace *T, const char *Line)
+{
+  char Kind;
+  unsigned int Id;
+  char Name[MAX_NAME_LEN];
+
+  if (sscanf(Line, "#trace F %u", &T->CpuFreq) == 1)
+  {
+    return;
+  }
+  if ((sscanf(Line, "#trace %c %u %31[^\r\n]", &Kind, &Id, Name) == 3) && (Id < MAX_IDS))
+  {
+    switch (Kind)
+    {
+    case 'T':
+      strcpy(T->Names[NAMES_TASK][Id], Name);
+      break;
+    case 'I':
+      strcpy(T->Names[NAMES_ISR][Id], Name);
+      break;
+    case 'E':
+      strcpy(T->Names[NAMES_EVENT][Id], Name);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+static uint16_t Trace_Get16(const uint8_t *Data)
+{
+  return (uint16_t)(Data[0] | (Data[1] << 8));
+}
+
+static uint32_t Trace_Get32(const uint8_t *Data)
+{
+  return (uint32_t)Data[0] | ((uint32_t)Data[1] << 8) | ((uint32_t)Data[2] << 16) | ((uint32_t)Data[3] << 24);
+}
+
+static uint64_t Trace_Get64(const uint8_t *Data)
+{
+  return (uint64_t)Trace_Get32(Data) | ((uint64_t)Trace_Get32(Data + 4) << 32);
+}
+
+// Split the capture in text lines and records. The timestamps are unwrapped, records are added in time order on target.
+static int Trace_Parse(Trace *T, const uint8_t *Data, size_t Size)
+{
+  char Line[MAX_LINE_LEN];
+  size_t LineLen = 0;
+  size_t Pos = 0;
+  uint32_t Timestamp, LastTimestamp = 0;
+  uint64_t Wraps = 0;
+  uint8_t NextArg = 0;
+  Record *R;
+
+  T->Records = malloc((Size / TRACE_RECORD_SIZE + 1) * sizeof(Record));
+  if (T->Records == NULL)
+  {
+    return -1;
+  }
+
+  while (Pos < Size)
+  {
+    if (!(Data[Pos] & TRACE_RECORD_MARK))
+    {
+      if (Data[Pos] == '\n')
+      {
+        Line[LineLen] = '\0';
+        Trace_ParseLine(T, Line);
+        LineLen = 0;
+      }
+      else if (LineLen < MAX_LINE_LEN - 1)
+      {
+        Line[LineLen++] = (char)Data[Pos];
+      }
+      Pos++;
+    }
+    else if ((Data[Pos] & ~TRACE_RECORD_MARK) >= TRACE_NUM_TYPES)
+    {
+      T->FramingErrors++;
+      Pos++;                        // Resynchronize on the next byte
+    }
+    else if (Size - Pos < TRACE_RECORD_SIZE)
+    {
+      break;                        // Capture ended within the record
+    }
+    else if ((Data[Pos] & ~TRACE_RECORD_MARK) == TRACE_LOG_ARG)
+    {
+      // Argument of the preceding TRACE_LOG record, records of a message are added together on target
+      R = (T->NumRecords > 0) ? &T->Records[T->NumRecords - 1] : NULL;
+      if ((R != NULL) && (R->Type == TRACE_LOG) && (Data[Pos + 1] == NextArg) && (NextArg < R->Id))
+      {
+        R->Args[NextArg++] = Trace_Get32(&Data[Pos + 4]);
+      }
+      else
+      {
+        T->LogErrors++;
+      }
+      Pos += TRACE_RECORD_SIZE;
+    }
+    else
+    {
+      if ((T->NumRecords > 0) && (T->Records[T->NumRecords - 1].Type == TRACE_LOG) &&
+          (NextArg != T->Records[T->NumRecords - 1].Id))
+      {
+        T->LogErrors++;             // Arguments missing
+      }
+      NextArg = 0;
+
+      Timestamp = Trace_Get32(&Data[Pos + 4]);
+      if ((T->NumRecords > 0) && (Timestamp < LastTimestamp))
+      {
+        Wraps++;
+      }
+      LastTimestamp = Timestamp;
+
+      R = &T->Records[T->NumRecords++];
+      R->Type = Data[Pos] & ~TRACE_RECORD_MARK;
+      R->Id = Data[Pos + 1];
+      R->Data = Trace_Get16(&Data[Pos + 2]);
+      R->Cycles = (Wraps << 32) + Timestamp;
+      if ((R->Type == TRACE_LOG) && (R->Id > LOG_MAX_ARGS))
+      {
+        T->LogErrors++;
+        R->Id = LOG_MAX_ARGS;
+      }
+      if (R->Type == TRACE_LOST)
+      {
+        T->Lost += R->Data;
+      }
+      Pos += TRACE_RECORD_SIZE;
+    }
+  }
+  return 0;
+}
+
+// Expand a log message like printf on target: integers are 32-bit, %f/%e/%g get the bits of a float, %s is not supported
+static void Trace_FormatLog(const char *Fmt, const uint32_t *Args, uint8_t NumArgs, char *Msg, size_t Size)
+{
+  char Spec[32];
+  size_t SpecLen, Len = 0;
+  uint8_t ArgIndx = 0;
+  uint32_t Arg;
+  float Float;
+  char Conv;
+  int Count;
+
+  while ((*Fmt != '\0') && (Len < Size - 1))
+  {
+    if (*Fmt != '%')
+    {
+      Msg[Len++] = *Fmt++;
+      continue;
+    }
+    if (Fmt[1] == '%')
+    {
+      Msg[Len++] = '%';
+      Fmt += 2;
+      continue;
+    }
+
+    // Keep flags, width and precision, drop the length modifiers
+    SpecLen = 0;
+    Spec[SpecLen++] = *Fmt++;
+    while ((*Fmt != '\0') && (strchr("-+ #0123456789.", *Fmt) != NULL) && (SpecLen < sizeof(Spec) - 2))
+    {
+      Spec[SpecLen++] = *Fmt++;
+    }
+    while ((*Fmt != '\0') && (strchr("hlLjzt", *Fmt) != NULL))
+    {
+      Fmt++;
+    }
+    if ((Conv = *Fmt++) == '\0')
+    {
+      break;
+    }
+    Spec[SpecLen++] = Conv;
+    Spec[SpecLen] = '\0';
+    Arg = (ArgIndx < NumArgs) ? Args[ArgIndx] : 0;
+    ArgIndx++;
+
+    switch (Conv)
+    {
+    case 'd':
+    case 'i':
+      Count = snprintf(Msg + Len, Size - Len, Spec, (int)(int32_t)Arg);
+      break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+    case 'c':
+      Count = snprintf(Msg + Len, Size - Len, Spec, (unsigned int)Arg);
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+      memcpy(&Float, &Arg, sizeof(Float));
+      Count = snprintf(Msg + Len, Size - Len, Spec, (double)Float);
+      break;
+    case 'p':
+      Count = snprintf(Msg + Len, Size - Len, "0x%08x", (unsigned int)Arg);
+      break;
+    default:
+      Count = snprintf(Msg + Len, Size - Len, "<%%%c>", Conv);
+      break;
+    }
+    if (Count > 0)
+    {
+      Len += ((size_t)Count < Size - Len) ? (size_t)Count : Size - Len - 1;
+    }
+  }
+  while ((Len > 0) && ((Msg[Len - 1] == '\r') || (Msg[Len - 1] == '\n')))
+  {
+    Len--;
+  }
+  Msg[Len] = '\0';
+}
+
+static void Trace_LogMessage(Trace *T, const Record *R, char *Msg, size_t Size)
+{
+  if (T->LogFmt == NULL)
+  {
+    snprintf(Msg, Size, "Log %u (no ELF file)", R->Data);
+  }
+  else if (R->Data >= T->LogFmtSize)
+  {
+    T->LogErrors++;
+    snprintf(Msg, Size, "Log %u (unknown format ID)", R->Data);
+  }
+  else
+  {
+    Trace_FormatLog(T->LogFmt + R->Data, R->Args, R->Id, Msg, Size);
+  }
+}
+
+static void Trace_WriteJsonString(FILE *Out, const char *String)
+{
+  for (; *String != '\0'; String++)
+  {
+    if ((*String == '"') || (*String == '\\'))
+    {
+      fprintf(Out, "\\%c", *String);
+    }
+    else if ((unsigned char)*String < 0x20)
+    {
+      fprintf(Out, "\\u%04x", (unsigned char)*String);
+    }
+    else
+    {
+      fputc(*String, Out);
+    }
+  }
+}
+
+static const char *Trace_Name(Trace *T, int Kind, uint8_t Id)
+{
+  static const char *Prefix[3] = { "Task", "IRQ", "Event" };
+  static char Default[MAX_NAME_LEN];
+
+  if (T->Names[Kind][Id][0] != '\0')
+  {
+    return T->Names[Kind][Id];
+  }
+  snprintf(Default, sizeof(Default), "%s %u", Prefix[Kind], Id);
+  return Default;
+}
+
+static void Trace_WriteThreadName(FILE *Out, uint32_t Tid, const char *Name)
+{
+  fprintf(Out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n", Tid, Name);
+}
+
+// Task and interrupt records become B/E pairs on a thread of their own, events, log messages and lost records become
+// instant events. The log messages are also written to LogOut, if not NULL.
+static void Trace_WriteJson(Trace *T, FILE *Out, FILE *LogOut)
+{
+  char Msg[MAX_MSG_LEN];
+  uint8_t Active[2][MAX_IDS] = { { 0 } };
+  uint8_t Used[2][MAX_IDS] = { { 0 } };
+  double UsPerCycle = 1e6 / (double)T->CpuFreq;
+  uint64_t Start = (T->NumRecords > 0) ? T->Records[0].Cycles : 0;
+  const Record *R;
+  int Kind;
+  uint32_t i;
+
+  fprintf(Out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (i = 0; i < T->NumRecords; i++)
+  {
+    R = &T->Records[i];
+    double Ts = (double)(R->Cycles - Start) * UsPerCycle;
+
+    switch (R->Type)
+    {
+    case TRACE_TASK_START:
+    case TRACE_ISR_ENTER:
+    case TRACE_TASK_STOP:
+    case TRACE_ISR_EXIT:
+      Kind = (R->Type >= TRACE_ISR_ENTER) ? NAMES_ISR : NAMES_TASK;
+      Used[Kind][R->Id] = 1;
+      if ((R->Type == TRACE_TASK_START) || (R->Type == TRACE_ISR_ENTER))
+      {
+        T->Unpaired += Active[Kind][R->Id];
+        Active[Kind][R->Id] = 1;
+        fprintf(Out, "{\"name\":\"%s\",\"ph\":\"B\",\"pid\":1,\"tid\":%u,\"ts\":%.3f},\n",
+                Trace_Name(T, Kind, R->Id), (Kind == NAMES_ISR ? TID_ISR : TID_TASK) + R->Id, Ts);
+      }
+      else if (Active[Kind][R->Id])
+      {
+        Active[Kind][R->Id] = 0;
+        fprintf(Out, "{\"ph\":\"E\",\"pid\":1,\"tid\":%u,\"ts\":%.3f},\n",
+                (Kind == NAMES_ISR ? TID_ISR : TID_TASK) + R->Id, Ts);
+      }
+      else
+      {
+        T->Unpaired++;
+      }
+      break;
+    case TRACE_EVENT:
+      fprintf(Out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"data\":%u}},\n",
+              Trace_Name(T, NAMES_EVENT, R->Id), TID_EVENTS, Ts, R->Data);
+      break;
+    case TRACE_LOST:
+      // Pairs may be broken by the lost records, start over
+      memset(Active, 0, sizeof(Active));
+      fprintf(Out, "{\"name\":\"Lost\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"records\":%u}},\n",
+              TID_EVENTS, Ts, R->Data);
+      break;
+    case TRACE_LOG:
+      Trace_LogMessage(T, R, Msg, sizeof(Msg));
+      fprintf(Out, "{\"name\":\"");
+      Trace_WriteJsonString(Out, Msg);
+      fprintf(Out, "\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f},\n", TID_LOG, Ts);
+      if (LogOut != NULL)
+      {
+        fprintf(LogOut, "[%12.6f] %s\n", Ts * 1e-6, Msg);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  for (i = 0; i < MAX_IDS; i++)
+  {
+    if (Used[NAMES_TASK][i])
+    {
+      Trace_WriteThreadName(Out, TID_TASK + i, Trace_Name(T, NAMES_TASK, (uint8_t)i));
+    }
+    if (Used[NAMES_ISR][i])
+    {
+      Trace_WriteThreadName(Out, TID_ISR + i, Trace_Name(T, NAMES_ISR, (uint8_t)i));
+    }
+  }
+  Trace_WriteThreadName(Out, TID_EVENTS, "Events");
+  Trace_WriteThreadName(Out, TID_LOG, "Log");
+  fprintf(Out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Nucleo_446ZE\"}}\n]}\n");
+}
+
+static uint8_t *Trace_ReadFile(const char *Filename, size_t *Size)
+{
+  FILE *In = fopen(Filename, "rb");
+  uint8_t *Data = NULL;
+  long Length;
+
+  if (In == NULL)
+  {
+    return NULL;
+  }
+  if ((fseek(In, 0, SEEK_END) == 0) && ((Length = ftell(In)) >= 0) && (fseek(In, 0, SEEK_SET) == 0))
+  {
+    Data = malloc((size_t)Length + 1U);
+    if ((Data != NULL) && (fread(Data, 1, (size_t)Length, In) != (size_t)Length))
+    {
+      free(Data);
+      Data = NULL;
+    }
+    *Size = (size_t)Length;
+  }
+  fclose(In);
+  return Data;
+}
+
+// Read the log_fmt section from the ELF file of the application, 32 (target) or 64 bit (SIL), little endian
+static int Trace_ReadLogFmt(Trace *T, const char *Filename)
+{
+  size_t Size = 0;
+  uint8_t *Elf = Trace_ReadFile(Filename, &Size);
+  const uint8_t *Sh, *StrSh;
+  uint64_t ShOff, Offset, SecSize, StrOff;
+  uint16_t ShEntSize, ShNum, ShStrNdx, i;
+  int Is64, Result = -1;
+
+  if ((Elf == NULL) || (Size < 64) || (memcmp(Elf, "\177ELF", 4) != 0) || (Elf[5] != 1))
+  {
+    free(Elf);
+    return -1;
+  }
+  Is64 = (Elf[4] == 2);
+  ShOff = Is64 ? Trace_Get64(Elf + 0x28) : Trace_Get32(Elf + 0x20);
+  ShEntSize = Trace_Get16(Elf + (Is64 ? 0x3A : 0x2E));
+  ShNum = Trace_Get16(Elf + (Is64 ? 0x3C : 0x30));
+  ShStrNdx = Trace_Get16(Elf + (Is64 ? 0x3E : 0x32));
+  if ((ShOff + (uint64_t)ShEntSize * ShNum > Size) || (ShStrNdx >= ShNum))
+  {
+    free(Elf);
+    return -1;
+  }
+
+  StrSh = Elf + ShOff + (uint64_t)ShStrNdx * ShEntSize;
+  StrOff = Is64 ? Trace_Get64(StrSh + 0x18) : Trace_Get32(StrSh + 0x10);
+  for (i = 0; i < ShNum; i++)
+  {
+    Sh = Elf + ShOff + (uint64_t)i * ShEntSize;
+    Offset = Is64 ? Trace_Get64(Sh + 0x18) : Trace_Get32(Sh + 0x10);
+    SecSize = Is64 ? Trace_Get64(Sh + 0x20) : Trace_Get32(Sh + 0x14);
+    if ((StrOff + Trace_Get32(Sh) + sizeof(LOG_FMT_SECTION) <= Size) &&
+        (strcmp((const char *)Elf + StrOff + Trace_Get32(Sh), LOG_FMT_SECTION) == 0) && (Offset + SecSize <= Size))
+    {
+      T->LogFmt = malloc(SecSize + 1);
+      if (T->LogFmt != NULL)
+      {
+        memcpy(T->LogFmt, Elf + Offset, SecSize);
+        T->LogFmt[SecSize] = '\0';
+        T->LogFmtSize = (uint32_t)SecSize;
+        Result = 0;
+      }
+      break;
+    }
+  }
+  free(Elf);
+  return Result;
+}
+
+int main(int argc, char *argv[])
+{
+  static Trace T;
+  const char *OutFilename = "trace.json";
+  const char *ElfFilename = NULL;
+  const char *LogFilename = NULL;
+  int Check = 0;
+  uint8_t *Data;
+  size_t Size = 0;
+  FILE *Out, *LogOut = NULL;
+  uint32_t i, NumLogs = 0;
+  int Opt;
+
+  while ((Opt = getopt(argc, argv, "co:e:l:")) != -1)
+  {
+    switch (Opt)
+    {
+    case 'c':
+      Check = 1;
+      break;
+    case 'o':
+      OutFilename = optarg;
+      break;
+    case 'e':
+      ElfFilename = optarg;
+      break;
+    case 'l':
+      LogFilename = optarg;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-c] [-o json_file] [-e elf_file] [-l log_file] capture_file\n", argv[0]);
+      return 2;
+    }
+  }
+  if (optind >= argc)
+  {
+    fprintf(stderr, "Usage: %s [-c] [-o json_file] [-e elf_file] [-l log_file] capture_file\n", argv[0]);
+    return 2;
+  }
+  if ((ElfFilename != NULL) && (Trace_ReadLogFmt(&T, ElfFilename) != 0))
+  {
+    fprintf(stderr, "No %s section in %s\n", LOG_FMT_SECTION, ElfFilename);
+    return 2;
+  }
+
+  Data = Trace_ReadFile(argv[optind], &Size);
+  if ((Data == NULL) || (Trace_Parse(&T, Data, Size) != 0))
+  {
+    fprintf(stderr, "Can not read %s\n", argv[optind]);
+    return 2;
+  }
+  if (T.CpuFreq == 0)
+  {
+    fprintf(stderr, "No \"#trace F\" line in the capture, 180 MHz assumed\n");
+    T.CpuFreq = 180000000U;
+  }
+
+  Out = fopen(OutFilename, "w");
+  if (Out == NULL)
+  {
+    fprintf(stderr, "Can not write %s\n", OutFilename);
+    return 2;
+  }
+  if ((LogFilename != NULL) && ((LogOut = fopen(LogFilename, "w")) == NULL))
+  {
+    fprintf(stderr, "Can not write %s\n", LogFilename);
+    return 2;
+  }
+  Trace_WriteJson(&T, Out, LogOut);
+  fclose(Out);
+  if (LogOut != NULL)
+  {
+    fclose(LogOut);
+  }
+
+  for (i = 0; i < T.NumRecords; i++)
+  {
+    NumLogs += (T.Records[i].Type == TRACE_LOG);
+  }
+  printf("TraceDecode: %u records, %.3f s, %u lost, %u framing errors, %u unpaired, %u log messages, %u log errors -> %s\n",
+         T.NumRecords,
+         T.NumRecords > 0 ? (double)(T.Records[T.NumRecords - 1].Cycles - T.Records[0].Cycles) / T.CpuFreq : 0.0,
+         T.Lost, T.FramingErrors, T.Unpaired, NumLogs, T.LogErrors, OutFilename);
+
+  free(T.Records);
+  free(T.LogFmt);
+  free(Data);
+  if (Check && ((T.NumRecords == 0) || (T.Lost != 0) || (T.FramingErrors != 0) || (T.LogErrors != 0)))
+  {
+    return 1;
+  }
+  return 0;
+}
@@ -31,5 +31,6 @@ void UnitTest_Util_Map(void);
 
 void UnitTest_RadioReceive(void);
 void UnitTest_FlashE2p(void);
+void UnitTest_EventQueue(void);
 
 #endif // __UNIT_TEST_H
\ No newline at end of file
@@ -37,6 +37,10 @@ typedef struct
 #define FLASH_TYPEPROGRAM_WORD        ((uint32_t)0x02U)  /*!< Program a word (32-bit) at a specified address        */
 #define FLASH_TYPEERASE_SECTORS         ((uint32_t)0x00U)  /*!< Sectors erase only          */
 
+typedef int32_t IRQn_Type;
+
+#define __DMB()   // Unit tests are single threaded, interrupts are simulated
+
 extern uint32_t UnitTest_EmulatedSector[4096];
 
 extern HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError);
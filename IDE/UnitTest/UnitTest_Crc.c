@@ -87,4 +87,8 @@ void UnitTest_Crc_CalcCrc16(void)
   fprintf(fp, "\n");
   Crc = Crc_CalcCrc16(buffer3, sizeof(buffer3) / sizeof(buffer3[0]));
   PRINT_RESULT("buffer: 0A 04 10 01 F5 01 F9 00 F7 00 F8 03 52 01 5E 02 BC 00 01  Expected Crc: C4 BA");
+
+  Crc = Crc_UpdateCrc16(CRC16_INIT, buffer3, 3);
+  Crc = Crc_UpdateCrc16(Crc, &buffer3[3], sizeof(buffer3) / sizeof(buffer3[0]) - 3);
+  PRINT_RESULT("same buffer as above in two parts (header and payload) with Crc_UpdateCrc16. Expected Crc: C4 BA");
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+// ------ Unit test Event Queue ------
+// Stress test of the single producer, single consumer queue. The "interrupt" (producer) is executed at random points,
+// both between main loop steps and inside EventQueue_Dispatch (see EVENT_QUEUE_PREEMPTION_POINT in EventQueue.c).
+// Every event carries a sequence number, the consumer checks that no event is lost, duplicated or reordered.
+#include <string.h>
+#include "UnitTest.h"
+#include "EventQueue.h"
+
+#define NUM_STEPS  500000   // The 16-bit indices wrap around at least twice, checked by each test
+
+EVENT_QUEUE(TestQueue, 8);
+
+static uint32_t Seed;
+static uint32_t PreemptPercent;   // Probability that the interrupt fires at a preemption point
+static uint32_t MaxBurst;         // Max number of events posted per interrupt
+static uint32_t NextPost;         // Sequence number of next event to post
+static uint32_t NextExpected;     // Sequence number the consumer expects next
+static uint32_t NumLost;          // Post returned FALSE. Overflows in the queue is 16 bits, compare the lower part
+static uint32_t NumErrors;
+static uint32_t NumPreemptions;
+static bool InIsr = FALSE;
+
+static uint32_t UnitTest_EventQueue_Random(uint32_t Max)
+{
+  Seed = Seed * 1103515245UL + 12345UL;   // Own generator so the result files are the same on all platforms
+  return (Seed >> 16) % Max;
+}
+
+static void UnitTest_EventQueue_Handler(uint32_t Data)
+{
+  if (Data != NextExpected)
+  {
+    NumErrors++;
+  }
+  NextExpected = Data + 1;
+  UnitTest_EventQueue_Preempt();          // The handler can also be interrupted
+}
+
+static void UnitTest_EventQueue_Isr(void)
+{
+  uint32_t Burst = 1 + UnitTest_EventQueue_Random(MaxBurst);
+
+  InIsr = TRUE;                           // An interrupt does not preempt itself
+  while (Burst-- > 0)
+  {
+    if (EventQueue_Post(&TestQueue, UnitTest_EventQueue_Handler, NextPost))
+    {
+      NextPost++;
+    }
+    else
+    {
+      NumLost++;
+    }
+  }
+  InIsr = FALSE;
+}
+
+// Called by EventQueue.c between the accesses of the consumer
+void UnitTest_EventQueue_Preempt(void)
+{
+  if (!InIsr && (UnitTest_EventQueue_Random(100) < PreemptPercent))
+  {
+    NumPreemptions++;
+    UnitTest_EventQueue_Isr();
+  }
+}
+
+static void UnitTest_EventQueue_Run(uint32_t TestSeed, uint32_t TestPreemptPercent, uint32_t TestMaxBurst, uint32_t PostPercent)
+{
+  uint32_t Step;
+  uint32_t NumWraps = 0;
+  uint16_t LastHead = 0;
+
+  (void)memset(TestQueue_Events, 0, sizeof(TestQueue_Events));
+  TestQueue.Head = TestQueue.Tail = TestQueue.Overflows = TestQueue.MaxLevel = 0;
+  Seed = TestSeed;
+  PreemptPercent = TestPreemptPercent;
+  MaxBurst = TestMaxBurst;
+  NextPost = NextExpected = NumLost = NumErrors = NumPreemptions = 0;
+
+  for (Step = 0; Step < NUM_STEPS; Step++)
+  {
+    if (UnitTest_EventQueue_Random(100) < PostPercent)
+    {
+      UnitTest_EventQueue_Isr();
+    }
+    else
+    {
+      (void)EventQueue_Dispatch(&TestQueue);
+    }
+    if (TestQueue.Head < LastHead)
+    {
+      NumWraps++;
+    }
+    LastHead = TestQueue.Head;
+  }
+
+  PreemptPercent = 0;
+  while (EventQueue_Dispatch(&TestQueue))   // Drain
+  {
+    ;
+  }
+
+  fprintf(fp, "%6lu %4lu %4lu %4lu  %7lu %7lu %6lu %4u %4lu %5lu  %s\n", TestSeed, TestPreemptPercent, TestMaxBurst, PostPercent,
+          NextPost, NumPreemptions, NumLost, TestQueue.MaxLevel, NumWraps, NumErrors,
+          ((NumErrors == 0) && (NextExpected == NextPost) && ((uint16_t)NumLost == TestQueue.Overflows) && (TestQueue.Head == TestQueue.Tail) &&
+           (NumWraps > 0)) ? "PASS" : "FAIL");
+}
+
+void UnitTest_EventQueue(void)
+{
+  fprintf(fp, "Queue size %u, %d steps per test\n", TestQueue.Size, NUM_STEPS);
+  fprintf(fp, "  Seed Prmt Brst Post   Posted Preempt   Lost  Max Wrap Errors\n");
+  fprintf(fp, "------------------------------------------------------------------------\n");
+
+  // The consumer keeps up in all but the last test, so most events are dispatched and the interleavings are tested
+  // rather than the full queue. Each preemption point of EventQueue_Dispatch adds posts, thus the low post rates.
+  UnitTest_EventQueue_Run(1,     0, 1, 45);   // No preemption inside the consumer
+  UnitTest_EventQueue_Run(2,    10, 1, 30);
+  UnitTest_EventQueue_Run(3,     5, 2, 25);
+  UnitTest_EventQueue_Run(4,    15, 1, 12);   // Interrupt at many preemption points
+  UnitTest_EventQueue_Run(5,     5, 2, 30);   // Producer bursts close to the consumer rate
+  UnitTest_EventQueue_Run(12345, 2, 8, 8);    // Burst equal to queue size, the full queue path
+}
@@ -3,6 +3,8 @@
 #include "UnitTest.h"
 #include "UnitTestDefs.h"
 #include "FlashE2p.h"
+#include "Scheduler.h"
+#include "BgJob.h"
 
 
 uint32_t UnitTest_EmulatedSector[4096] = { 0 };
@@ -25,6 +27,25 @@ HAL_StatusTypeDef HAL_FLASH_Unlock(void)
 {
   return HAL_OK;
 }
+
+uint32_t Scheduler_Lock(void)
+{
+  return 0;
+}
+
+void Scheduler_Unlock(uint32_t PrevLock)
+{
+}
+
+bool BgJob_Start(BgJob *Job)
+{
+  return TRUE;
+}
+
+bool BgJob_Active(const BgJob *Job)
+{
+  return FALSE;
+}
 // END OF Mockup functions
 
 
@@ -69,6 +69,8 @@ int main()
 
   UnitTest_TestCaseWrapper("TC_FlashE2p.txt", UnitTest_FlashE2p);
 
+  UnitTest_TestCaseWrapper("TC_EventQueue.txt", UnitTest_EventQueue);
+
   UnitTest_TestCaseWrapper("TC_Util_SRLatch.txt", UnitTest_Util_SRLatch);
 
   UnitTest_TestCaseWrapper("TC_Util_FilterState.txt", UnitTest_Util_FilterState);
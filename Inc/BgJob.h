@@ -0,0 +1,60 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BG_JOB_H
+#define __BG_JOB_H
+
+#include "ProjectDefs.h"
+
+#define BGJOB_SLICE_US     500    // Max time a job may run before the main loop checks for events again
+#define BGJOB_DONE         100    // Progress [%] returned by the last step of a job
+
+typedef struct BgJob BgJob;
+
+// Execute one resumable step of the job and return the progress [%], BGJOB_DONE when the job is finished.
+// A step should take well below BGJOB_SLICE_US. Keep the position of the job in State, it is 0 when the job starts.
+typedef uint8_t (*BgJob_StepFunc)(BgJob *Job);
+typedef void (*BgJob_Callback)(BgJob *Job);
+
+struct BgJob {
+  // ------ Configuration ------
+  const char *Name;
+  BgJob_StepFunc Step;
+  BgJob_Callback OnProgress;      // Called when the progress has changed after a time slice, may be NULL
+  BgJob_Callback OnDone;          // Called when the job is finished, may be NULL
+
+  // ------ Runtime data, leave out when defining the job ------
+  uint32_t State;
+  uint8_t Progress;               // [%]
+  volatile bool Active;
+  BgJob *Next;
+  uint32_t Runs;
+  uint32_t MaxStepTime;           // [us]
+};
+
+// Use this macro to define a job
+#define BGJOB(NAME, STEP, ON_PROGRESS, ON_DONE)  { NAME, STEP, ON_PROGRESS, ON_DONE }
+
+/**
+ * Start a job. Can be called from any rate group. The job is executed in the idle time of the main loop, i.e. it never
+ * delays a rate group. Returns FALSE if the job is already active, then it is not restarted.
+ */
+extern bool BgJob_Start(BgJob *Job);
+
+/**
+ * Returns TRUE if the job has been started and has not finished yet.
+ */
+extern bool BgJob_Active(const BgJob *Job);
+
+/**
+ * Called from the main loop. Executes steps of the active jobs for one time slice, round robin between the jobs.
+ * Returns TRUE if any step was executed.
+ */
+extern bool BgJob_Run(void);
+
+/**
+ * Returns TRUE if any job is active. Used by the idle loop to not sleep with work pending.
+ */
+extern bool BgJob_Pending(void);
+
+extern void BgJob_PrintStats(void);
+
+#endif // __BG_JOB_H
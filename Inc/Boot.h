@@ -0,0 +1,47 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BOOT_H
+#define __BOOT_H
+
+#include "ProjectDefs.h"
+
+typedef enum {
+  BOOT_SYNC = 0,      // Executed before the rate groups are started, i.e. the control path
+  BOOT_DEFERRED,      // Executed as a background job after the rate groups are started, one phase per step
+} Boot_Mode;
+
+// Use this macro to define the entries in the boot table
+#define BOOT_PHASE(NAME, FUNC, MODE)  { NAME, FUNC, MODE }
+
+typedef struct {
+  // ------ Configuration ------
+  const char *Name;
+  void (*Init)(void);
+  Boot_Mode Mode;
+
+  // ------ Runtime data, leave out when defining the table ------
+  uint32_t StartUs;           // Start of the phase, relative to Boot_RunSync()
+  uint32_t DurationUs;
+  volatile bool Done;
+} Boot_Phase;
+
+/**
+ * Execute the BOOT_SYNC phases in table order and timestamp them with the DWT cycle counter.
+ * Call after SystemClock_Config(), the times are based on SystemCoreClock.
+ */
+extern void Boot_RunSync(Boot_Phase *Phases, uint16_t NumPhases);
+
+/**
+ * Start the BOOT_DEFERRED phases in the background (see BgJob.h). Call when the rate groups have been started.
+ * The boot report is printed when all phases are done.
+ */
+extern void Boot_StartDeferred(void);
+
+/**
+ * Returns TRUE if the phase with the given init function has finished. Modules initialized in a deferred phase
+ * must not be used by the rate groups until then.
+ */
+extern bool Boot_Ready(void (*Init)(void));
+
+extern void Boot_PrintReport(void);
+
+#endif // __BOOT_H
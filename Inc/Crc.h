@@ -3,8 +3,10 @@
 
 #include "ProjectDefs.h"
 
+#define CRC16_INIT  0xFFFF      // Modbus
 
 uint8_t Crc_CalcCrc8(const uint8_t *data, const uint32_t size);
 uint16_t Crc_CalcCrc16(const uint8_t *data, const uint32_t size);
+uint16_t Crc_UpdateCrc16(uint16_t Crc, const uint8_t *data, const uint32_t size);
 
 #endif // __CRC_H
\ No newline at end of file
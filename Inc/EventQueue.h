@@ -0,0 +1,58 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __EVENT_QUEUE_H
+#define __EVENT_QUEUE_H
+
+#include "ProjectDefs.h"
+
+// Called in the main loop with the data posted by the interrupt. Runs to completion, i.e. one event at a time.
+typedef void (*EventQueue_Handler)(uint32_t Data);
+
+typedef struct {
+  EventQueue_Handler Handler;
+  uint32_t Data;
+} EventQueue_Event;
+
+// Single producer, single consumer ring buffer. The indices are free running and only written by one side each,
+// thus no locks are needed. Size must be a power of 2.
+typedef struct {
+  EventQueue_Event *Events;
+  uint16_t Size;
+  volatile uint16_t Head;         // Next slot to write, only written by the producer
+  volatile uint16_t Tail;         // Next slot to read, only written by the consumer
+  volatile uint16_t Overflows;    // Events lost because the queue was full
+  volatile uint16_t MaxLevel;     // High-water mark
+} EventQueue;
+
+// Use this macro to define a queue
+#define EVENT_QUEUE(NAME, SIZE)                \
+  static EventQueue_Event NAME##_Events[SIZE];  \
+  EventQueue NAME = { NAME##_Events, SIZE, 0, 0, 0, 0 }
+
+// One queue per interrupt priority level that posts events. Interrupts on the same level can not preempt each other,
+// so each queue has a single producer. Only post to the queue of the level the interrupt runs on.
+extern EventQueue EventQueue_Prio9;     // TIM5 (radio input capture), TIM13, PendSV, USART3 (Shell)
+
+/**
+ * Post an event from an interrupt. Returns FALSE if the queue is full, then the event is lost and counted in Overflows.
+ */
+extern bool EventQueue_Post(EventQueue *Queue, EventQueue_Handler Handler, uint32_t Data);
+
+/**
+ * Remove the oldest event from the queue and execute its handler. Returns FALSE if the queue was empty.
+ */
+extern bool EventQueue_Dispatch(EventQueue *Queue);
+
+/**
+ * Called from the main loop. Executes one event from the highest priority queue that is not empty.
+ * Returns TRUE if an event was executed.
+ */
+extern bool EventQueue_DispatchNext(void);
+
+/**
+ * Returns TRUE if any queue has events. Used by the idle loop to not sleep with events pending.
+ */
+extern bool EventQueue_Pending(void);
+
+extern void EventQueue_PrintStats(void);
+
+#endif // __EVENT_QUEUE_H
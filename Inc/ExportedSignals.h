@@ -2,12 +2,20 @@
 #define __EXPORTED_SIGNALS_H
 
 #include "ProjectDefs.h"
+#include "Modbus.h"
 
+/* The Modbus register map, sorted by address, see Modbus_Init() */
+extern const Modbus_Range ExportedSignals_Map[];
+extern const uint16_t ExportedSignals_MapSize;
 
-/* Updates the exported signals array by copying in the values of the signals to be exported */
-void ExportedSignals_Update(void);
+/* Publishes a snapshot of the signals to be exported, call from Loop20ms. Readers that preempt Loop20ms see one
+   snapshot, a reader of lower priority shall read a signal at a time. */
+void ExportedSignals_20ms(void);
 
-/* Read the signal at given index */
+/* Read the signal at given index, from the latest snapshot */
 uint16_t ExportedSignals_Read(uint16_t indx);
 
+/* Number of exported signals, the indices are 0..Count-1 */
+uint16_t ExportedSignals_Count(void);
+
 #endif // __EXPORTED_SIGNALS_H
\ No newline at end of file
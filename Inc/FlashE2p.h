@@ -19,6 +19,7 @@ typedef enum {
   E2P_CLUTCH_SPRING_PRESSURE,
   E2P_CLUTCH_IN_PRE_PRESSURE,
   E2P_NEO_PIXEL_APP,
+  E2P_MODBUS_BAUD_RATE,         // Index in the baud rate table of Modbus.c
 
   E2P_NUM_PARAMETERS            // Always last - let the toolchain count the parameters
 } tE2Index;
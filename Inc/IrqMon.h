@@ -0,0 +1,104 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IRQ_MON_H
+#define __IRQ_MON_H
+
+#include "ProjectDefs.h"
+
+// Perform all interrupt monitoring inside #ifdef IRQ_MON so that it is not done when undefining IRQ_MON.
+// The monitor reads the DWT cycle counter, which does not exist in the unit tests.
+#ifndef UNIT_TEST
+#define IRQ_MON
+#endif
+
+// Monitored interrupts. Add new ones before IRQMON_NUM_IRQS and configure them in IrqMon.c
+typedef enum {
+  IRQMON_SYSTICK = 0,
+  IRQMON_TIM5,                // Radio receive capture
+  IRQMON_TIM13,               // Radio transmit
+  IRQMON_TIM14,               // NeoPixel
+  IRQMON_OTG_FS,
+  IRQMON_NUM_IRQS
+} IrqMon_Id;
+
+// Source of the entry latency, i.e. the time from the event that requested the interrupt to the first instruction
+typedef enum {
+  IRQMON_LATENCY_NONE = 0,    // No counter tells when the interrupt was requested
+  IRQMON_LATENCY_SYSTICK,     // Counted down from LOAD, in CPU cycles
+  IRQMON_LATENCY_TIMER,       // Ticks of an APB1 timer, from the update event or the capture
+} IrqMon_LatencySrc;
+
+// Statistics exported per interrupt, see IrqMon_ReadStat(). Times are in ns and saturate at 0xFFFF.
+#define IRQMON_STAT_COUNT          0    // Number of executions (lower 16 bits)
+#define IRQMON_STAT_LATENCY        1    // Entry latency of the last execution
+#define IRQMON_STAT_LATENCY_MAX    2
+#define IRQMON_STAT_EXEC_TIME_MAX  3    // Entry to exit, including time preempted by higher priority interrupts
+#define IRQMON_STAT_NESTING_MAX    4    // Max number of monitored interrupts that were active when the interrupt was entered
+#define IRQMON_STAT_PREEMPTIONS    5    // Number of times the interrupt was preempted by a monitored one
+#define IRQMON_STAT_MARK_MAX       6    // Max time from the requesting event to IRQMON_MARK, e.g. a register write
+#define IRQMON_STAT_MARK_MISSES    7    // Number of marks later than DeadlineNs
+#define IRQMON_NUM_STATS           8
+
+typedef struct IrqMon IrqMon;
+
+struct IrqMon {
+  // ------ Configuration ------
+  const char *Name;
+  IrqMon_LatencySrc LatencySrc;
+  TIM_TypeDef *Timer;         // Timer for IRQMON_LATENCY_TIMER
+  uint32_t DeadlineNs;        // For IRQMON_MARK, 0 if no deadline
+
+  // ------ Runtime data ------
+  uint32_t DeadlineTicks;     // DeadlineNs in ticks of the latency source
+  uint32_t EntryCycles;       // DWT cycle counter when entered
+  uint32_t Count;
+  uint32_t Latency;           // [ticks] of the latency source
+  uint32_t LatencyMax;
+  uint32_t ExecCyclesMax;
+  uint32_t Mark;              // [ticks] of the latency source
+  uint32_t MarkMax;
+  uint32_t MarkMisses;
+  uint8_t NestingMax;
+  uint32_t Preemptions;       // Times a monitored interrupt was entered while this one was the innermost active
+  IrqMon *Preempted;          // Monitored interrupt that was innermost when this one was entered, NULL if none
+};
+
+#ifdef IRQ_MON
+
+extern IrqMon IrqMon_Irqs[IRQMON_NUM_IRQS];
+
+// Place IRQMON_ENTER first and IRQMON_EXIT last in the interrupt handler. LATENCY_TICKS is read from the latency source,
+// e.g. CNT of a timer that requests the interrupt on its update event. Use 0 if the latency is set later by IRQMON_LATENCY.
+// A write with a deadline of a few cycles shall not wait for the monitor: read the latency source to a local first, do
+// the write and IRQMON_MARK, then IRQMON_ENTER with the saved ticks (see the TIM14 handler in NeoPixel.c).
+#define IRQMON_ENTER(ID, LATENCY_TICKS)  IrqMon_Enter(&IrqMon_Irqs[ID], (LATENCY_TICKS))
+#define IRQMON_LATENCY(ID, TICKS)        IrqMon_SetLatency(&IrqMon_Irqs[ID], (TICKS))
+#define IRQMON_MARK(ID, TICKS)           IrqMon_Mark(&IrqMon_Irqs[ID], (TICKS))
+#define IRQMON_EXIT(ID)                  IrqMon_Exit(&IrqMon_Irqs[ID])
+
+/**
+ * Convert the deadlines to timer ticks. Call when the timers used as latency source are configured.
+ */
+extern void IrqMon_Init(void);
+
+extern void IrqMon_Enter(IrqMon *Mon, uint32_t LatencyTicks);
+extern void IrqMon_SetLatency(IrqMon *Mon, uint32_t LatencyTicks);
+extern void IrqMon_Mark(IrqMon *Mon, uint32_t Ticks);
+extern void IrqMon_Exit(IrqMon *Mon);
+
+/**
+ * Read interrupt statistics as a flat array: Indx = IrqMon_Id * IRQMON_NUM_STATS + IRQMON_STAT_XXX
+ */
+extern uint16_t IrqMon_ReadStat(uint16_t Indx);
+
+extern void IrqMon_PrintStats(void);
+
+#else
+
+#define IRQMON_ENTER(ID, LATENCY_TICKS)
+#define IRQMON_LATENCY(ID, TICKS)
+#define IRQMON_MARK(ID, TICKS)
+#define IRQMON_EXIT(ID)
+
+#endif
+
+#endif // __IRQ_MON_H
@@ -0,0 +1,87 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LOG_H
+#define __LOG_H
+
+#include "ProjectDefs.h"
+#include "Trace.h"
+#include "Uart.h"
+
+// Deferred logging: LOG("Format %d\r\n", Value) stores only the position of the format string and the raw arguments as
+// a record in a ring, a few stores instead of vsnprintf at the call site.
+// With TRACE the records are added to the trace ring and TraceDecode expands the messages with the format strings from
+// the log_fmt section of the ELF file (-e). Otherwise they are added to the log ring of Log.c, and expanded on target
+// by Log_Flush() in the main loop, i.e. when nothing else is left to do.
+// Up to LOG_MAX_ARGS arguments: integers (32-bit) and floats (as float, double is converted). No strings (%s), they
+// would have to be copied. Without LOG_DEFERRED and TRACE the messages are formatted at once with UART_PRINTF.
+#define LOG_DEFERRED
+
+#define LOG_MAX_ARGS   4
+#define LOG_RING_SIZE  32     // Records of the log ring, power of 2
+
+#if defined(LOG_DEFERRED) || defined(TRACE)
+
+// Each call site places its format string in the log_fmt section, its ID is the offset in the section
+#define LOG_FMT_SECTION  __attribute__((section("log_fmt")))
+
+#define LOG(...)  LOG_SELECT(__VA_ARGS__, LOG_4, LOG_3, LOG_2, LOG_1, LOG_0, )(__VA_ARGS__)
+
+#define LOG_SELECT(FMT, A, B, C, D, NAME, ...)  NAME
+#define LOG_0(FMT)              LOG_ADD(FMT, 0, NULL)
+#define LOG_1(FMT, A)           LOG_ADD(FMT, 1, ((const uint32_t[]){ LOG_ARG(A) }))
+#define LOG_2(FMT, A, B)        LOG_ADD(FMT, 2, ((const uint32_t[]){ LOG_ARG(A), LOG_ARG(B) }))
+#define LOG_3(FMT, A, B, C)     LOG_ADD(FMT, 3, ((const uint32_t[]){ LOG_ARG(A), LOG_ARG(B), LOG_ARG(C) }))
+#define LOG_4(FMT, A, B, C, D)  LOG_ADD(FMT, 4, ((const uint32_t[]){ LOG_ARG(A), LOG_ARG(B), LOG_ARG(C), LOG_ARG(D) }))
+
+#ifdef TRACE
+#define LOG_SINK  Trace_AddLog
+#else
+#define LOG_SINK  Log_Add
+#endif
+
+#define LOG_ADD(FMT, NUM_ARGS, ARGS) \
+do { \
+  static const char Log_Fmt[] LOG_FMT_SECTION = FMT; \
+  LOG_SINK(Log_Fmt, (NUM_ARGS), (ARGS)); \
+} while (0)
+
+// Raw 32 bits of an argument: floats as IEEE 754 single precision, integers as is
+#define LOG_ARG(X)  _Generic((X), float: Log_FloatBits, double: Log_FloatBits, default: Log_IntBits)(X)
+
+static inline uint32_t Log_FloatBits(float Value)
+{
+  union { float F; uint32_t U; } Bits = { Value };
+  return Bits.U;
+}
+
+static inline uint32_t Log_IntBits(uint32_t Value)
+{
+  return Value;
+}
+
+#else
+
+#define LOG(...)  UART_PRINTF(__VA_ARGS__)
+
+#endif
+
+#if defined(LOG_DEFERRED) && !defined(TRACE)
+
+/**
+ * Add a log message to the log ring. The message is lost, and counted, if the ring is full. Call from the rate groups,
+ * the background or the main loop, not from interrupts above the rate groups (masked by Scheduler_Lock).
+ */
+extern void Log_Add(const char *Fmt, uint8_t NumArgs, const uint32_t *Args);
+
+/**
+ * Expand the oldest message in the log ring and write it to the Terminal. Returns FALSE if the ring is empty or the
+ * Terminal has no room for the message, it is then left in the ring.
+ */
+extern bool Log_Flush(void);
+
+#else
+
+#define Log_Flush()  FALSE
+
+#endif
+
+#endif // __LOG_H
@@ -0,0 +1,55 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MEM_MON_H
+#define __MEM_MON_H
+
+#include "ProjectDefs.h"
+#include <stdlib.h>
+
+// Perform all memory monitoring inside #ifdef MEM_MON so that it is not done when undefining MEM_MON.
+// The RAM layout (heap start, stack top) comes from the linker script of the target build, the host builds have none.
+#if defined(__arm__) && !defined(UNIT_TEST)
+#define MEM_MON
+#endif
+
+// The free RAM between the heap and the main stack is filled with this pattern by Reset_Handler (startup_stm32f446xx.s)
+#define MEMMON_STACK_PATTERN   0xDEADBEEFU
+#define MEMMON_STACK_GUARD     256        // [bytes] sbrk refuses to grow the heap closer than this to the stack
+#define MEMMON_SCAN_WORDS      1024       // Words of the stack checked per step of the background scan
+
+// Statistics, see MemMon_ReadStat(). Sizes are in bytes and saturate at 0xFFFF.
+#define MEMMON_STAT_STACK_USED      0     // High-water mark of the main stack (MSP), i.e. main loop and all interrupts
+#define MEMMON_STAT_STACK_FREE      1     // Never used, between the top of the heap and the high-water mark of the stack
+#define MEMMON_STAT_HEAP_SIZE       2     // Heap obtained from sbrk, by all users of malloc (also printf of floats)
+#define MEMMON_STAT_HEAP_USED       3     // Allocated by MemMon_Malloc and not freed
+#define MEMMON_STAT_HEAP_USED_MAX   4
+#define MEMMON_STAT_ALLOC_FAILS     5     // Failed MemMon_Malloc and refused sbrk calls
+#define MEMMON_NUM_STATS            6
+
+#ifdef MEM_MON
+
+/**
+ * Tracked malloc/free, e.g. for USBH_malloc. Each block has a header with its size.
+ */
+extern void *MemMon_Malloc(size_t Size);
+extern void MemMon_Free(void *Ptr);
+
+/**
+ * Starts a background scan of the painted stack for the high-water mark. Call periodically.
+ */
+extern void MemMon_500ms(void);
+
+/**
+ * Read memory statistics: Indx = MEMMON_STAT_XXX
+ */
+extern uint16_t MemMon_ReadStat(uint16_t Indx);
+
+extern void MemMon_PrintStats(void);
+
+#else
+
+#define MemMon_Malloc  malloc
+#define MemMon_Free    free
+
+#endif
+
+#endif // __MEM_MON_H
@@ -2,6 +2,78 @@
 #ifndef __MODBUS_H
 #define __MODBUS_H
 
+#include <stddef.h>
+#include "ProjectDefs.h"
+
+#define MODBUS_MAX_PDU_SIZE  253    // Function code and data, the RTU frame adds address and CRC, the TCP frame the MBAP header
+
+// ----------------------------------------------------------------------------
+// Register map: a table of address ranges, sorted by address (see ExportedSignals.c). A range is typed storage, copied
+// in bulk, or a pair of accessors called per register. 32-bit types take two registers, high word first.
+// The storage may be in a snapshot published by a rate group: Data is then the pointer to the current snapshot, which
+// is read once per range and request.
+// ----------------------------------------------------------------------------
+typedef enum {
+  MODBUS_U16 = 0,
+  MODBUS_I16,
+  MODBUS_U32,
+  MODBUS_I32,
+  MODBUS_F32,                   // IEEE 754 single precision
+  MODBUS_F32_SCALED,            // float exported as one register, the value * Scale rounded to int16
+} Modbus_Type;
+
+#define MODBUS_READ   0x01
+#define MODBUS_WRITE  0x02
+#define MODBUS_RW     (MODBUS_READ | MODBUS_WRITE)
+
+#define MODBUS_TYPE_SIZE(TYPE)  (((TYPE) == MODBUS_U16 || (TYPE) == MODBUS_I16) ? 2U : 4U)   // Bytes of storage
+#define MODBUS_TYPE_REGS(TYPE)  (((TYPE) == MODBUS_U32 || (TYPE) == MODBUS_I32 || (TYPE) == MODBUS_F32) ? 2U : 1U)
+
+// Indx is the register from the start of the range. A write is called twice: first with Commit FALSE to check the
+// value, then with Commit TRUE if all values of the request are valid.
+typedef uint16_t (*Modbus_ReadFunc)(uint16_t Indx);
+typedef bool (*Modbus_WriteFunc)(uint16_t Indx, uint16_t Value, bool Commit);
+
+typedef struct {
+  uint16_t Address;             // First register
+  uint16_t Count;               // Registers
+  uint8_t Type;                 // Modbus_Type of the storage
+  uint8_t Access;               // MODBUS_READ and/or MODBUS_WRITE
+  void *Data;                   // Storage, NULL if the accessors are used
+  float Scale;                  // MODBUS_F32_SCALED
+  Modbus_ReadFunc Read;
+  Modbus_WriteFunc Write;
+  void (*Update)(void);         // If not NULL, called once per request before the range is read
+  bool Snapshot;                // Data is a (void *volatile *) to the snapshot, the storage is at Offset in it
+  uint16_t Offset;
+} Modbus_Range;
+
+// Use these macros to define the entries of the map. VAR is a variable or an array of the type, the number of
+// registers is computed from its size.
+#define MODBUS_STORAGE(ADDRESS, VAR, TYPE, ACCESS, UPDATE)  \
+  { ADDRESS, sizeof(VAR) / MODBUS_TYPE_SIZE(TYPE) * MODBUS_TYPE_REGS(TYPE), TYPE, ACCESS, (void *)&(VAR), 0.0f, NULL, NULL, \
+    UPDATE, FALSE, 0 }
+#define MODBUS_SCALED(ADDRESS, VAR, SCALE, ACCESS, UPDATE)  \
+  { ADDRESS, sizeof(VAR) / sizeof(float), MODBUS_F32_SCALED, ACCESS, (void *)&(VAR), SCALE, NULL, NULL, UPDATE, FALSE, \
+    0 }
+#define MODBUS_ACCESSOR(ADDRESS, COUNT, ACCESS, READ, WRITE)  \
+  { ADDRESS, COUNT, MODBUS_U16, ACCESS, NULL, 0.0f, READ, WRITE, NULL, FALSE, 0 }
+// MEMBER of the snapshot struct STRUCT, FRONT is the (void *volatile) pointer to the current snapshot. Read only.
+#define MODBUS_SNAPSHOT(ADDRESS, FRONT, STRUCT, MEMBER, TYPE)  \
+  { ADDRESS, sizeof(((STRUCT *)0)->MEMBER) / MODBUS_TYPE_SIZE(TYPE) * MODBUS_TYPE_REGS(TYPE), TYPE, MODBUS_READ, \
+    (void *)&(FRONT), 0.0f, NULL, NULL, NULL, TRUE, offsetof(STRUCT, MEMBER) }
+
+// Checks the register map and indexes it, registers the callbacks of ModbusPort and starts the frame timer (TIM7) and
+// the serve interrupt (CAN2_SCE), after Uart_Init() and FlashE2p_Init()
+void Modbus_Init(void);
+// Takes a new baud rate into use and times out a response whose TC interrupt never came. Call from Loop4ms.
 void Modbus_4ms(void);
 
+/**
+ * Serve a request PDU (function code and data, Length bytes) with the register map of the slave and put the response
+ * PDU in Response, MODBUS_MAX_PDU_SIZE bytes. Errors get an exception response. Returns the length of the response.
+ * Shared by RTU and TCP: call at the priority of the 4 ms rate group, or with Scheduler_Lock() held.
+ */
+uint16_t Modbus_ServePdu(const uint8_t *Request, uint16_t Length, uint8_t *Response);
+
 #endif  // __MODBUS_H
\ No newline at end of file
@@ -0,0 +1,16 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MODBUS_TCP_H
+#define __MODBUS_TCP_H
+
+#include "ProjectDefs.h"
+
+#define MODBUS_TCP_PORT         502
+#define MODBUS_TCP_MAX_CLIENTS  4     // Connections served at the same time, a further one is refused
+
+/**
+ * Modbus TCP server on the lwIP raw API. The requests are served by Modbus_ServePdu(), i.e. with the register map of
+ * the RTU slave. Call from Network_Init(), after lwip_init().
+ */
+extern void ModbusTcp_Init(void);
+
+#endif // __MODBUS_TCP_H
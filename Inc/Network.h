@@ -26,6 +26,7 @@
 
 
 void Network_Init(void);
-void Network_1ms(void);
+// Passes all received frames to lwIP and handles its timeouts. Call every 4 ms, from the Network rate group.
+void Network_4ms(void);
 
 #endif // __NETWORK_H
\ No newline at end of file
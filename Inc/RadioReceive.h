@@ -18,6 +18,5 @@
 
 
 extern void RadioReceive_Init(void);
-extern void RadioReceieve_100ms(void);
 
 #endif // __RADIO_RECEIVE_H
@@ -0,0 +1,138 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include "ProjectDefs.h"
+
+#define SCHEDULER_MAX_TASKS   8     // Size of the statistics area exported over Modbus, i.e. max number of tasks in a table
+
+// Statistics exported per task, see Scheduler_ReadStat(). Times are in us and saturate at 0xFFFF.
+#define SCHEDULER_STAT_ACTIVATIONS      0   // Number of times the task has executed (lower 16 bits)
+#define SCHEDULER_STAT_MISSED           1   // Activations lost because the previous one had not started yet
+#define SCHEDULER_STAT_BUDGET_OVERRUNS  2   // Number of executions that took longer than BudgetUs
+#define SCHEDULER_STAT_EXEC_TIME        3   // Execution time of last activation
+#define SCHEDULER_STAT_EXEC_TIME_MAX    4
+#define SCHEDULER_STAT_JITTER_MAX       5   // Max time from release (in SysTick) to start of execution
+#define SCHEDULER_STAT_CPU_LOAD         6   // [0.1 %] Share of the CPU used by the task during the last load period
+#define SCHEDULER_NUM_STATS             7
+
+#define SCHEDULER_LOAD_PERIOD_MS  1000    // CPU load is calculated over this period
+
+// Rate groups can execute in the main loop, or preemptively in a software interrupt. For the latter an unused peripheral
+// interrupt vector (CAN1 and CAN2 but CAN2_SCE, see Scheduler.c) is pended from SysTick. Lower priority number = higher priority.
+// Assign the priorities rate monotonic, i.e. the shorter the period the higher the priority. All rate group priorities
+// shall be in the range below, so SysTick (TICK_INT_PRIORITY = 8), its bottom half in PendSV (9) and the peripheral
+// interrupts preempt the rate groups.
+#define SCHEDULER_PRIO_HIGHEST  10
+#define SCHEDULER_PRIO_LOWEST   15
+#define SCHEDULER_NO_IRQ        ((IRQn_Type)-128)   // Task is executed in the main loop by Scheduler_Run()
+
+// Use these macros to define the entries in the task table
+#define SCHEDULER_TASK(NAME, FUNC, PERIOD_MS, OFFSET_MS, BUDGET_US)  \
+  { NAME, FUNC, PERIOD_MS, OFFSET_MS, BUDGET_US, SCHEDULER_NO_IRQ, SCHEDULER_PRIO_LOWEST }
+#define SCHEDULER_IRQ_TASK(NAME, FUNC, PERIOD_MS, OFFSET_MS, BUDGET_US, IRQN, PRIO)  \
+  { NAME, FUNC, PERIOD_MS, OFFSET_MS, BUDGET_US, IRQN, PRIO }
+
+typedef struct {
+  // ------ Configuration ------
+  const char *Name;
+  void (*Func)(void);
+  uint16_t PeriodMs;
+  uint16_t OffsetMs;              // Phase offset. Task is released on the ticks where (Tick % PeriodMs) == OffsetMs
+  uint32_t BudgetUs;              // Allowed execution time
+  IRQn_Type IRQn;                 // Software interrupt of the task or SCHEDULER_NO_IRQ
+  uint8_t Priority;               // Interrupt priority if IRQn is used
+
+  // ------ Runtime data, leave out when defining the table ------
+  volatile uint16_t TicksToRelease;
+  volatile bool Pending;
+  volatile uint32_t ReleaseTime;  // Timer 2 value when the task was released
+  volatile uint32_t Missed;
+  uint32_t Activations;
+  uint32_t BudgetOverruns;
+  uint32_t ExecTime;              // [us]
+  uint32_t ExecTimeMax;           // [us]
+  uint32_t StartJitter;           // [us]
+  uint32_t StartJitterMax;        // [us]
+  uint32_t Cycles;                // CPU cycles used in the current load period, excluding preemption by other rate groups
+  uint16_t CpuLoad;               // [0.1 %]
+} Scheduler_Task;
+
+/**
+ * Set up the task table. Tasks are given priority in table order, i.e. put the fastest rate group first.
+ * Timer 2 is used for time measurement, thus InputCapture_Init() must have been called before the scheduler is started.
+ * The DWT cycle counter is started and used for the CPU load measurement.
+ */
+extern void Scheduler_Init(Scheduler_Task *Tasks, uint16_t NumTasks);
+
+/**
+ * Called every ms from the SysTick bottom half (PendSV). Releases the tasks that are due and counts missed activations.
+ */
+extern void Scheduler_Tick(void);
+
+/**
+ * Called from the main loop. Executes the highest priority pending task that is not bound to an interrupt, if any.
+ * Returns TRUE if a task was executed.
+ */
+extern bool Scheduler_Run(void);
+
+/**
+ * Called from the main loop when Scheduler_Run() had nothing to do. Sleeps (WFI) until the next interrupt, e.g. SysTick
+ * releasing a task, and accumulates the idle time for the CPU load measurement.
+ * WorkPending (may be NULL) is called with interrupts disabled to check for other main loop work, e.g. events, before sleeping.
+ */
+extern void Scheduler_Idle(bool (*WorkPending)(void));
+
+/**
+ * Total CPU load [0.1 %] during the last load period, i.e. the time not spent in Scheduler_Idle(). Includes all interrupts.
+ */
+extern uint16_t Scheduler_CpuLoad(void);
+
+/**
+ * Masks the rate group interrupts, but not SysTick and the peripheral interrupts, by raising BASEPRI to SCHEDULER_PRIO_HIGHEST.
+ * Use it to protect short read-modify-write sequences on data shared between rate groups. Returns the value to pass to Scheduler_Unlock.
+ */
+extern uint32_t Scheduler_Lock(void);
+extern void Scheduler_Unlock(uint32_t PrevLock);
+
+// ------ Mailbox ------
+// Passes a block of data (e.g. a struct of signals) from one rate group to another without locks, regardless of which of them
+// has the higher priority. Triple buffered: the writer always fills a buffer that is neither the latest one nor the one being read,
+// so the reader gets a consistent copy of the latest complete write. One writer and one reader per mailbox.
+#define SCHEDULER_MAILBOX_NO_BUFFER  3
+
+typedef struct {
+  uint8_t *Buffer;                // Storage of 3 * Size bytes
+  uint16_t Size;
+  volatile uint8_t Latest;        // Buffer with the latest complete write
+  volatile uint8_t Reading;       // Buffer currently read or SCHEDULER_MAILBOX_NO_BUFFER
+} Scheduler_Mailbox;
+
+// Use this macro to define a mailbox for an object of type TYPE
+#define SCHEDULER_MAILBOX(NAME, TYPE)  \
+  static TYPE NAME##_Storage[3];        \
+  Scheduler_Mailbox NAME = { (uint8_t *)NAME##_Storage, sizeof(TYPE), 0, SCHEDULER_MAILBOX_NO_BUFFER }
+
+extern void Scheduler_MailboxWrite(Scheduler_Mailbox *Mailbox, const void *Data);
+extern void Scheduler_MailboxRead(Scheduler_Mailbox *Mailbox, void *Data);
+
+/**
+ * Name of the task at TaskIndx in the task table, NULL if there is no such task
+ */
+extern const char *Scheduler_TaskName(uint16_t TaskIndx);
+
+/**
+ * Read task statistics as a flat array: Indx = TaskIndx * SCHEDULER_NUM_STATS + SCHEDULER_STAT_XXX
+ */
+extern uint16_t Scheduler_ReadStat(uint16_t Indx);
+
+/**
+ * Worst case CPU demand [us] of a single tick, i.e. the sum of the max execution times of the tasks released on the same tick.
+ * All ticks in the hyper period are checked. If UseOffsets is FALSE, all tasks are analysed as if they had offset 0.
+ * The tick (within the hyper period) with the highest demand is returned in PeakTick.
+ */
+extern uint32_t Scheduler_PeakTickDemand(bool UseOffsets, uint32_t *PeakTick);
+
+extern void Scheduler_PrintStats(void);
+
+#endif // __SCHEDULER_H
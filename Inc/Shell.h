@@ -0,0 +1,34 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SHELL_H
+#define __SHELL_H
+
+#include "ProjectDefs.h"
+
+#define SHELL_LINE_LEN       80     // Longest command line, incl. the terminating zero
+#define SHELL_MAX_ARGS       4      // Command name incl., further words are ignored
+#define SHELL_BYTES_PER_STEP 16     // Characters edited per background step
+
+/**
+ * Execute one step of a command and return TRUE when it is finished. State is 0 at the first step, keep the position
+ * of the command there. Print at most a few lines per step, the output is copied to the Terminal ring.
+ */
+typedef bool (*Shell_CmdFunc)(uint8_t Argc, char *Argv[], uint32_t *State);
+
+typedef struct {
+  const char *Name;
+  const char *Args;             // Usage, for help
+  const char *Help;
+  Shell_CmdFunc Func;
+} Shell_Command;
+
+// Use this macro to define the entries in the command table
+#define SHELL_COMMAND(NAME, ARGS, HELP, FUNC)  { NAME, ARGS, HELP, FUNC }
+
+/**
+ * Command shell on the Terminal (USART3). The line is edited as the characters arrive (echo, backspace, Ctrl-C) and
+ * the command is executed in steps, both in a background job, so the shell never delays a rate group.
+ * Call after Uart_Init().
+ */
+extern void Shell_Init(void);
+
+#endif // __SHELL_H
@@ -3,20 +3,77 @@
 #define __TICTOC_H
 
 #include "ProjectDefs.h"
-#include "InputCapture.h"
 
-// Perform all TicToc measurements inside #ifdef TIC_TOC so that they are not done when undefining TIC_TOC
-#define TIC_TOC 
+// Perform all TicToc measurements inside #ifdef TIC_TOC so that they are not done when undefining TIC_TOC.
+// The probes read the DWT cycle counter, which does not exist in the unit tests.
+#ifndef UNIT_TEST
+#define TIC_TOC
+#endif
+
+// Probe regions. Add new probes before TICTOC_NUM_PROBES and give them a name in TicToc.c
+typedef enum {
+  TICTOC_SYSTICK_ISR = 0,
+  TICTOC_PENDSV_ISR,
+  TICTOC_TIM13_ISR,
+  TICTOC_TIM14_ISR,           // NeoPixel
+  TICTOC_MODBUS_SERVE,        // Modbus_ServeRequest
+  TICTOC_MODBUS_TURNAROUND,   // IDLE interrupt after the request to the response queued, see Modbus.c
+  TICTOC_UTIL_INTERPOLATE,
+  TICTOC_CRC16,
+  TICTOC_ETH_INPUT,           // ethernetif_input
+  TICTOC_NUM_PROBES
+} TicToc_ProbeId;
+
+#define TICTOC_HIST_BINS       16
+#define TICTOC_HIST_MIN_LOG2   5    // Bin 0 counts times below 2^(TICTOC_HIST_MIN_LOG2 + 1) cycles, the last bin all above
+
+// Statistics per probe, read as a flat array over Modbus. 32-bit values are two registers, high word first.
+#define TICTOC_STAT_COUNT      0    // Number of measurements (lower 16 bits)
+#define TICTOC_STAT_MIN_H      1    // [cycles]
+#define TICTOC_STAT_MIN_L      2
+#define TICTOC_STAT_MAX_H      3
+#define TICTOC_STAT_MAX_L      4
+#define TICTOC_STAT_MEAN_H     5
+#define TICTOC_STAT_MEAN_L     6
+#define TICTOC_STAT_HIST       7    // TICTOC_HIST_BINS registers, counts saturate at 0xFFFF
+#define TICTOC_NUM_STATS       (TICTOC_STAT_HIST + TICTOC_HIST_BINS)
 
 #ifdef TIC_TOC
-extern volatile uint32_t TicToc_Tim13IrqStart;
-extern volatile uint32_t TicToc_Tim13IrqEnd;
 
+typedef struct {
+  uint32_t Count;
+  uint32_t Min;               // [cycles], measurement overhead subtracted
+  uint32_t Max;
+  uint64_t Sum;
+  uint32_t Hist[TICTOC_HIST_BINS];
+} TicToc_Probe;
+
+// Mark the start and the end of a probe region in the same block. Regions may be nested and used in interrupts.
+#define TIC(ID)  uint32_t TicToc_Start_##ID = DWT->CYCCNT
+#define TOC(ID)  TicToc_Record(ID, DWT->CYCCNT - TicToc_Start_##ID)
+
+/**
+ * Measure the overhead of TIC/TOC, it is subtracted from all measurements. Call when the DWT counter is running.
+ */
+extern void TicToc_Init(void);
+
+extern void TicToc_Record(TicToc_ProbeId Id, uint32_t Cycles);
+
+extern void TicToc_Reset(void);
+
+/**
+ * Read probe statistics as a flat array: Indx = ProbeId * TICTOC_NUM_STATS + TICTOC_STAT_XXX
+ */
+extern uint16_t TicToc_ReadStat(uint16_t Indx);
+
+extern void TicToc_PrintStats(void);
+
+#else
 
-//extern void TicToc_Init(void);
-extern void TicToc_20ms(void);
+#define TIC(ID)
+#define TOC(ID)
 
 #endif
 
 
-#endif // __TIC_TOC_H
\ No newline at end of file
+#endif // __TIC_TOC_H
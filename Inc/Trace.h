@@ -0,0 +1,83 @@
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include "ProjectDefs.h"
+
+// Define TRACE to stream binary trace records on the Terminal (USART3), interleaved with the text output.
+// The Terminal then runs at TRACE_BAUD_RATE. Capture the stream to a file and decode it with IDE/Tools/TraceDecode.c.
+//#define TRACE
+
+#define TRACE_BAUD_RATE    921600
+#define TRACE_RING_SIZE    512      // Records, power of 2
+
+// Record types. The MSB is set in the first byte of a record, so records can not be confused with the (ASCII) text.
+#define TRACE_RECORD_MARK  0x80
+typedef enum {
+  TRACE_TASK_START = 0,             // Id = index in the task table
+  TRACE_TASK_STOP,
+  TRACE_ISR_ENTER,                  // Id = IrqMon_Id, i.e. the interrupts monitored by IrqMon
+  TRACE_ISR_EXIT,
+  TRACE_EVENT,                      // Id = Trace_EventId
+  TRACE_LOST,                       // Data = number of records lost because the ring was full
+  TRACE_LOG,                        // Id = number of arguments, Data = format ID (see Log.h)
+  TRACE_LOG_ARG,                    // Follows TRACE_LOG, Id = argument index, the argument is in Timestamp
+} Trace_Type;
+
+// User events. Add new ones before TRACE_NUM_EVENTS and give them a name in Trace.c
+typedef enum {
+  TRACE_EVT_MODBUS_REQUEST = 0,     // Data = function code
+  TRACE_EVT_RADIO_SILENCE,          // Data = RxBuffIndx
+  TRACE_EVT_BGJOB_DONE,             // Data = number of runs of the job
+  TRACE_EVT_SHELL_TRIGGER,          // Data = argument of the trace trigger command, marks a point in the capture
+  TRACE_NUM_EVENTS
+} Trace_EventId;
+
+// 8 bytes, sent little endian as is
+typedef struct {
+  uint8_t Type;                     // TRACE_RECORD_MARK | Trace_Type
+  uint8_t Id;
+  uint16_t Data;
+  uint32_t Timestamp;               // DWT cycle counter
+} Trace_Record;
+
+#ifdef TRACE
+
+#define TRACE_RECORD(TYPE, ID, DATA)  Trace_Add((TYPE), (ID), (DATA))
+
+extern void Trace_Add(Trace_Type Type, uint8_t Id, uint16_t Data);
+
+/**
+ * Add a log message, see LOG() in Log.h. The message and its arguments are added together, or lost together.
+ */
+extern void Trace_AddLog(const char *Fmt, uint8_t NumArgs, const uint32_t *Args);
+
+/**
+ * Start and stop recording, e.g. to freeze the records around an event until they have been captured. Records added
+ * while stopped are dropped, not counted as lost. Recording is on after reset.
+ */
+extern void Trace_Enable(bool Enable);
+extern bool Trace_Enabled(void);
+
+/**
+ * Called by the Terminal (Uart.c) when it has no text to send, with its DMA interrupt masked. Returns the size in bytes
+ * of the next contiguous block of records, 0 if none, and its address in Data. The block stays in the ring until
+ * Trace_BlockSent(). Records added meanwhile are sent by the next call, the Terminal is restarted periodically by
+ * Uart_TransmitTerminalBuffer().
+ */
+extern uint16_t Trace_NextBlock(const uint8_t **Data);
+extern void Trace_BlockSent(void);
+
+/**
+ * Print the names of the tasks, interrupts and events as text lines ("#trace ...") for the decoder. Printed periodically,
+ * so a capture started at any time can be decoded.
+ */
+extern void Trace_PrintNames(void);
+
+#else
+
+#define TRACE_RECORD(TYPE, ID, DATA)
+
+#endif
+
+#endif // __TRACE_H
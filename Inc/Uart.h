@@ -8,50 +8,159 @@
 #include "stdio.h"
 
 #define USART3_BUFF_SIZE  8192
-#define USART3_BUFF_END_INDX  (USART3_BUFF_SIZE - 16)  
+
+#define UART_PRINTF_MAX_LEN    256    // Longest message of one UART_PRINTF, longer ones are truncated
+#define UART_TERMINAL_RESERVE  16     // Bytes of the Terminal ring kept for the BUFFER_FULL message
+#define UART_TERMINAL_CHUNK    512    // Max bytes per DMA transfer, so the ring is released while a long text is sent
+
+// Define to measure the Terminal throughput at a few baud rates after startup, see Uart_Benchmark_4ms()
+//#define UART_BENCHMARK
 
 #define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 #define UART_PRINTF(...)  Uart_printf(__FILENAME__, __LINE__, __VA_ARGS__)
-/*
-#define UART_PRINTF(...)  \
-do { \
-  if ( TerminalPort.Tx.Indx < USART3_BUFF_END_INDX ) { \
-    TerminalPort.Tx.Indx += snprintf(TerminalPort.Tx.Buffer + TerminalPort.Tx.Indx, (USART3_BUFF_END_INDX - TerminalPort.Tx.Indx), __VA_ARGS__); \
-    if ( TerminalPort.Tx.Indx >= USART3_BUFF_END_INDX ) \
-      TerminalPort.Tx.Indx += snprintf(TerminalPort.Tx.Buffer + TerminalPort.Tx.Indx, 16, "\r\nBUFFER_FULL\r\n"); \
-  } \
-} while (0)
-*/
+
 typedef struct {
   uint8_t  *Buffer;
   uint16_t Size;
-  uint16_t Indx;
+  uint16_t Indx;      // Next byte to write
+  uint16_t Tail;      // Ring buffers: first byte not yet consumed, the ring is empty when Indx == Tail
 } Buffer_t;
 
+#define UART_RX_FRAMES       4        // Frame ends queued per port, power of 2. When full the newest frames are merged.
+#define UART_RX_IRQ_PRIO     9        // USART and Rx DMA. Above the rate groups (see Scheduler.h), a frame is complete when the line goes idle
+#define UART_TX_IRQ_PRIO     10       // Tx DMA. As the highest rate group, so Scheduler_Lock() masks the chaining of transfers
+
+// Uart_Config.Parity and StopBits, the bits of CR1 and CR2. With parity the word is 9 bits: 8 data bits and the parity bit.
+#define UART_PARITY_NONE     0U
+#define UART_PARITY_EVEN     USART_CR1_PCE
+#define UART_PARITY_ODD      (USART_CR1_PCE | USART_CR1_PS)
+#define UART_STOPBITS_1      0U
+#define UART_STOPBITS_2      USART_CR2_STOP_1
+
+typedef struct UartPort UartPort;
+typedef void (*Uart_Callback)(UartPort *Port);
+
+typedef struct Uart_TxDesc Uart_TxDesc;
+typedef void (*Uart_TxDescCallback)(Uart_TxDesc *Desc);
+
+// Transmit descriptor: a buffer owned by the caller, sent by DMA without a copy. The descriptor and the buffer must be
+// left untouched from Uart_Send until OnSent.
+struct Uart_TxDesc {
+  const uint8_t *Data;
+  uint16_t Length;
+  Uart_TxDescCallback OnSent;           // Called from the Tx DMA interrupt when the DMA is done with Data, may be NULL
+  void *Context;                        // For the owner
+  // ------ Driver ------
+  Uart_TxDesc *Next;
+  uint16_t RingMark;                    // Uart_SendTerminal: end of the text written before it
+};
+
+// Hardware of a port, one row per port in Uart_Configs (Uart.c)
 typedef struct {
+  UartPort *Port;
+  USART_TypeDef *Usart;                 // Any USART/UART, the clock and APB bus are derived from it
+  IRQn_Type UsartIrq;
+  uint32_t BaudRate;
+  uint32_t Parity;                      // UART_PARITY_XXX
+  uint32_t StopBits;                    // UART_STOPBITS_XXX
+  DMA_Stream_TypeDef *DmaRx;            // Stream and channel of the USART in the DMA request mapping of the reference manual
+  uint32_t DmaRxChannel;                // DMA_CHANNEL_X
+  IRQn_Type DmaRxIrq;
+  DMA_Stream_TypeDef *DmaTx;
+  uint32_t DmaTxChannel;
+  IRQn_Type DmaTxIrq;
+  GPIO_TypeDef *GpioPort;               // Rx and Tx pins, on one port
+  uint32_t GpioPins;
+  uint32_t GpioMode;                    // GPIO_MODE_AF_PP or GPIO_MODE_AF_OD
+  uint32_t GpioAlternate;
+  GPIO_TypeDef *DePort;                 // RS-485 driver enable, high from the start of a transmission until TC. NULL if none.
+  uint16_t DePin;
+  uint8_t *RxBuffer;
+  uint16_t RxSize;
+  uint8_t *TxBuffer;
+  uint16_t TxSize;
+} Uart_Config;
+
+struct UartPort {
+  const Uart_Config *Config;
   USART_TypeDef *Usart;
   DMA_Stream_TypeDef *DMAStream_Rx;
   DMA_Stream_TypeDef *DMAStream_Tx;
-  Buffer_t Rx;
+  Buffer_t Rx;        // Circular DMA: Indx is the DMA position at the last IDLE/HT/TC interrupt, Tail the consumer
   Buffer_t Tx;
-} UartPort;
+  // ------ Transmitter, the queue is changed with the Tx DMA interrupt masked (Scheduler_Lock) ------
+  Uart_TxDesc *TxHead;                  // Being sent, NULL when the transmitter is idle
+  Uart_TxDesc *TxTail;                  // Last queued
+  Uart_TxDesc TxBufferDesc;             // Used by Uart_StartTransmitter
+  // ------ Receiver, the interrupts write the Rx counters and frame ends, the consumer only RxRead and RxFramesOut ------
+  volatile uint32_t RxWritten;          // Bytes received, free running
+  uint32_t RxRead;                      // Bytes consumed, free running
+  volatile uint32_t RxFrameEnds[UART_RX_FRAMES];  // RxWritten when the line went idle
+  volatile uint8_t RxFramesIn;
+  uint8_t RxFramesOut;
+  uint32_t RxOverruns;                  // The DMA has overwritten bytes not consumed
+  // ------ Completion callbacks, called from the interrupts of the port. May be NULL. ------
+  Uart_Callback OnRxIdle;               // The line went idle after a frame (USART interrupt)
+  Uart_Callback OnTxDmaDone;            // A descriptor is done, after its OnSent. Characters may still be sent (Tx DMA interrupt).
+  Uart_Callback OnTxComplete;           // The queue is empty and the last character has been sent (USART interrupt)
+};
 
 
 UartPort TerminalPort;
 UartPort ModbusPort;
 
+// Initializes all ports of Uart_Configs
 void Uart_Init(void);
+void Uart_InitPort(const Uart_Config *Config);
+void Uart_SetBaudRate(UartPort *Port, uint32_t BaudRate);
+uint32_t Uart_GetBaudRate(const UartPort *Port);
+// Bits of one character on the line: start, data, parity and stop bits
+uint16_t Uart_CharBits(const UartPort *Port);
 void Uart_20ms(void);
 
-uint16_t Uart_MessageReceived(UartPort *Port);
+/**
+ * Reception never stops: the Rx DMA is circular and the IDLE, half and full transfer interrupts count the bytes.
+ * Uart_ReadFrame copies the next frame (the bytes up to an idle line) and returns its size, 0 if there is none. A frame
+ * longer than MaxBytes is truncated. Uart_Read copies what has been received, frames or not, Data NULL discards it.
+ * Call both from one consumer per port.
+ * Uart_RxDmaPosition is the position of the Rx DMA in the ring, it changes with each byte received. The counts above
+ * are only updated by the interrupts.
+ */
+uint16_t Uart_ReadFrame(UartPort *Port, uint8_t *Data, uint16_t MaxBytes);
+uint16_t Uart_Read(UartPort *Port, uint8_t *Data, uint16_t MaxBytes);
+uint16_t Uart_RxDmaPosition(const UartPort *Port);
 void Uart_StopReceiver(UartPort *Port);
 void Uart_StartReceiver(UartPort *Port);
+/**
+ * Scatter-gather transmission: Uart_Send queues a descriptor, e.g. header, payload and CRC of a message each in their
+ * own buffer. The Tx DMA interrupt releases each descriptor (OnSent) and starts the next, so they are sent back to back.
+ * OnTxComplete of the port is called when the last character of the queue has left, e.g. to turn the bus around.
+ * Any context below the Tx DMA interrupt may queue. Do not use on the Terminal, see Uart_SendTerminal.
+ * Uart_StartTransmitter sends BytesToSend of the Tx buffer of the port, Uart_TransmissionComplete polls the TC flag.
+ */
+void Uart_Send(UartPort *Port, Uart_TxDesc *Desc);
 bool Uart_TransmissionComplete(UartPort *Port);
+// Stops at once, queued descriptors are dropped without OnSent
 void Uart_StopTransmitter(UartPort *Port);
 void Uart_StartTransmitter(UartPort *Port, uint16_t BytesToSend);
 
+/**
+ * The Terminal Tx buffer is a ring. Text is copied to it and the DMA transfer is started at once if the Terminal is
+ * idle, the transfer complete interrupt chains the next contiguous chunk (and the trace records when TRACE is defined).
+ * Writers never wait: a message that does not fit is dropped whole. Returns FALSE if it was dropped.
+ */
+bool Uart_WriteTerminal(const uint8_t *Data, uint16_t Length);
+// Sends the buffer of Desc on the Terminal without a copy, after the text written so far. Returns FALSE before Uart_Init().
+bool Uart_SendTerminal(Uart_TxDesc *Desc);
+// Starts the transmission if the Terminal is idle. Needed for the trace records only, text is started when written.
 void Uart_TransmitTerminalBuffer(void);
+// TRUE when all text written has been transmitted
 bool Uart_TerminalBufferEmpty(void);
+// Bytes that can be written now without the message being dropped
+uint16_t Uart_TerminalFree(void);
+#ifdef UART_BENCHMARK
+void Uart_Benchmark_4ms(void);
+#endif
 void Uart_PrintRegisters(void);
 
 void Uart_printf(const char *SourceFilename, int SourceLineno, const char *CFormatString, ...);
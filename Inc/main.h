@@ -48,6 +48,9 @@
 
 /* Exported macro ------------------------------------------------------------*/
 
+/* Exported functions ------------------------------------------------------- */
+extern void Main_TickBottomHalf(void);
+
 #endif /* __MAIN_H */
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -51,6 +51,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "MemMon.h"
 
 /* Exported types ------------------------------------------------------------*/
 #define USBH_MAX_NUM_ENDPOINTS                2
@@ -72,8 +73,8 @@
 #endif
 
 /* Memory management macros */   
-#define USBH_malloc               malloc
-#define USBH_free                 free
+#define USBH_malloc               MemMon_Malloc
+#define USBH_free                 MemMon_Free
 #define USBH_memset               memset
 #define USBH_memcpy               memcpy
     
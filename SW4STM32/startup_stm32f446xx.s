@@ -105,6 +105,17 @@ LoopFillZerobss:
   cmp  r2, r3
   bcc  FillZerobss
 
+/* Paint the free RAM between the heap start and the stack, for the stack high-water mark (MemMon.c) */
+  ldr  r2, =end
+  ldr  r3, =0xDEADBEEF     /* MEMMON_STACK_PATTERN */
+  b  LoopPaintStack
+PaintStack:
+  str  r3, [r2], #4
+
+LoopPaintStack:
+  cmp  r2, sp
+  bcc  PaintStack
+
 /* Call the clock system intitialization function.*/
   bl  SystemInit   
 /* Call static constructors */
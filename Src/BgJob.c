@@ -0,0 +1,151 @@
+/**
+******************************************************************************
+* @file    /Src/BgJob.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Background jobs. Long operations (flash erase, file writes, printing) are written as resumable steps and
+*          executed in the main loop, i.e. in the time left by the rate groups, in time slices of BGJOB_SLICE_US.
+*          Jobs are linked into a list the first time they are started and then stay there, active or not.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ProjectDefs.h"
+#include "BgJob.h"
+#include "Scheduler.h"
+#include "InputCapture.h"
+#include "Util.h"
+#include "Uart.h"
+#include "Trace.h"
+
+#define TIM2_TICKS_PER_US  (TIM2_CLOCK_FREQ / 1000000U)
+
+static BgJob *BgJob_First = NULL;
+static BgJob *BgJob_Last = NULL;
+static BgJob *BgJob_Current = NULL;     // Job that got the last time slice
+
+
+bool BgJob_Start(BgJob *Job)
+{
+  uint32_t Lock = Scheduler_Lock();     // Jobs can be started from all rate groups
+
+  if (Job->Active)
+  {
+    Scheduler_Unlock(Lock);
+    return FALSE;
+  }
+
+  if ((Job->Next == NULL) && (Job != BgJob_Last))   // Not in the list yet
+  {
+    if (BgJob_Last == NULL)
+    {
+      BgJob_First = Job;
+    }
+    else
+    {
+      BgJob_Last->Next = Job;
+    }
+    BgJob_Last = Job;
+  }
+  Job->State = 0;
+  Job->Progress = 0;
+  Job->Active = TRUE;                   // Set last, the main loop may start executing the job as soon as it is set
+
+  Scheduler_Unlock(Lock);
+  return TRUE;
+}
+
+bool BgJob_Active(const BgJob *Job)
+{
+  return Job->Active;
+}
+
+// Next active job after the current one, round robin
+static BgJob *BgJob_NextActive(void)
+{
+  BgJob *Start = (BgJob_Current != NULL) ? BgJob_Current : BgJob_Last;
+  BgJob *Job = Start;
+
+  if (Start == NULL)
+  {
+    return NULL;                        // No job started yet
+  }
+  do
+  {
+    Job = (Job->Next != NULL) ? Job->Next : BgJob_First;
+    if (Job->Active)
+    {
+      return Job;
+    }
+  } while (Job != Start);
+
+  return NULL;
+}
+
+bool BgJob_Run(void)
+{
+  BgJob *Job = BgJob_NextActive();
+  uint32_t SliceStart, StepStart, StepTime;
+  uint8_t LastProgress;
+
+  if (Job == NULL)
+  {
+    return FALSE;
+  }
+  BgJob_Current = Job;
+  LastProgress = Job->Progress;
+
+  SliceStart = InputCapture_GetCurrentTime();
+  do
+  {
+    StepStart = InputCapture_GetCurrentTime();
+    Job->Progress = Util_Min(Job->Step(Job), BGJOB_DONE);
+    StepTime = (InputCapture_GetCurrentTime() - StepStart) / TIM2_TICKS_PER_US;   // Includes preemption by the rate groups
+    Job->MaxStepTime = Util_Max(Job->MaxStepTime, StepTime);
+  } while ((Job->Progress < BGJOB_DONE) &&
+           (InputCapture_GetCurrentTime() - SliceStart < BGJOB_SLICE_US * TIM2_TICKS_PER_US));
+
+  if (Job->Progress >= BGJOB_DONE)
+  {
+    Job->Runs++;
+    TRACE_RECORD(TRACE_EVENT, TRACE_EVT_BGJOB_DONE, Job->Runs);
+    Job->Active = FALSE;                // Cleared before the callback, so the job can be restarted from it
+    if (Job->OnDone != NULL)
+    {
+      Job->OnDone(Job);
+    }
+  }
+  else if ((Job->Progress != LastProgress) && (Job->OnProgress != NULL))
+  {
+    Job->OnProgress(Job);
+  }
+  return TRUE;
+}
+
+bool BgJob_Pending(void)
+{
+  const BgJob *Job;
+
+  for (Job = BgJob_First; Job != NULL; Job = Job->Next)
+  {
+    if (Job->Active)
+    {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+// Print the job statistics to Terminal
+void BgJob_PrintStats(void)
+{
+  const BgJob *Job;
+
+  for (Job = BgJob_First; Job != NULL; Job = Job->Next)
+  {
+    UART_PRINTF("Job %-12s Runs %5lu  MaxStep %6lu us  %s %u %%\r\n", Job->Name, Job->Runs, Job->MaxStepTime,
+                Job->Active ? "Active" : "Idle", Job->Progress);
+  }
+}
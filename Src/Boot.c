@@ -0,0 +1,134 @@
+/**
+******************************************************************************
+* @file    /Src/Boot.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Boot sequencer. The control path is initialized first so the rate groups can start as early as possible,
+*          slow subsystems (network, USB, RTC) are initialized afterwards in the background.
+*          Each phase is timestamped with the DWT cycle counter and reported on the Terminal, to track startup time.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ProjectDefs.h"
+#include "Boot.h"
+#include "BgJob.h"
+#include "Uart.h"
+
+static Boot_Phase *Boot_Phases = NULL;
+static uint16_t Boot_NumPhases = 0;
+
+static uint32_t Boot_StartCycles = 0;
+static uint32_t Boot_StartTick = 0;       // [ms] since reset, i.e. time spent in HAL_Init and clock configuration
+static uint32_t Boot_SyncDoneUs = 0;      // Rate groups can start
+static uint32_t Boot_AllDoneUs = 0;
+
+static uint8_t Boot_DeferredStep(BgJob *Job);
+static void Boot_DeferredDone(BgJob *Job);
+
+static BgJob Boot_Job = BGJOB("Boot", Boot_DeferredStep, NULL, Boot_DeferredDone);
+
+
+// Time since Boot_RunSync() in us. The cycle counter wraps after 23 s at 180 MHz, enough for the boot.
+static uint32_t Boot_Now(void)
+{
+  return (DWT->CYCCNT - Boot_StartCycles) / (SystemCoreClock / 1000000U);
+}
+
+static void Boot_RunPhase(Boot_Phase *Phase)
+{
+  Phase->StartUs = Boot_Now();
+  Phase->Init();
+  Phase->DurationUs = Boot_Now() - Phase->StartUs;
+  Phase->Done = TRUE;
+}
+
+void Boot_RunSync(Boot_Phase *Phases, uint16_t NumPhases)
+{
+  Boot_Phase *Phase;
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;   // Enable the DWT cycle counter
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  Boot_StartCycles = DWT->CYCCNT;
+  Boot_StartTick = HAL_GetTick();
+
+  for (Phase = Phases; Phase < Phases + NumPhases; Phase++)
+  {
+    Phase->Done = FALSE;
+  }
+  Boot_Phases = Phases;
+  Boot_NumPhases = NumPhases;
+
+  for (Phase = Phases; Phase < Phases + NumPhases; Phase++)
+  {
+    if (Phase->Mode == BOOT_SYNC)
+    {
+      Boot_RunPhase(Phase);
+    }
+  }
+  Boot_SyncDoneUs = Boot_Now();
+}
+
+void Boot_StartDeferred(void)
+{
+  (void)BgJob_Start(&Boot_Job);
+}
+
+// One deferred phase per step. State is the index of the next phase to check.
+static uint8_t Boot_DeferredStep(BgJob *Job)
+{
+  Boot_Phase *Phase;
+
+  while (Job->State < Boot_NumPhases)
+  {
+    Phase = &Boot_Phases[Job->State++];
+    if (Phase->Mode == BOOT_DEFERRED)
+    {
+      Boot_RunPhase(Phase);
+      break;
+    }
+  }
+
+  if (Job->State >= Boot_NumPhases)
+  {
+    return BGJOB_DONE;
+  }
+  return (uint8_t)((100U * Job->State) / Boot_NumPhases);
+}
+
+static void Boot_DeferredDone(BgJob *Job)
+{
+  Boot_AllDoneUs = Boot_Now();
+  Boot_PrintReport();
+}
+
+bool Boot_Ready(void (*Init)(void))
+{
+  const Boot_Phase *Phase;
+
+  for (Phase = Boot_Phases; Phase < Boot_Phases + Boot_NumPhases; Phase++)
+  {
+    if (Phase->Init == Init)
+    {
+      return Phase->Done;
+    }
+  }
+  return FALSE;
+}
+
+// Print the boot timeline to Terminal
+void Boot_PrintReport(void)
+{
+  const Boot_Phase *Phase;
+
+  UART_PRINTF("\r\nBoot phase     Mode      Start[us]  Duration[us]\r\n");
+  for (Phase = Boot_Phases; Phase < Boot_Phases + Boot_NumPhases; Phase++)
+  {
+    UART_PRINTF("%-14s %-8s %10lu %13lu%s\r\n", Phase->Name, (Phase->Mode == BOOT_SYNC) ? "Sync" : "Deferred",
+                Phase->StartUs, Phase->DurationUs, Phase->Done ? "" : "  (not done)");
+  }
+  UART_PRINTF("Reset to boot start: %lu ms, control path up: %lu us, all phases done: %lu us\r\n",
+              Boot_StartTick, Boot_SyncDoneUs, Boot_AllDoneUs);
+}
@@ -11,6 +11,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "Crc.h"
+#include "TicToc.h"
 
 // Computed with function UnitTest_CrcTableGenerator using POLYNOMIAL 0x31 /* CRC-8-Dallas/Maxim Generator Polynomial */
 const uint8_t crc8_lookUp[256] =
@@ -72,13 +73,20 @@ static inline uint16_t Crc16_Update(uint16_t Crc, uint8_t byte)
   return Crc;
 }
 
-uint16_t Crc_CalcCrc16(const uint8_t *data, const uint32_t size)
+// Continues Crc over data, so a message in several buffers needs no copy. Start with CRC16_INIT.
+uint16_t Crc_UpdateCrc16(uint16_t Crc, const uint8_t *data, const uint32_t size)
 {
-  uint16_t CrcMem = 0xFFFF;
+  TIC(TICTOC_CRC16);
 
   for (int i = 0; i < size; i++)
   {
-    CrcMem = Crc16_Update(CrcMem, data[i]);
+    Crc = Crc16_Update(Crc, data[i]);
   }
-  return CrcMem;
-}
\ No newline at end of file
+  TOC(TICTOC_CRC16);
+  return Crc;
+}
+
+uint16_t Crc_CalcCrc16(const uint8_t *data, const uint32_t size)
+{
+  return Crc_UpdateCrc16(CRC16_INIT, data, size);
+}
@@ -0,0 +1,121 @@
+/**
+******************************************************************************
+* @file    /Src/EventQueue.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Lock-free event queues from interrupts to the main loop. An interrupt posts an event (handler + data) the moment
+*          something happens and the main loop executes the handlers run to completion, instead of polling flags every tick.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ProjectDefs.h"
+#include "EventQueue.h"
+#include "Util.h"
+#include "Uart.h"
+
+// The unit test interrupts the consumer at these points, to check all interleavings with the producer
+#ifdef UNIT_TEST
+extern void UnitTest_EventQueue_Preempt(void);
+#define EVENT_QUEUE_PREEMPTION_POINT()  UnitTest_EventQueue_Preempt()
+#else
+#define EVENT_QUEUE_PREEMPTION_POINT()
+#endif
+
+EVENT_QUEUE(EventQueue_Prio9, 32);
+
+// Dispatched in this order, i.e. highest interrupt priority first
+static EventQueue *const EventQueue_Queues[] =
+{
+  &EventQueue_Prio9,
+};
+
+#define NUM_QUEUES  (sizeof(EventQueue_Queues) / sizeof(EventQueue_Queues[0]))
+
+
+bool EventQueue_Post(EventQueue *Queue, EventQueue_Handler Handler, uint32_t Data)
+{
+  uint16_t Head = Queue->Head;
+  uint16_t Level = (uint16_t)(Head - Queue->Tail);
+  EventQueue_Event *Event;
+
+  if (Level >= Queue->Size)
+  {
+    Queue->Overflows++;
+    return FALSE;
+  }
+
+  Event = &Queue->Events[Head & (Queue->Size - 1U)];
+  Event->Handler = Handler;
+  Event->Data = Data;
+  __DMB();                              // The event must be in memory before it is published
+  Queue->Head = Head + 1U;
+
+  Queue->MaxLevel = Util_Max(Queue->MaxLevel, Level + 1U);
+  return TRUE;
+}
+
+bool EventQueue_Dispatch(EventQueue *Queue)
+{
+  EventQueue_Event Event;
+  uint16_t Tail = Queue->Tail;
+
+  EVENT_QUEUE_PREEMPTION_POINT();
+  if (Tail == Queue->Head)
+  {
+    return FALSE;
+  }
+  __DMB();                              // Read the event after Head, i.e. after it was published
+
+  EVENT_QUEUE_PREEMPTION_POINT();
+  Event = Queue->Events[Tail & (Queue->Size - 1U)];
+  EVENT_QUEUE_PREEMPTION_POINT();
+  __DMB();                              // Copy out the event before the slot is handed back to the producer
+  Queue->Tail = Tail + 1U;
+  EVENT_QUEUE_PREEMPTION_POINT();
+
+  Event.Handler(Event.Data);
+  return TRUE;
+}
+
+bool EventQueue_DispatchNext(void)
+{
+  uint16_t i;
+
+  for (i = 0; i < NUM_QUEUES; i++)
+  {
+    if (EventQueue_Dispatch(EventQueue_Queues[i]))
+    {
+      return TRUE;                      // Start over from the highest priority queue
+    }
+  }
+  return FALSE;
+}
+
+bool EventQueue_Pending(void)
+{
+  uint16_t i;
+
+  for (i = 0; i < NUM_QUEUES; i++)
+  {
+    if (EventQueue_Queues[i]->Head != EventQueue_Queues[i]->Tail)
+    {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+// Print queue statistics to Terminal
+void EventQueue_PrintStats(void)
+{
+  uint16_t i;
+
+  for (i = 0; i < NUM_QUEUES; i++)
+  {
+    UART_PRINTF("Event queue %u: MaxLevel %u/%u, Overflows %u\r\n", i, EventQueue_Queues[i]->MaxLevel,
+                EventQueue_Queues[i]->Size, EventQueue_Queues[i]->Overflows);
+  }
+}
@@ -4,7 +4,11 @@
 * @author  Joakim Carlsson
 * @version V1.0
 * @date    19-Nov-2017
-* @brief   Signals to be exported to PC over Modbus interface
+* @brief   Signals to be exported to PC over Modbus interface, and the Modbus register map:
+*          0x0000.. the exported signals (read only), 0x1000.. the parameters, 0x2000.. 32-bit signals (read only)
+*          The signals are published by Loop20ms in a double buffer: the snapshot is filled in the back buffer and then
+*          takes the place of the front one by a pointer swap. The readers (Modbus requests) preempt Loop20ms, so they
+*          always see a complete snapshot from one instant, and a request does not copy any signals.
 *
 ******************************************************************************
 */
@@ -12,27 +16,105 @@
 /* Includes ------------------------------------------------------------------*/
 #include "ExportedSignals.h"
 #include "NeoPixel.h"
-#include "sensorMgr.h"
+#include "SensorMgr.h"
 #include "Adc.h"
 #include "SpeedSensor.h"
+#include "Scheduler.h"
+#include "TicToc.h"
+#include "IrqMon.h"
+#include "MemMon.h"
+#include "FlashE2p.h"
 
-#define NUM_SIGNALS 8
+#define NUM_APP_SIGNALS        9
+#define SCHEDULER_SIGNALS_INDX NUM_APP_SIGNALS     // Scheduler statistics, SCHEDULER_NUM_STATS signals per task
+#define TICTOC_SIGNALS_INDX    (SCHEDULER_SIGNALS_INDX + SCHEDULER_MAX_TASKS * SCHEDULER_NUM_STATS)  // Profiler probes, TICTOC_NUM_STATS signals per probe
+#ifdef TIC_TOC
+#define IRQMON_SIGNALS_INDX    (TICTOC_SIGNALS_INDX + TICTOC_NUM_PROBES * TICTOC_NUM_STATS)  // Interrupt monitor, IRQMON_NUM_STATS signals per interrupt
+#else
+#define IRQMON_SIGNALS_INDX    TICTOC_SIGNALS_INDX
+#endif
+#ifdef IRQ_MON
+#define MEMMON_SIGNALS_INDX    (IRQMON_SIGNALS_INDX + IRQMON_NUM_IRQS * IRQMON_NUM_STATS)  // Stack and heap, MEMMON_NUM_STATS signals
+#else
+#define MEMMON_SIGNALS_INDX    IRQMON_SIGNALS_INDX
+#endif
+#ifdef MEM_MON
+#define NUM_SIGNALS            (MEMMON_SIGNALS_INDX + MEMMON_NUM_STATS)
+#else
+#define NUM_SIGNALS            MEMMON_SIGNALS_INDX
+#endif
 
-uint16_t Signals[NUM_SIGNALS];
+#define SIGNAL32_UPTIME        0       // [ms] Since reset
+#define SIGNAL32_CORE_CLOCK    1       // [Hz]
+#define NUM_SIGNALS32          2
+
+typedef struct {
+  uint16_t Signals[NUM_SIGNALS];
+  uint32_t Signals32[NUM_SIGNALS32];
+} ExportedSignals_Snapshot;
+
+static ExportedSignals_Snapshot ExportedSignals_Buffers[2];
+static void *volatile ExportedSignals_Front = &ExportedSignals_Buffers[0];   // The snapshot read, the other is written
+
+static uint16_t ExportedSignals_ReadParameter(uint16_t Indx);
+static bool ExportedSignals_WriteParameter(uint16_t Indx, uint16_t Value, bool Commit);
+
+// The register map, sorted by address. The signals are read from the snapshot in front.
+const Modbus_Range ExportedSignals_Map[] =
+{
+  MODBUS_SNAPSHOT(0x0000, ExportedSignals_Front, ExportedSignals_Snapshot, Signals, MODBUS_U16),
+  MODBUS_ACCESSOR(0x1000, E2P_NUM_PARAMETERS, MODBUS_RW, ExportedSignals_ReadParameter, ExportedSignals_WriteParameter),
+  MODBUS_SNAPSHOT(0x2000, ExportedSignals_Front, ExportedSignals_Snapshot, Signals32, MODBUS_U32),
+};
+const uint16_t ExportedSignals_MapSize = sizeof(ExportedSignals_Map) / sizeof(ExportedSignals_Map[0]);
+
+static uint16_t ExportedSignals_ReadParameter(uint16_t Indx)
+{
+  return (uint16_t)FlashE2p_ReadMirror((tE2Index)Indx);
+}
+
+// The value shall be within the limits of the parameter, it is saved to Flash by FlashE2p
+static bool ExportedSignals_WriteParameter(uint16_t Indx, uint16_t Value, bool Commit)
+{
+  if (((int16_t)Value < FlashE2p_GetMinVal((tE2Index)Indx)) || ((int16_t)Value > FlashE2p_GetMaxVal((tE2Index)Indx)))
+  {
+    return FALSE;
+  }
+  if (Commit)
+  {
+    FlashE2p_UpdateParameter((tE2Index)Indx, (int16_t)Value);
+  }
+  return TRUE;
+}
 
 uint16_t ExportedSignals_Read(uint16_t indx)
 {
+  const ExportedSignals_Snapshot *Front = (const ExportedSignals_Snapshot *)ExportedSignals_Front;
+
   if (indx < NUM_SIGNALS)
   {
-    return Signals[indx];
+    return Front->Signals[indx];
   }
   else {
     return 0;
   }
 }
 
-void ExportedSignals_Update(void)
+uint16_t ExportedSignals_Count(void)
 {
+  return NUM_SIGNALS;
+}
+
+void ExportedSignals_20ms(void)
+{
+  ExportedSignals_Snapshot *Back = (ExportedSignals_Front == &ExportedSignals_Buffers[0]) ? &ExportedSignals_Buffers[1]
+                                                                                          : &ExportedSignals_Buffers[0];
+  uint16_t *Signals = Back->Signals;
+  uint16_t indx;
+  uint32_t Lock;
+
+  // The speeds are updated by Loop4ms, the application signals are taken without it in between
+  Lock = Scheduler_Lock();
   Signals[0] = RoomTempSnsr.Temperature;
   Signals[1] = RoomTempSnsr.ADCVal;
   Signals[2] = SensorIG53A_Rpm;
@@ -41,5 +123,37 @@ void ExportedSignals_Update(void)
   Signals[5] = SensorIG53B_RpmFild;
   Signals[6] = SensorM5_Rpm;
   Signals[7] = SensorM5_RpmFild;
+  Scheduler_Unlock(Lock);
+  Signals[8] = Scheduler_CpuLoad();     // [0.1 %]
+  Back->Signals32[SIGNAL32_UPTIME] = HAL_GetTick();
+  Back->Signals32[SIGNAL32_CORE_CLOCK] = SystemCoreClock;
+
+  for (indx = 0; indx < SCHEDULER_MAX_TASKS * SCHEDULER_NUM_STATS; indx++)
+  {
+    Signals[SCHEDULER_SIGNALS_INDX + indx] = Scheduler_ReadStat(indx);
+  }
+
+#ifdef TIC_TOC
+  for (indx = 0; indx < TICTOC_NUM_PROBES * TICTOC_NUM_STATS; indx++)
+  {
+    Signals[TICTOC_SIGNALS_INDX + indx] = TicToc_ReadStat(indx);
+  }
+#endif
+
+#ifdef IRQ_MON
+  for (indx = 0; indx < IRQMON_NUM_IRQS * IRQMON_NUM_STATS; indx++)
+  {
+    Signals[IRQMON_SIGNALS_INDX + indx] = IrqMon_ReadStat(indx);
+  }
+#endif
+
+#ifdef MEM_MON
+  for (indx = 0; indx < MEMMON_NUM_STATS; indx++)
+  {
+    Signals[MEMMON_SIGNALS_INDX + indx] = MemMon_ReadStat(indx);
+  }
+#endif
 
+  __DMB();                              // The snapshot is complete before it is published
+  ExportedSignals_Front = Back;
 }
\ No newline at end of file
@@ -17,6 +17,8 @@
 #include "FlashE2p.h"
 #include "Util.h"
 #include "Uart.h"
+#include "Log.h"
+#include "Scheduler.h"
 
 const tE2pDefault E2pDefault[E2P_NUM_PARAMETERS] =
 {
@@ -29,6 +31,7 @@ const tE2pDefault E2pDefault[E2P_NUM_PARAMETERS] =
   { 0, 2500,    E2P_DEFAULT(350,        E2P_CLUTCH_SPRING_PRESSURE)    }, 
   { 0, 2500,    E2P_DEFAULT(700,        E2P_CLUTCH_IN_PRE_PRESSURE)    }, 
   { 0, 2,       E2P_DEFAULT(0,          E2P_NEO_PIXEL_APP)             },
+  { 0, 7,       E2P_DEFAULT(0,          E2P_MODBUS_BAUD_RATE)          },   // 9600..921600 baud
 };
 
 static int16_t E2pRamMirror[E2P_NUM_PARAMETERS];
@@ -63,11 +66,15 @@ HAL_StatusTypeDef FlashE2p_EraseSector(FlashSector *pSector)
 static HAL_StatusTypeDef FlashE2p_ProgramWord(FlashSector *pSector, uint16_t E2pIndex, uint16_t Data)
 {
   HAL_StatusTypeDef FlashStatus = HAL_OK;
-
+  uint32_t Lock;
   uint32_t Word = 0;  // Word will be programmed into Eeprom, it contains both the index and the data.
 
   if (pSector->NextWriteAddress >= pSector->BaseAddress + pSector->PageSize) // Page full
   {
+    if (!pSector->EraseNeeded)
+    {
+      LOG("Eeprom sector full, erased at next boot\r\n");
+    }
     pSector->EraseNeeded = TRUE;
     return HAL_ERROR;
   }
@@ -78,8 +85,10 @@ static HAL_StatusTypeDef FlashE2p_ProgramWord(FlashSector *pSector, uint16_t E2p
     Word |= E2pIndex;
 
     FlashStatus = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, pSector->NextWriteAddress, Word);    // TODO: Maybe add handling of FlashStatus ?
-    FlashE2p_WriteSynchBit(E2pIndex, TRUE);
-    UART_PRINTF("Updated Eeprom param %d to %d\r\n", E2pIndex, Data);
+    Lock = Scheduler_Lock();             // Parameter may have been updated by a higher prio rate group (Modbus) while programming,
+    FlashE2p_WriteSynchBit(E2pIndex, (uint16_t)E2pRamMirror[E2pIndex] == Data);  // then it stays unsynched and is written next time
+    Scheduler_Unlock(Lock);
+    LOG("Updated Eeprom param %d to %d\r\n", E2pIndex, Data);
     
     pSector->NextWriteAddress += 4;
   }
@@ -87,6 +96,19 @@ static HAL_StatusTypeDef FlashE2p_ProgramWord(FlashSector *pSector, uint16_t E2p
   return FlashStatus;
 }
 
+// Erases the sector and writes the Ram mirror to it in the same step, so a power loss can not leave the sector
+// erased but not yet reprogrammed for longer than the rewrite takes
+static void FlashE2p_EraseAndRewrite(FlashSector *pSector)
+{
+  uint16_t E2pIndex;
+
+  (void)FlashE2p_EraseSector(pSector);   // Maybe add handling of FlashStatus ?
+  for (E2pIndex = 0; E2pIndex < E2P_NUM_PARAMETERS; E2pIndex++)
+  {
+    (void)FlashE2p_ProgramWord(pSector, E2pIndex, FlashE2p_ReadMirror(E2pIndex));
+  }
+}
+
 // Called in 500ms loop, checks if there are parameters that have been updated, i.e. Ram mirror is ahead of Eeprom. 
 // If so, those parameters are updated in Eeprom (copy Ram mirror value to Eeprom -> In synch). 
 static void FlashE2p_UpdateEeprom(FlashSector *pSector)
@@ -168,19 +190,16 @@ void FlashE2p_InitSector(FlashSector *pSector)
     } 
     
     // Now Ram mirror is properly initialized with data from Flash and (possibly default parameters)
-    // Last step is to check if sector is so full that it is time to ERASE it and start over with a clean sector. Since this is time consuming we prefer 
-    // to do it at Init rather than after startup. Thus EraseWhenReachOffset is less than page size to make it more likely the erase is done at Startup.
+    // Last step is to check if sector is so full that it is time to ERASE it and start over with a clean sector. This is time consuming,
+    // but it is done here, before the control loops start: the F446 has a single Flash bank, so an erase stalls every instruction fetch,
+    // including the interrupts, for several hundred ms. EraseWhenReachOffset is less than page size to make it more likely the erase is
+    // done at Startup rather than when the page is full.
     if (pSector->NextWriteAddress >= pSector->BaseAddress + pSector->InitEraseOffset)
     {
-      FlashE2p_EraseSector(pSector);
-
-      for (E2pIndex = 0; E2pIndex < E2P_NUM_PARAMETERS; E2pIndex++)
-      {
-        FlashStatus = FlashE2p_ProgramWord(pSector, E2pIndex, FlashE2p_ReadMirror(E2pIndex));  // After erase, write Ram mirror to Flash
-      }
+      FlashE2p_EraseAndRewrite(pSector);
     }
 
-    UART_PRINTF("Copied Flash Eeprom to Ram mirror\r\n");
+    LOG("Copied Flash Eeprom to Ram mirror\r\n");
   }
   else  // Memory not initialized properly. Use default parameters and initalize the Eeprom sector.
   {
@@ -205,7 +224,7 @@ void FlashE2p_InitSector(FlashSector *pSector)
       FlashE2p_WriteMirror(E2pIndex, DefaultVal);                           // Write default values to Ram mirror ...
       FlashStatus = FlashE2p_ProgramWord(pSector, E2pIndex, DefaultVal);  // and to the (erased) Flash Eeprom
     }
-    UART_PRINTF("Default values written to Eeprom\r\n");
+    LOG("Default values written to Eeprom\r\n");
   }
 }
 
@@ -248,9 +267,14 @@ void FlashE2p_PrintParameters(void)
   }
 }
 
+// The sector is never erased while the control loops run, since the erase would stall them (see FlashE2p_InitSector).
+// If the sector is full, updated parameters are only kept in the Ram mirror until the sector is erased at next boot.
 void FlashE2p_500ms(void)
 {
-  FlashE2p_UpdateEeprom(&Sector3);
+  if (!Sector3.EraseNeeded)
+  {
+    FlashE2p_UpdateEeprom(&Sector3);
+  }
 }
 
 // ====================================================
@@ -267,9 +291,13 @@ bool FlashE2p_ReadSynchBit(uint16_t E2pIndex)
 
 void FlashE2p_WriteSynchBit(uint16_t E2pIndex, bool BitVal)
 {
+  uint32_t Lock;
+
   if (E2pIndex < E2P_NUM_PARAMETERS)
   {
+    Lock = Scheduler_Lock();             // Read-modify-write of a word shared by all parameters
     Util_BitWrite(FlashE2p_InSynch[E2pIndex / 32], E2pIndex % 32, BitVal);
+    Scheduler_Unlock(Lock);
   }
 }
 
@@ -135,7 +135,7 @@ void InputCapture_Init(void)
 
   /* Start Timer and Input Capture on channels 1 and 4 */
   /*Configure the TIM5 IRQ priority */
-  HAL_NVIC_SetPriority(TIM5_IRQn, 13U, 0U);   // Interrupt prio number 13, i.e. low prio. 
+  HAL_NVIC_SetPriority(TIM5_IRQn, 9U, 0U);    // Interrupt prio number 9, above the rate groups (see Scheduler.h) to not lose captures. 
 
   HAL_NVIC_EnableIRQ(TIM5_IRQn);              // Enable the TIM5 global Interrupt
 
@@ -0,0 +1,175 @@
+/**
+******************************************************************************
+* @file    /Src/IrqMon.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Interrupt latency and jitter monitor. Each monitored handler records the entry latency from the counter of
+*          the peripheral that requested it, the execution time (DWT cycle counter) and how deep interrupts were nested.
+*          A handler only writes its own entry and the Preemptions of the handler it preempted, which is suspended
+*          meanwhile, so no locking is needed.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ProjectDefs.h"
+#include "IrqMon.h"
+#include "Util.h"
+#include "Uart.h"
+#include "Trace.h"
+
+#ifdef IRQ_MON  // Complete file in the #define
+
+IrqMon IrqMon_Irqs[IRQMON_NUM_IRQS] =
+{
+  { "SysTick", IRQMON_LATENCY_SYSTICK, NULL,  0   },
+  { "TIM5",    IRQMON_LATENCY_TIMER,   TIM5,  0   },
+  { "TIM13",   IRQMON_LATENCY_TIMER,   TIM13, 0   },
+  { "TIM14",   IRQMON_LATENCY_TIMER,   TIM14, 400 },   // NeoPixel: CCR1 shall be written within 0.4 us
+  { "OTG_FS",  IRQMON_LATENCY_NONE,    NULL,  0   },
+};
+
+static volatile uint8_t IrqMon_Depth = 0;     // Number of monitored interrupts active
+static IrqMon *volatile IrqMon_Current = NULL;  // Innermost active monitored interrupt
+
+
+// Convert ticks of the latency source to ns
+static uint32_t IrqMon_TicksToNs(const IrqMon *Mon, uint32_t Ticks)
+{
+  uint64_t Freq;
+
+  switch (Mon->LatencySrc)
+  {
+  case IRQMON_LATENCY_SYSTICK:
+    Freq = SystemCoreClock;
+    break;
+  case IRQMON_LATENCY_TIMER:
+    Freq = (2U * (uint64_t)HAL_RCC_GetPCLK1Freq()) / (Mon->Timer->PSC + 1U);   // APB1 timers run at 2 x PCLK1 (APB1 divider 4)
+    break;
+  default:
+    return 0;
+  }
+  return (uint32_t)Util_Min(((uint64_t)Ticks * 1000000000U) / Freq, 0xFFFFFFFFU);
+}
+
+// Deadlines are converted to ticks once, so IRQMON_MARK is only a compare. Call when the timers are configured.
+void IrqMon_Init(void)
+{
+  IrqMon *Mon;
+
+  for (Mon = IrqMon_Irqs; Mon < IrqMon_Irqs + IRQMON_NUM_IRQS; Mon++)
+  {
+    Mon->DeadlineTicks = 0;
+    if ((Mon->DeadlineNs != 0) && (IrqMon_TicksToNs(Mon, 1) != 0))
+    {
+      Mon->DeadlineTicks = Mon->DeadlineNs / IrqMon_TicksToNs(Mon, 1);
+    }
+  }
+}
+
+static uint32_t IrqMon_CyclesToNs(uint32_t Cycles)
+{
+  return (uint32_t)(((uint64_t)Cycles * 1000U) / (SystemCoreClock / 1000000U));
+}
+
+void IrqMon_Enter(IrqMon *Mon, uint32_t LatencyTicks)
+{
+  Mon->EntryCycles = DWT->CYCCNT;
+  Mon->Preempted = IrqMon_Current;   // Suspended until this handler exits, so this is the only writer of its Preemptions
+  if (Mon->Preempted != NULL)
+  {
+    Mon->Preempted->Preemptions++;
+  }
+  IrqMon_Current = Mon;
+  Mon->NestingMax = Util_Max(Mon->NestingMax, IrqMon_Depth);
+  IrqMon_Depth++;
+  Mon->Count++;
+  IrqMon_SetLatency(Mon, LatencyTicks);
+  TRACE_RECORD(TRACE_ISR_ENTER, Mon - IrqMon_Irqs, 0);
+}
+
+void IrqMon_SetLatency(IrqMon *Mon, uint32_t LatencyTicks)
+{
+  Mon->Latency = LatencyTicks;
+  Mon->LatencyMax = Util_Max(Mon->LatencyMax, LatencyTicks);
+}
+
+void IrqMon_Mark(IrqMon *Mon, uint32_t Ticks)
+{
+  Mon->Mark = Ticks;
+  Mon->MarkMax = Util_Max(Mon->MarkMax, Ticks);
+  if ((Mon->DeadlineTicks != 0) && (Ticks > Mon->DeadlineTicks))
+  {
+    Mon->MarkMisses++;
+  }
+}
+
+void IrqMon_Exit(IrqMon *Mon)
+{
+  uint32_t ExecCycles = DWT->CYCCNT - Mon->EntryCycles;   // Read once, Util_Max() evaluates its arguments twice
+
+  Mon->ExecCyclesMax = Util_Max(Mon->ExecCyclesMax, ExecCycles);
+  IrqMon_Depth--;
+  IrqMon_Current = Mon->Preempted;
+  TRACE_RECORD(TRACE_ISR_EXIT, Mon - IrqMon_Irqs, 0);
+}
+
+uint16_t IrqMon_ReadStat(uint16_t Indx)
+{
+  const IrqMon *Mon;
+  uint32_t Value;
+
+  if (Indx >= IRQMON_NUM_IRQS * IRQMON_NUM_STATS)
+  {
+    return 0;
+  }
+  Mon = &IrqMon_Irqs[Indx / IRQMON_NUM_STATS];
+
+  switch (Indx % IRQMON_NUM_STATS)
+  {
+  case IRQMON_STAT_COUNT:
+    return (uint16_t)Mon->Count;
+  case IRQMON_STAT_LATENCY:
+    Value = IrqMon_TicksToNs(Mon, Mon->Latency);
+    break;
+  case IRQMON_STAT_LATENCY_MAX:
+    Value = IrqMon_TicksToNs(Mon, Mon->LatencyMax);
+    break;
+  case IRQMON_STAT_EXEC_TIME_MAX:
+    Value = IrqMon_CyclesToNs(Mon->ExecCyclesMax);
+    break;
+  case IRQMON_STAT_NESTING_MAX:
+    Value = Mon->NestingMax;
+    break;
+  case IRQMON_STAT_PREEMPTIONS:
+    Value = Mon->Preemptions;
+    break;
+  case IRQMON_STAT_MARK_MAX:
+    Value = IrqMon_TicksToNs(Mon, Mon->MarkMax);
+    break;
+  case IRQMON_STAT_MARK_MISSES:
+    Value = Mon->MarkMisses;
+    break;
+  default:
+    Value = 0;
+    break;
+  }
+  return (uint16_t)Util_Min(Value, 0xFFFFU);
+}
+
+// Print the interrupt statistics to Terminal
+void IrqMon_PrintStats(void)
+{
+  const IrqMon *Mon;
+
+  UART_PRINTF("\r\nIRQ         Count  Latency[ns]  LatencyMax[ns]  ExecMax[ns]  NestMax  Preempted  MarkMax[ns]  Misses\r\n");
+  for (Mon = IrqMon_Irqs; Mon < IrqMon_Irqs + IRQMON_NUM_IRQS; Mon++)
+  {
+    UART_PRINTF("%-8s %9lu %12lu %15lu %12lu %8u %10lu %12lu %7lu\r\n", Mon->Name, Mon->Count,
+                IrqMon_TicksToNs(Mon, Mon->Latency), IrqMon_TicksToNs(Mon, Mon->LatencyMax), IrqMon_CyclesToNs(Mon->ExecCyclesMax),
+                Mon->NestingMax, Mon->Preemptions, IrqMon_TicksToNs(Mon, Mon->MarkMax), Mon->MarkMisses);
+  }
+}
+
+#endif
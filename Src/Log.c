@@ -0,0 +1,152 @@
+/**
+******************************************************************************
+* @file    /Src/Log.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Log ring of the deferred logging, used when the log messages are not added to the trace (see Log.h).
+*          LOG() stores the format ID and the raw arguments of a message, a few stores with the rate groups masked.
+*          Log_Flush() expands the messages in the main loop, so the formatting is only done in the time left by the
+*          rate groups and the background jobs.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "ProjectDefs.h"
+#include "Log.h"
+#include "Scheduler.h"
+#include "Uart.h"
+
+#if defined(LOG_DEFERRED) && !defined(TRACE)  // Complete file in the #define
+
+#define LOG_RING_MASK  (LOG_RING_SIZE - 1)
+
+typedef struct {
+  uint16_t FmtId;                               // Offset of the format string in the log_fmt section
+  uint8_t NumArgs;
+  uint32_t Args[LOG_MAX_ARGS];                  // Raw 32 bits, see LOG_ARG()
+} Log_Record;
+
+static Log_Record Log_Ring[LOG_RING_SIZE];
+static volatile uint16_t Log_Head = 0;          // Free running, next record to write
+static volatile uint16_t Log_Tail = 0;          // Free running, next record to expand
+static volatile uint16_t Log_Lost = 0;
+
+extern const char __start_log_fmt[] __attribute__((weak));   // Linker: start of the section with the LOG() format strings
+
+
+void Log_Add(const char *Fmt, uint8_t NumArgs, const uint32_t *Args)
+{
+  Log_Record *Record;
+  uint8_t Indx;
+  uint32_t Lock = Scheduler_Lock();             // Messages are added from all rate groups
+
+  if ((uint16_t)(Log_Head - Log_Tail) < LOG_RING_SIZE)
+  {
+    Record = &Log_Ring[Log_Head & LOG_RING_MASK];
+    Record->FmtId = (uint16_t)(Fmt - __start_log_fmt);
+    Record->NumArgs = NumArgs;
+    for (Indx = 0; Indx < NumArgs; Indx++)
+    {
+      Record->Args[Indx] = Args[Indx];
+    }
+    Log_Head++;
+  }
+  else
+  {
+    Log_Lost++;
+  }
+  Scheduler_Unlock(Lock);
+}
+
+// Formats the message of a record. Each conversion is formatted on its own by snprintf, with its argument as double
+// for the floating point conversions (stored as float) and as a 32-bit integer for the others. Length modifiers are
+// skipped, all integers are 32 bits.
+static uint16_t Log_Format(char *Text, uint16_t Size, const Log_Record *Record)
+{
+  const char *Fmt = &__start_log_fmt[Record->FmtId];
+  char Spec[16];
+  uint16_t Length = 0;
+  uint16_t SpecLength;
+  uint8_t Arg = 0;
+  union { uint32_t U; float F; } Value;
+
+  while ((*Fmt != '\0') && (Length < Size - 1U))
+  {
+    if ((*Fmt != '%') || (Fmt[1] == '%'))
+    {
+      Fmt += (*Fmt == '%') ? 1 : 0;
+      Text[Length++] = *Fmt++;
+      continue;
+    }
+
+    SpecLength = 0;
+    Spec[SpecLength++] = *Fmt++;
+    while ((*Fmt != '\0') && (strchr("-+ #0123456789.hlLjzt", *Fmt) != NULL))
+    {
+      if ((strchr("hlLjzt", *Fmt) == NULL) && (SpecLength < sizeof(Spec) - 2U))
+      {
+        Spec[SpecLength++] = *Fmt;
+      }
+      Fmt++;
+    }
+    if ((*Fmt == '\0') || (Arg >= Record->NumArgs))
+    {
+      break;                                    // Broken format string, or more conversions than arguments
+    }
+    Spec[SpecLength++] = *Fmt;
+    Spec[SpecLength] = '\0';
+
+    Value.U = Record->Args[Arg++];
+    if (strchr("fFeEgGaA", *Fmt++) != NULL)
+    {
+      (void)snprintf(&Text[Length], Size - Length, Spec, (double)Value.F);
+    }
+    else
+    {
+      (void)snprintf(&Text[Length], Size - Length, Spec, (unsigned int)Value.U);
+    }
+    Length += strlen(&Text[Length]);
+  }
+  Text[Length] = '\0';
+  return Length;
+}
+
+bool Log_Flush(void)
+{
+  char Text[UART_PRINTF_MAX_LEN];
+  uint16_t Length;
+  uint16_t Lost = Log_Lost;
+  uint32_t Lock;
+
+  if (Lost != 0)
+  {
+    Length = (uint16_t)snprintf(Text, sizeof(Text), "Log: %u messages lost\r\n", Lost);
+    if ((Length > Uart_TerminalFree()) || !Uart_WriteTerminal((const uint8_t *)Text, Length))
+    {
+      return FALSE;
+    }
+    Lock = Scheduler_Lock();
+    Log_Lost -= Lost;                           // Messages lost meanwhile are reported next time
+    Scheduler_Unlock(Lock);
+    return TRUE;
+  }
+
+  if (Log_Head == Log_Tail)
+  {
+    return FALSE;
+  }
+  Length = Log_Format(Text, sizeof(Text), &Log_Ring[Log_Tail & LOG_RING_MASK]);
+  if (Length > Uart_TerminalFree())
+  {
+    return FALSE;                               // Expanded again when the Terminal has sent more
+  }
+  (void)Uart_WriteTerminal((const uint8_t *)Text, Length);
+  Log_Tail++;                                   // The producers may reuse the record
+  return TRUE;
+}
+
+#endif
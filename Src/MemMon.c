@@ -0,0 +1,191 @@
+/**
+******************************************************************************
+* @file    /Src/MemMon.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Stack and heap monitor. Reset_Handler paints the free RAM between the heap and the main stack, a background
+*          job scans it for the lowest address the stack has used (the high-water mark). There is no RTOS, so the main
+*          loop and all interrupts share the main stack (MSP).
+*          The heap is tracked in two ways: _sbrk (replacing the one of libnosys) gives the size of the heap used by all
+*          of malloc, incl. newlib internally, and MemMon_Malloc/MemMon_Free count the bytes allocated by e.g. USB host.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ProjectDefs.h"
+#include "MemMon.h"
+#include "BgJob.h"
+#include "Util.h"
+#include "Uart.h"
+#include "Scheduler.h"
+
+#ifdef MEM_MON  // Complete file in the #define
+
+#include <errno.h>
+#include <reent.h>
+
+extern uint32_t end;          // Linker script: start of the heap
+extern uint32_t _estack;      // Linker script: top of the main stack
+
+typedef struct {
+  size_t Size;
+  uint32_t Reserved;          // Keeps the blocks 8 byte aligned
+} MemMon_Header;
+
+static uint8_t *volatile MemMon_Break = (uint8_t *)&end;         // Top of the heap
+static uint32_t *volatile MemMon_StackLowest = &_estack;        // Lowest address used by the stack (so far)
+static uint32_t MemMon_HeapUsed = 0;
+static uint32_t MemMon_HeapUsedMax = 0;
+static uint32_t MemMon_AllocFails = 0;
+
+static uint32_t MemMon_PrevLock;
+static uint8_t MemMon_LockDepth = 0;
+
+static uint8_t MemMon_ScanStep(BgJob *Job);
+
+static BgJob MemMon_ScanJob = BGJOB("StackScan", MemMon_ScanStep, NULL, NULL);
+
+
+// Called by newlib around malloc and free. Allocations are made both from the main loop (USB host) and from the rate
+// groups (printf of floats), but never from an interrupt handler. So the rate groups are masked by Scheduler_Lock(), and
+// the interrupts with deadlines (e.g. NeoPixel) are not delayed by a malloc. Recursive, MemMon_Malloc holds the lock
+// around malloc.
+void __malloc_lock(struct _reent *Reent)
+{
+  uint32_t PrevLock = Scheduler_Lock();
+
+  if (MemMon_LockDepth++ == 0)
+  {
+    MemMon_PrevLock = PrevLock;
+  }
+}
+
+void __malloc_unlock(struct _reent *Reent)
+{
+  if (--MemMon_LockDepth == 0)
+  {
+    Scheduler_Unlock(MemMon_PrevLock);
+  }
+}
+
+// Replaces _sbrk of libnosys, which does not check for a collision with the stack. Called by malloc with the lock held.
+void *_sbrk(ptrdiff_t Incr)
+{
+  uint8_t *Limit = (uint8_t *)Util_Min(__get_MSP(), (uint32_t)MemMon_StackLowest) - MEMMON_STACK_GUARD;
+  uint8_t *PrevBreak = MemMon_Break;
+
+  if (PrevBreak + Incr > Limit)
+  {
+    MemMon_AllocFails++;
+    errno = ENOMEM;
+    return (void *)-1;
+  }
+  MemMon_Break = PrevBreak + Incr;
+  return PrevBreak;
+}
+
+void *MemMon_Malloc(size_t Size)
+{
+  MemMon_Header *Block;
+
+  __malloc_lock(_REENT);
+  Block = malloc(sizeof(MemMon_Header) + Size);
+  if (Block == NULL)
+  {
+    MemMon_AllocFails++;
+  }
+  else
+  {
+    Block->Size = Size;
+    MemMon_HeapUsed += Size;
+    MemMon_HeapUsedMax = Util_Max(MemMon_HeapUsedMax, MemMon_HeapUsed);
+    Block++;
+  }
+  __malloc_unlock(_REENT);
+  return Block;
+}
+
+void MemMon_Free(void *Ptr)
+{
+  MemMon_Header *Block = (MemMon_Header *)Ptr - 1;
+
+  if (Ptr != NULL)
+  {
+    __malloc_lock(_REENT);
+    MemMon_HeapUsed -= Block->Size;
+    free(Block);
+    __malloc_unlock(_REENT);
+  }
+}
+
+// Scan upwards from the top of the heap for the first word that is not painted. Only the words below the high-water
+// mark found so far are checked, State is the next word to check.
+static uint8_t MemMon_ScanStep(BgJob *Job)
+{
+  uint32_t Bottom = ((uint32_t)MemMon_Break + 3U) & ~3U;
+  uint32_t *Lowest = MemMon_StackLowest;
+  uint32_t *Word, *Stop;
+
+  if (Job->State < Bottom)
+  {
+    Job->State = Bottom;              // Started, or the heap has grown into the part to scan
+  }
+  Word = (uint32_t *)Job->State;
+  Stop = Util_Min(Word + MEMMON_SCAN_WORDS, Lowest);
+
+  while ((Word < Stop) && (*Word == MEMMON_STACK_PATTERN))
+  {
+    Word++;
+  }
+
+  if ((Word < Stop) || (Stop == Lowest))
+  {
+    MemMon_StackLowest = Util_Min(Word, Lowest);
+    return BGJOB_DONE;
+  }
+  Job->State = (uint32_t)Word;
+  return (uint8_t)(((uint32_t)Word - Bottom) * 100U / ((uint32_t)Lowest - Bottom));
+}
+
+void MemMon_500ms(void)
+{
+  (void)BgJob_Start(&MemMon_ScanJob);
+}
+
+static uint32_t MemMon_Stat(uint16_t Indx)
+{
+  switch (Indx)
+  {
+  case MEMMON_STAT_STACK_USED:
+    return (uint32_t)&_estack - (uint32_t)MemMon_StackLowest;
+  case MEMMON_STAT_STACK_FREE:
+    return (uint32_t)MemMon_StackLowest - (uint32_t)MemMon_Break;
+  case MEMMON_STAT_HEAP_SIZE:
+    return (uint32_t)MemMon_Break - (uint32_t)&end;
+  case MEMMON_STAT_HEAP_USED:
+    return MemMon_HeapUsed;
+  case MEMMON_STAT_HEAP_USED_MAX:
+    return MemMon_HeapUsedMax;
+  case MEMMON_STAT_ALLOC_FAILS:
+    return MemMon_AllocFails;
+  default:
+    return 0;
+  }
+}
+
+uint16_t MemMon_ReadStat(uint16_t Indx)
+{
+  return (uint16_t)Util_Min(MemMon_Stat(Indx), 0xFFFFU);
+}
+
+// Print the memory statistics to Terminal
+void MemMon_PrintStats(void)
+{
+  UART_PRINTF("\r\nStack used %lu free %lu bytes. Heap %lu bytes, MemMon_Malloc %lu max %lu bytes. Alloc fails %lu\r\n",
+              MemMon_Stat(MEMMON_STAT_STACK_USED), MemMon_Stat(MEMMON_STAT_STACK_FREE),
+              MemMon_Stat(MEMMON_STAT_HEAP_SIZE), MemMon_HeapUsed, MemMon_HeapUsedMax, MemMon_AllocFails);
+}
+
+#endif
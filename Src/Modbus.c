@@ -5,207 +5,801 @@
 * @version V1.0
 * @date    1-October-2017
 * @brief   Implements a Modbus slave to communicate with PC, using a UartPort object that is setup in Uart.c
+*          The RTU frames are delimited by time (Modbus over serial line V1.02, 2.5.1.1): a frame ends after a silence
+*          of 3.5 characters and is invalid if it has a silence of more than 1.5 characters. The IDLE interrupt of the
+*          USART starts the one pulse timer TIM7, which checks the Rx DMA position at t1.5 and t3.5.
+*          At t3.5 the request is served in a software interrupt at the priority of the fastest rate group, and the
+*          response is queued for transmission at once, so the turnaround does not depend on the 4 ms tick.
+*          Register map (FC 3, 4, 6, 16 and 23): the ranges of ExportedSignals_Map, found through an index of 256
+*          register blocks built by Modbus_Init(). A request may span adjacent ranges, 16-bit storage is copied in bulk.
+*          Coils (FC 1, 5 and 15) are the bits of the parameters and discrete inputs (FC 2) the bits of the signals,
+*          bit n is bit n % 16 of register n / 16. Writes are checked first, e.g. against the parameter limits, and
+*          either all registers of a request are written or none.
 ******************************************************************************
 */
 
 /* Includes ------------------------------------------------------------------*/
+#include <string.h>
 #include "ProjectDefs.h"
 #include "Modbus.h"
 #include "Util.h"
 #include "Uart.h"
 #include "Crc.h"
+#include "ErrorHandler.h"
 #include "FlashE2p.h"
 #include "ExportedSignals.h"
+#include "TicToc.h"
+#include "Trace.h"
+#include "Scheduler.h"
 
 
 #define MODBUS_RX_READY        0
-#define MODBUS_TX_SENDING      1
-#define MODBUS_TX_WAIT_FOR_TC  2
+#define MODBUS_TX_WAIT_FOR_TC  1
 
-#define MODBUS_TIMEOUT    100
+#define MODBUS_TIMEOUT    100       // [4 ms] Safety net if the TC interrupt never comes
+#define MODBUS_MAX_ADU_SIZE  256    // Largest RTU frame
 
-#define READ_SIGNALS  0
-#define READ_E2P      1
-#define WRITE_E2P     1
+// Register map, ExportedSignals_Map. The address space is split in blocks, the first range of each block is indexed.
+#define MODBUS_MAP_REGISTERS      0x10000U
+#define MODBUS_MAP_BLOCK_BITS     8
+#define MODBUS_MAP_BLOCKS         (MODBUS_MAP_REGISTERS >> MODBUS_MAP_BLOCK_BITS)
+#define MODBUS_COIL_REGISTERS     0x1000    // Coil n is bit n % 16 of register MODBUS_COIL_REGISTERS + n / 16
+#define MODBUS_DISCRETE_REGISTERS 0x0000    // ... and discrete input n of register MODBUS_DISCRETE_REGISTERS + n / 16
+
+#define MODBUS_FC_READ_COILS                     1    // Bits of the parameters
+#define MODBUS_FC_READ_DISCRETE_INPUTS           2    // Bits of the signals
+#define MODBUS_FC_READ_HOLDING_REGISTERS         3
+#define MODBUS_FC_READ_INPUT_REGISTERS           4
+#define MODBUS_FC_WRITE_SINGLE_COIL              5
+#define MODBUS_FC_WRITE_SINGLE_REGISTER          6
+#define MODBUS_FC_WRITE_MULTIPLE_COILS           15
+#define MODBUS_FC_WRITE_MULTIPLE_REGISTERS       16
+#define MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS  23
+
+// Quantities per request, so the response or request fits the largest frame
+#define MODBUS_MAX_READ_BITS           2000
+#define MODBUS_MAX_WRITE_BITS          1968
+#define MODBUS_MAX_READ_REGISTERS      125
+#define MODBUS_MAX_WRITE_REGISTERS     123
+#define MODBUS_MAX_RW_WRITE_REGISTERS  121
+
+#define MODBUS_EXCEPTION_FLAG           0x80   // Set in the function code of an exception response
+#define MODBUS_EXC_NONE                 0
+#define MODBUS_EXC_ILLEGAL_FUNCTION     1
+#define MODBUS_EXC_ILLEGAL_DATA_ADDRESS 2
+#define MODBUS_EXC_ILLEGAL_DATA_VALUE   3
 
 #define SLAVE_ADDRESS_INDX  0
 #define FUNCTION_CODE_INDX  1
 
+#define MODBUS_TIMER              TIM7
+#define MODBUS_TIMER_IRQ          TIM7_IRQn
+#define MODBUS_TIMER_FREQ         1000000U    // [Hz] Counter clock, the times are in us
+#define MODBUS_FIXED_TIMING_BAUD  19200U      // Above this baud rate t1.5 and t3.5 are fixed
+#define MODBUS_FIXED_T15_US       750U
+#define MODBUS_FIXED_T35_US       1750U
+
+// The CAN controllers are not used, CAN2_SCE is the software interrupt serving the requests (the others are rate
+// groups, see Scheduler.c). Scheduler_Lock() masks it, as the rate groups that share the parameters and signals with it.
+#define MODBUS_SERVE_IRQ          CAN2_SCE_IRQn
+#define MODBUS_SERVE_IRQ_PRIO     SCHEDULER_PRIO_HIGHEST
+
+typedef enum {
+  MODBUS_GAP_NONE = 0,        // Receiving, or no frame
+  MODBUS_GAP_T15,             // The line is idle, the timer runs to t1.5
+  MODBUS_GAP_T35,             // No character before t1.5, the timer runs to t3.5
+} Modbus_Gap;
+
+// Selected by the parameter E2P_MODBUS_BAUD_RATE, its max is the last index
+static const uint32_t Modbus_BaudRates[] = { 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600 };
+#define MODBUS_NUM_BAUD_RATES  (sizeof(Modbus_BaudRates) / sizeof(Modbus_BaudRates[0]))
+
 static uint8_t Modbus_Address = 0xA;
+static uint8_t Modbus_Request[MODBUS_MAX_ADU_SIZE];     // Copied from the Rx ring of ModbusPort
+static volatile int Modbus_State = MODBUS_RX_READY;      // Set to RX_READY by the TC interrupt when the response is sent
+static volatile uint16_t Modbus_RequestLength = 0;       // Set by the frame timer when a frame is complete, cleared when served
+static uint16_t Modbus_TxTimer = 0;                      // [4 ms] Time waiting for the TC interrupt
+#ifdef TIC_TOC
+static uint32_t Modbus_IdleCycles;                       // DWT->CYCCNT at the last IDLE interrupt
+static uint32_t Modbus_RequestCycles;                    // ... of the request being served
+#endif
+
+// Frame timing, the timer and the IDLE interrupt are on the same priority level
+static int16_t Modbus_BaudIndx = -1;                     // Baud rate in use
+static uint16_t Modbus_T15Ticks;                         // From the IDLE interrupt to the check of t1.5
+static uint16_t Modbus_T35Ticks;                         // From there to the check of t3.5
+static Modbus_Gap Modbus_GapState = MODBUS_GAP_NONE;
+static uint16_t Modbus_IdleRxPos;                        // Rx DMA position at the IDLE interrupt
+static bool Modbus_FrameBroken = FALSE;                  // A silence of more than t1.5 in the frame
+
+static uint8_t Modbus_MapBlock[MODBUS_MAP_BLOCKS];      // Index of the first range ending after the start of each block
+// The registers holding the coils or discrete inputs of a request. The RTU and TCP requests are served at the same
+// priority, so they can share it.
+static uint8_t Modbus_Bits[2U * (MODBUS_MAX_READ_BITS / 16U + 2U)];
+
+// The response is sent from three buffers: address, PDU (ModbusPort.Tx.Buffer) and CRC
+static uint8_t Modbus_Crc[2];
+static Uart_TxDesc Modbus_TxHeader = { .Data = &Modbus_Address, .Length = 1 };
+static Uart_TxDesc Modbus_TxPayload;
+static Uart_TxDesc Modbus_TxCrc = { .Data = Modbus_Crc, .Length = sizeof(Modbus_Crc) };
 
 
 // Request is considered valid if the following conditions are fullfilled:
 // 1) The address in Request matches this unit's address
-// 2) The Function code in the request is supported by SW
-// 3) Message Crc matches computed Crc
+// 2) Message Crc matches computed Crc
+// The function code and the data are checked when the request is served, errors get an exception response.
 // Returns TRUE if request is valid, otherwise FALSE
 static bool Modbus_ValidRequest(uint16_t BytesReceived)
 {
   uint16_t ComputedCrc, MessageCrc;
-  bool Result = FALSE;
 
-  if (ModbusPort.Rx.Buffer[SLAVE_ADDRESS_INDX] == Modbus_Address)  // My address ?
+  if ((BytesReceived < 4) || (Modbus_Request[SLAVE_ADDRESS_INDX] != Modbus_Address))  // Address, function code and Crc. My address ?
+  {
+    return FALSE;
+  }
+  ComputedCrc = Crc_CalcCrc16(Modbus_Request, BytesReceived - 2);
+  MessageCrc = ((uint16_t)Modbus_Request[BytesReceived - 1]) << 8;  // Note: The high and low byte of CRC shall be swapped in Modbus protocol 
+  MessageCrc += Modbus_Request[BytesReceived - 2];
+  return MessageCrc == ComputedCrc;
+}
+
+// 16-bit field of a PDU, high byte first
+static uint16_t Modbus_Word(const uint8_t *Data)
+{
+  return ((uint16_t)Data[0] << 8) | Data[1];
+}
+
+// The range holding Address, NULL if it is not mapped. Modbus_MapBlock gives the first range that can hold it, the
+// ranges ending before have been skipped.
+static const Modbus_Range *Modbus_FindRange(uint16_t Address)
+{
+  const Modbus_Range *Range;
+  uint16_t Indx;
+
+  for (Indx = Modbus_MapBlock[Address >> MODBUS_MAP_BLOCK_BITS]; Indx < ExportedSignals_MapSize; Indx++)
   {
-    switch (ModbusPort.Rx.Buffer[FUNCTION_CODE_INDX])  // Function Code check
+    Range = &ExportedSignals_Map[Indx];
+    if (Address < Range->Address)
+    {
+      return NULL;                                // In a gap
+    }
+    if (Address - Range->Address < Range->Count)
     {
-    case 4:
-    case 6:
-      ComputedCrc = Crc_CalcCrc16(ModbusPort.Rx.Buffer, BytesReceived - 2);
-      MessageCrc = ((uint16_t)ModbusPort.Rx.Buffer[BytesReceived - 1]) << 8;  // Note: The high and low byte of CRC shall be swapped in Modbus protocol 
-      MessageCrc += ModbusPort.Rx.Buffer[BytesReceived - 2];
+      return Range;
+    }
+  }
+  return NULL;
+}
 
-      if (MessageCrc == ComputedCrc)
-      {
-        Result = TRUE;
-      }
-      break;
-    
-    default:
-      break;
-    }  
+// The part of the registers from Address (Left of them) that is in one range, with Access. Offset is the first register
+// in the range and Count the number of registers. NULL if Address is not mapped, or the range has not Access.
+static const Modbus_Range *Modbus_Chunk(uint16_t Address, uint16_t Left, uint8_t Access, uint16_t *Offset,
+                                        uint16_t *Count)
+{
+  const Modbus_Range *Range = Modbus_FindRange(Address);
+
+  if ((Range == NULL) || ((Range->Access & Access) == 0))
+  {
+    return NULL;
   }
-  return Result;
+  *Offset = Address - Range->Address;
+  *Count = (uint16_t)Util_Min(Left, Range->Count - *Offset);
+  return Range;
 }
 
-// Serve received request acc. to Function code and put response message in Tx buffer 
-// Returns number of bytes to send
-static uint16_t Modbus_ServeRequest(void)
+// The storage of a range, in the current snapshot if it is in one
+static void *Modbus_Storage(const Modbus_Range *Range)
 {
-  uint16_t ResponseCrc;
-  uint16_t FirstAddress = 0;
-  uint16_t NumRegisters = 0;
-  uint16_t TempInt;
-  uint16_t(*pReadFunc)() = NULL;
-  void (*pWriteFunc)()  = NULL;
+  if (Range->Snapshot)
+  {
+    return (uint8_t *)*(void *volatile *)Range->Data + Range->Offset;
+  }
+  return Range->Data;
+}
+
+// Register Indx of a range that is not 16-bit storage, Storage from Modbus_Storage()
+static uint16_t Modbus_RangeRegister(const Modbus_Range *Range, const void *Storage, uint16_t Indx)
+{
+  union { float f; uint32_t u; } Value;
+  float Scaled;
+
+  switch (Range->Type)
+  {
+  case MODBUS_U32:
+  case MODBUS_I32:
+  case MODBUS_F32:                                // The bits of the float
+    Value.u = ((const uint32_t *)Storage)[Indx / 2U];
+    return (Indx % 2U == 0) ? (uint16_t)(Value.u >> 16) : (uint16_t)Value.u;
 
-  uint16_t WriteIndx = 0;
-  uint16_t ReadIndx  = 0;
-  uint16_t EndIndx = 0;
-  
-  ModbusPort.Tx.Buffer[0] = Modbus_Address;       // All responses start with address and Function code
-  ModbusPort.Tx.Buffer[1] = ModbusPort.Rx.Buffer[FUNCTION_CODE_INDX];
+  case MODBUS_F32_SCALED:
+    Value.u = ((const uint32_t *)Storage)[Indx];
+    Scaled = Value.f * Range->Scale;
+    if (!(Scaled > (float)INT16_MIN))             // Also NaN
+    {
+      return (uint16_t)INT16_MIN;
+    }
+    if (Scaled > (float)INT16_MAX)
+    {
+      return (uint16_t)INT16_MAX;
+    }
+    return (uint16_t)(int16_t)((Scaled < 0.0f) ? Scaled - 0.5f : Scaled + 0.5f);
 
-  FirstAddress = (ModbusPort.Rx.Buffer[2] << 8) | ModbusPort.Rx.Buffer[3];  // Note: All Function code requests send address of first register at this location
+  default:
+    return Range->Read(Indx);
+  }
+}
 
-  switch (ModbusPort.Rx.Buffer[FUNCTION_CODE_INDX])
+// Count registers of Range from Offset to Data, high byte first
+static void Modbus_ReadRange(const Modbus_Range *Range, uint16_t Offset, uint16_t Count, uint8_t *Data)
+{
+  const void *Storage = Modbus_Storage(Range);
+  const uint16_t *Registers;
+  uint16_t Indx, Value;
+
+  if ((Storage != NULL) && (Range->Type <= MODBUS_I16))
   {
-  case 4:
+    Registers = (const uint16_t *)Storage + Offset;
+    for (Indx = 0; Indx < Count; Indx++)        // Bulk copy with byte swap
+    {
+      *Data++ = (uint8_t)(Registers[Indx] >> 8);
+      *Data++ = (uint8_t)Registers[Indx];
+    }
+    return;
+  }
+  for (Indx = 0; Indx < Count; Indx++)
   {
-    NumRegisters = (ModbusPort.Rx.Buffer[4] << 8) | ModbusPort.Rx.Buffer[5];  // Number of registers to read
-    ModbusPort.Tx.Buffer[2] = 2 * NumRegisters;                               // Byte count of response payload
+    Value = Modbus_RangeRegister(Range, Storage, Offset + Indx);
+    *Data++ = (uint8_t)(Value >> 8);
+    *Data++ = (uint8_t)Value;
+  }
+}
+
+// Checks (Commit FALSE) or writes Count registers of Range from Offset, high byte first in Values. 32-bit storage is
+// written in whole values. Returns the exception code.
+static uint8_t Modbus_WriteRange(const Modbus_Range *Range, uint16_t Offset, uint16_t Count, const uint8_t *Values,
+                                 bool Commit)
+{
+  uint16_t Indx;
 
-    switch (FirstAddress / 0x1000)
+  if (Range->Data == NULL)
+  {
+    for (Indx = 0; Indx < Count; Indx++)
     {
-    case READ_SIGNALS:
-      ExportedSignals_Update();
-      pReadFunc = ExportedSignals_Read;
-      break;
+      if (!Range->Write(Offset + Indx, Modbus_Word(&Values[2U * Indx]), Commit))
+      {
+        return MODBUS_EXC_ILLEGAL_DATA_VALUE;
+      }
+    }
+    return MODBUS_EXC_NONE;
+  }
 
-    case READ_E2P:
-      pReadFunc = FlashE2p_ReadMirror;
-      break;
+  switch (Range->Type)
+  {
+  case MODBUS_U16:
+  case MODBUS_I16:
+    for (Indx = 0; Commit && (Indx < Count); Indx++)
+    {
+      ((uint16_t *)Range->Data)[Offset + Indx] = Modbus_Word(&Values[2U * Indx]);
+    }
+    return MODBUS_EXC_NONE;
 
-    default:
-      return 0;  // This can happen if an illegal address is requested, thus we return 0 here and no response will be sent
+  case MODBUS_F32_SCALED:
+    for (Indx = 0; Commit && (Indx < Count); Indx++)
+    {
+      ((float *)Range->Data)[Offset + Indx] = (float)(int16_t)Modbus_Word(&Values[2U * Indx]) / Range->Scale;
+    }
+    return MODBUS_EXC_NONE;
+
+  default:
+    if ((Offset % 2U != 0) || (Count % 2U != 0))
+    {
+      return MODBUS_EXC_ILLEGAL_DATA_ADDRESS;     // Half a value
+    }
+    for (Indx = 0; Commit && (Indx < Count); Indx += 2U)
+    {
+      ((uint32_t *)Range->Data)[(Offset + Indx) / 2U] = ((uint32_t)Modbus_Word(&Values[2U * Indx]) << 16) |
+                                                        Modbus_Word(&Values[2U * Indx + 2U]);
     }
+    return MODBUS_EXC_NONE;
+  }
+}
+
+// Count registers from Address to Data, high byte first. The registers may span several ranges, all shall be mapped
+// and readable. Returns the exception code.
+static uint8_t Modbus_ReadMap(uint16_t Address, uint16_t Count, uint8_t *Data)
+{
+  const Modbus_Range *Range;
+  uint16_t Done, Offset, Chunk;
 
-    // Write requested data (payload)
-    EndIndx = (FirstAddress % 0x1000) + NumRegisters;
-    for (WriteIndx = 3, ReadIndx = FirstAddress % 0x1000; ReadIndx < EndIndx; ReadIndx++)
+  if ((uint32_t)Address + Count > MODBUS_MAP_REGISTERS)
+  {
+    return MODBUS_EXC_ILLEGAL_DATA_ADDRESS;
+  }
+  for (Done = 0; Done < Count; Done += Chunk)
+  {
+    if (Modbus_Chunk(Address + Done, Count - Done, MODBUS_READ, &Offset, &Chunk) == NULL)
+    {
+      return MODBUS_EXC_ILLEGAL_DATA_ADDRESS;
+    }
+  }
+  for (Done = 0; Done < Count; Done += Chunk)
+  {
+    Range = Modbus_Chunk(Address + Done, Count - Done, MODBUS_READ, &Offset, &Chunk);
+    if (Range->Update != NULL)
     {
-      TempInt = pReadFunc(ReadIndx);
-      ModbusPort.Tx.Buffer[WriteIndx++] = (uint8_t)(TempInt >> 8);
-      ModbusPort.Tx.Buffer[WriteIndx++] = (uint8_t)TempInt;
+      Range->Update();
     }
+    Modbus_ReadRange(Range, Offset, Chunk, &Data[2U * Done]);
+  }
+  return MODBUS_EXC_NONE;
+}
+
+// Count registers from Address, high byte first in Values. All shall be mapped and writable, and either all are
+// written or none. Returns the exception code.
+static uint8_t Modbus_WriteMap(uint16_t Address, uint16_t Count, const uint8_t *Values)
+{
+  const Modbus_Range *Range;
+  uint16_t Done, Offset, Chunk;
+  uint8_t Exception = MODBUS_EXC_NONE;
+
+  if ((uint32_t)Address + Count > MODBUS_MAP_REGISTERS)
+  {
+    return MODBUS_EXC_ILLEGAL_DATA_ADDRESS;
+  }
+  for (Done = 0; (Done < Count) && (Exception == MODBUS_EXC_NONE); Done += Chunk)
+  {
+    Range = Modbus_Chunk(Address + Done, Count - Done, MODBUS_WRITE, &Offset, &Chunk);
+    Exception = (Range != NULL) ? Modbus_WriteRange(Range, Offset, Chunk, &Values[2U * Done], FALSE)
+                                : MODBUS_EXC_ILLEGAL_DATA_ADDRESS;
+  }
+  for (Done = 0; (Done < Count) && (Exception == MODBUS_EXC_NONE); Done += Chunk)
+  {
+    Range = Modbus_Chunk(Address + Done, Count - Done, MODBUS_WRITE, &Offset, &Chunk);
+    (void)Modbus_WriteRange(Range, Offset, Chunk, &Values[2U * Done], TRUE);
+  }
+  return Exception;
+}
+
+// Count registers from Address to the response after the function code. Returns the exception code.
+static uint8_t Modbus_ReadRegisters(uint16_t Address, uint16_t Count, uint16_t MaxCount, uint8_t *Response,
+                                    uint16_t *ResponseLength)
+{
+  uint8_t Exception;
+
+  if ((Count == 0) || (Count > MaxCount))
+  {
+    return MODBUS_EXC_ILLEGAL_DATA_VALUE;
+  }
+  Exception = Modbus_ReadMap(Address, Count, &Response[2]);
+  Response[1] = (uint8_t)(2U * Count);            // Byte count
+  *ResponseLength = 2U + 2U * Count;
+  return Exception;
+}
+
+// Count registers from Address, high byte first in Values. Returns the exception code.
+static uint8_t Modbus_WriteRegisters(uint16_t Address, uint16_t Count, uint16_t MaxCount, const uint8_t *Values)
+{
+  if ((Count == 0) || (Count > MaxCount))
+  {
+    return MODBUS_EXC_ILLEGAL_DATA_VALUE;
+  }
+  return Modbus_WriteMap(Address, Count, Values);
+}
+
+// Count bits from Address to the response after the function code, bit n is bit n % 16 of register Base + n / 16.
+// Returns the exception code.
+static uint8_t Modbus_ReadBits(uint16_t Base, uint16_t Address, uint16_t Count, uint8_t *Response,
+                               uint16_t *ResponseLength)
+{
+  uint16_t ByteCount = (Count + 7U) / 8U;
+  uint16_t First = Address / 16U;
+  uint16_t NumRegisters = (uint16_t)(((uint32_t)Address + Count - 1U) / 16U - First + 1U);
+  uint8_t *Data = &Response[2];
+  uint16_t Indx, Bit;
+  uint8_t Exception;
+
+  if ((Count == 0) || (Count > MODBUS_MAX_READ_BITS))
+  {
+    return MODBUS_EXC_ILLEGAL_DATA_VALUE;
+  }
+  Exception = Modbus_ReadMap(Base + First, NumRegisters, Modbus_Bits);
+  if (Exception != MODBUS_EXC_NONE)
+  {
+    return Exception;
+  }
+  memset(Data, 0, ByteCount);
+  for (Indx = 0; Indx < Count; Indx++)
+  {
+    Bit = Address % 16U + Indx;
+    if (Util_BitRead(Modbus_Word(&Modbus_Bits[2U * (Bit / 16U)]), Bit % 16U))
+    {
+      Data[Indx / 8U] |= (uint8_t)(1U << (Indx % 8U));
+    }
+  }
+  Response[1] = (uint8_t)ByteCount;
+  *ResponseLength = 2U + ByteCount;
+  return MODBUS_EXC_NONE;
+}
+
+// Count coils from Address (packed in Values, LSB first), i.e. bits of the registers from MODBUS_COIL_REGISTERS. The
+// registers are read, the coils set in them and the registers written, the bits outside are kept. Returns the exception
+// code.
+static uint8_t Modbus_WriteCoils(uint16_t Address, uint16_t Count, const uint8_t *Values)
+{
+  uint16_t First = Address / 16U;
+  uint16_t NumRegisters = (uint16_t)(((uint32_t)Address + Count - 1U) / 16U - First + 1U);
+  uint16_t Indx, Bit, Value;
+  uint8_t Exception;
+
+  if ((Count == 0) || (Count > MODBUS_MAX_WRITE_BITS))
+  {
+    return MODBUS_EXC_ILLEGAL_DATA_VALUE;
+  }
+  Exception = Modbus_ReadMap(MODBUS_COIL_REGISTERS + First, NumRegisters, Modbus_Bits);
+  if (Exception != MODBUS_EXC_NONE)
+  {
+    return Exception;
+  }
+  for (Indx = 0; Indx < Count; Indx++)
+  {
+    Bit = Address % 16U + Indx;
+    Value = Modbus_Word(&Modbus_Bits[2U * (Bit / 16U)]);
+    Util_BitWrite(Value, Bit % 16U, Util_BitRead(Values[Indx / 8U], Indx % 8U));
+    Modbus_Bits[2U * (Bit / 16U)] = (uint8_t)(Value >> 8);
+    Modbus_Bits[2U * (Bit / 16U) + 1U] = (uint8_t)Value;
+  }
+  return Modbus_WriteMap(MODBUS_COIL_REGISTERS + First, NumRegisters, Modbus_Bits);
+}
+
+uint16_t Modbus_ServePdu(const uint8_t *Request, uint16_t Length, uint8_t *Response)
+{
+  uint8_t Function = Request[0];
+  uint16_t Address = (Length >= 3) ? Modbus_Word(&Request[1]) : 0;   // All function codes but FC 23: first register
+  uint16_t Count = (Length >= 5) ? Modbus_Word(&Request[3]) : 0;     // Quantity, or the value of FC 5 and 6
+  uint16_t ResponseLength = 5;                    // FC 5, 6, 15 and 16: function code, address and value or quantity
+  uint8_t Exception = MODBUS_EXC_NONE;
+  uint8_t Coil;
+
+  memcpy(Response, Request, Util_Min(Length, ResponseLength));
+
+  // Fixed length: function code and 2 words. FC 15, 16 and 23 have the byte count of the data at index 5 and 9, the
+  // PDU shall end with the data.
+  switch (Function)
+  {
+  case MODBUS_FC_READ_COILS:
+  case MODBUS_FC_READ_DISCRETE_INPUTS:
+  case MODBUS_FC_READ_HOLDING_REGISTERS:
+  case MODBUS_FC_READ_INPUT_REGISTERS:
+  case MODBUS_FC_WRITE_SINGLE_COIL:
+  case MODBUS_FC_WRITE_SINGLE_REGISTER:
+    Exception = (Length == 5) ? MODBUS_EXC_NONE : MODBUS_EXC_ILLEGAL_DATA_VALUE;
+    break;
+
+  case MODBUS_FC_WRITE_MULTIPLE_COILS:
+  case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+    Exception = ((Length >= 6) && (Length == 6U + Request[5])) ? MODBUS_EXC_NONE : MODBUS_EXC_ILLEGAL_DATA_VALUE;
+    break;
+
+  case MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS:
+    Exception = ((Length >= 10) && (Length == 10U + Request[9])) ? MODBUS_EXC_NONE : MODBUS_EXC_ILLEGAL_DATA_VALUE;
+    break;
+
+  default:
+    Exception = MODBUS_EXC_ILLEGAL_FUNCTION;
     break;
   }
-  case 6:
+
+  if (Exception == MODBUS_EXC_NONE)
   {
-    switch (FirstAddress / 0x1000)
+    switch (Function)
     {
-    case WRITE_E2P:
-      pWriteFunc = FlashE2p_UpdateParameter;
-      pReadFunc = FlashE2p_ReadMirror;
+    case MODBUS_FC_READ_COILS:
+      Exception = Modbus_ReadBits(MODBUS_COIL_REGISTERS, Address, Count, Response, &ResponseLength);
+      break;
+
+    case MODBUS_FC_READ_DISCRETE_INPUTS:
+      Exception = Modbus_ReadBits(MODBUS_DISCRETE_REGISTERS, Address, Count, Response, &ResponseLength);
+      break;
+
+    case MODBUS_FC_READ_HOLDING_REGISTERS:
+    case MODBUS_FC_READ_INPUT_REGISTERS:
+      Exception = Modbus_ReadRegisters(Address, Count, MODBUS_MAX_READ_REGISTERS, Response, &ResponseLength);
+      break;
+
+    case MODBUS_FC_WRITE_SINGLE_COIL:
+      if ((Count != 0xFF00U) && (Count != 0x0000U))
+      {
+        Exception = MODBUS_EXC_ILLEGAL_DATA_VALUE;
+        break;
+      }
+      Coil = (Count != 0U) ? 1U : 0U;
+      Exception = Modbus_WriteCoils(Address, 1, &Coil);
+      break;
+
+    case MODBUS_FC_WRITE_SINGLE_REGISTER:     // The response is an echo of the request
+      Exception = Modbus_WriteRegisters(Address, 1, 1, &Request[3]);
+      break;
+
+    case MODBUS_FC_WRITE_MULTIPLE_COILS:
+      Exception = (Request[5] == (Count + 7U) / 8U) ? Modbus_WriteCoils(Address, Count, &Request[6])
+                                                    : MODBUS_EXC_ILLEGAL_DATA_VALUE;
+      break;
+
+    case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+      Exception = (Request[5] == 2U * Count) ? Modbus_WriteRegisters(Address, Count, MODBUS_MAX_WRITE_REGISTERS, &Request[6])
+                                             : MODBUS_EXC_ILLEGAL_DATA_VALUE;
+      break;
+
+    case MODBUS_FC_READ_WRITE_MULTIPLE_REGISTERS:   // The write is done before the read
+      Exception = (Request[9] == 2U * Modbus_Word(&Request[7])) ?
+                  Modbus_WriteRegisters(Modbus_Word(&Request[5]), Modbus_Word(&Request[7]), MODBUS_MAX_RW_WRITE_REGISTERS, &Request[10]) :
+                  MODBUS_EXC_ILLEGAL_DATA_VALUE;
+      if (Exception == MODBUS_EXC_NONE)
+      {
+        Exception = Modbus_ReadRegisters(Address, Count, MODBUS_MAX_READ_REGISTERS, Response, &ResponseLength);
+      }
       break;
 
     default:
-      return 0;  // This can happen if an illegal address is requested, thus we return 0 here and no response will be sent
+      break;
     }
+  }
+
+  if (Exception != MODBUS_EXC_NONE)
+  {
+    Response[0] = Function | MODBUS_EXCEPTION_FLAG;
+    Response[1] = Exception;
+    ResponseLength = 2;
+  }
+  return ResponseLength;
+}
 
-    pWriteFunc(FirstAddress % 0x1000, (ModbusPort.Rx.Buffer[4] << 8) | ModbusPort.Rx.Buffer[5]);  // Write received data on given address
-    TempInt = pReadFunc(FirstAddress % 0x1000);
+// Checks that the ranges of the map are sorted, do not overlap and are complete, and indexes the first range ending
+// after the start of each block
+static void Modbus_IndexMap(void)
+{
+  const Modbus_Range *Range;
+  uint32_t End = 0;
+  uint16_t Indx, Block;
 
-    ModbusPort.Tx.Buffer[2] = (uint8_t)(FirstAddress >> 8);    // FC 6: If register address is within limits the response will be an echo of the request
-    ModbusPort.Tx.Buffer[3] = (uint8_t)FirstAddress;
-    ModbusPort.Tx.Buffer[4] = (uint8_t)(TempInt >> 8);
-    ModbusPort.Tx.Buffer[5] = (uint8_t)TempInt;
-    WriteIndx = 6;
-    break;
+  if (ExportedSignals_MapSize > UINT8_MAX)
+  {
+    Error_Handler();
   }
-  default:
-    break;
+  for (Indx = 0; Indx < ExportedSignals_MapSize; Indx++)
+  {
+    Range = &ExportedSignals_Map[Indx];
+    if ((Range->Count == 0) || (Range->Address < End) ||
+        ((uint32_t)Range->Address + Range->Count > MODBUS_MAP_REGISTERS) ||
+        (((Range->Access & MODBUS_READ) != 0) && (Range->Data == NULL) && (Range->Read == NULL)) ||
+        (((Range->Access & MODBUS_WRITE) != 0) && (Range->Data == NULL) && (Range->Write == NULL)) ||
+        (((Range->Access & MODBUS_WRITE) != 0) && Range->Snapshot) ||
+        ((MODBUS_TYPE_REGS(Range->Type) == 2U) && (Range->Count % 2U != 0)))
+    {
+      Error_Handler();
+    }
+    End = (uint32_t)Range->Address + Range->Count;
+  }
+
+  Indx = 0;
+  for (Block = 0; Block < MODBUS_MAP_BLOCKS; Block++)
+  {
+    while ((Indx < ExportedSignals_MapSize) && ((uint32_t)ExportedSignals_Map[Indx].Address +
+           ExportedSignals_Map[Indx].Count <= ((uint32_t)Block << MODBUS_MAP_BLOCK_BITS)))
+    {
+      Indx++;
+    }
+    Modbus_MapBlock[Block] = (uint8_t)Indx;
   }
+}
+
+// Serve the RTU request and put the response PDU and its Crc in the descriptors
+static void Modbus_ServeRequest(uint16_t BytesReceived)
+{
+  uint16_t ResponseCrc;
+
+  Modbus_TxPayload.Data = ModbusPort.Tx.Buffer;
+  Modbus_TxPayload.Length = Modbus_ServePdu(&Modbus_Request[FUNCTION_CODE_INDX], BytesReceived - 3U, ModbusPort.Tx.Buffer);
 
   // All responses end with Crc
-  ResponseCrc = Crc_CalcCrc16(ModbusPort.Tx.Buffer, WriteIndx);
-  ModbusPort.Tx.Buffer[WriteIndx++] = (uint8_t)ResponseCrc;          // Note: The high and low byte of CRC shall be swapped in Modbus protocol
-  ModbusPort.Tx.Buffer[WriteIndx++] = (uint8_t)(ResponseCrc >> 8);
+  ResponseCrc = Crc_UpdateCrc16(CRC16_INIT, &Modbus_Address, 1);
+  ResponseCrc = Crc_UpdateCrc16(ResponseCrc, Modbus_TxPayload.Data, Modbus_TxPayload.Length);
+  Modbus_Crc[0] = (uint8_t)ResponseCrc;           // Note: The high and low byte of CRC shall be swapped in Modbus protocol
+  Modbus_Crc[1] = (uint8_t)(ResponseCrc >> 8);
+}
+
+// TC interrupt of ModbusPort: the last character of the response has been sent
+static void Modbus_TxComplete(UartPort *Port)
+{
+  Uart_StopTransmitter(Port);
+  Modbus_State = MODBUS_RX_READY;
+}
 
-  return WriteIndx;
+// One pulse of Ticks us, restarted if running
+static void Modbus_StartTimer(uint16_t Ticks)
+{
+  MODBUS_TIMER->ARR = Ticks - 1U;
+  MODBUS_TIMER->EGR = TIM_EGR_UG;             // Restart the count, URS: no update interrupt
+  MODBUS_TIMER->CR1 |= TIM_CR1_CEN;           // Cleared by the update, one pulse mode
+}
+
+// IDLE interrupt of ModbusPort: one character time has passed since the last character
+static void Modbus_RxIdle(UartPort *Port)
+{
+#ifdef TIC_TOC
+  Modbus_IdleCycles = DWT->CYCCNT;
+#endif
+  if (Modbus_GapState == MODBUS_GAP_T35)
+  {
+    Modbus_FrameBroken = TRUE;                // A character between t1.5 and t3.5, before the timer has seen it
+  }
+  Modbus_IdleRxPos = Uart_RxDmaPosition(Port);
+  Modbus_GapState = MODBUS_GAP_T15;
+  Modbus_StartTimer(Modbus_T15Ticks);
 }
 
-void Modbus_StateMachine(void)
+// t3.5 has passed: hand the frame over to the serve interrupt. It is dropped if it is broken, or if the slave is busy
+// with the previous request.
+static void Modbus_FrameEnd(void)
 {
-  static int State = MODBUS_RX_READY;
-  static uint32_t Timer = 0;
-  static uint16_t BytesToSend = 0;
-  uint16_t BytesReceived = 0;
+  uint16_t Length = 0;
 
-  switch (State) 
+  if (!Modbus_FrameBroken && (Modbus_RequestLength == 0) && (Modbus_State == MODBUS_RX_READY))
   {
-  case MODBUS_RX_READY:
-    BytesReceived = Uart_MessageReceived(&ModbusPort);
-    if (BytesReceived > 0)
+    Length = Uart_Read(&ModbusPort, Modbus_Request, sizeof(Modbus_Request));
+  }
+  (void)Uart_Read(&ModbusPort, NULL, 0xFFFFU);  // The rest, also of a frame longer than an ADU
+  Modbus_FrameBroken = FALSE;
+
+  if (Length > 0)
+  {
+#ifdef TIC_TOC
+    Modbus_RequestCycles = Modbus_IdleCycles;
+#endif
+    __DMB();                                  // The request must be in memory before it is published
+    Modbus_RequestLength = Length;
+    NVIC_SetPendingIRQ(MODBUS_SERVE_IRQ);
+  }
+}
+
+void TIM7_IRQHandler(void)
+{
+  bool Received = (Uart_RxDmaPosition(&ModbusPort) != Modbus_IdleRxPos);
+
+  MODBUS_TIMER->SR &= ~TIM_SR_UIF;
+  switch (Modbus_GapState)
+  {
+  case MODBUS_GAP_T15:
+    if (Received)
     {
-      if (Modbus_ValidRequest(BytesReceived))
-      {
-        //HAL_GPIO_TogglePin(GPIOB, GPIO_PIN_14);
-        Uart_StopReceiver(&ModbusPort);
-        State = MODBUS_TX_SENDING;
-        
-        BytesToSend = Modbus_ServeRequest();    // Note: Response is computed and put in Tx buffer, but it is transmitted next tick.
-      }
-      else
-      {
-        Uart_StartReceiver(&ModbusPort);  // Restart receiver
-      }
+      Modbus_GapState = MODBUS_GAP_NONE;      // The frame goes on, its next IDLE restarts the timer
+    }
+    else
+    {
+      Modbus_GapState = MODBUS_GAP_T35;
+      Modbus_StartTimer(Modbus_T35Ticks);
     }
     break;
 
-  case MODBUS_TX_SENDING:
-    Uart_StartTransmitter(&ModbusPort, BytesToSend);
-    State = MODBUS_TX_WAIT_FOR_TC;
-    break;
-  
-  case MODBUS_TX_WAIT_FOR_TC:
-    if (Uart_TransmissionComplete(&ModbusPort) || Timer++ > MODBUS_TIMEOUT)
+  case MODBUS_GAP_T35:
+    Modbus_GapState = MODBUS_GAP_NONE;
+    if (Received)
     {
-      Uart_StopTransmitter(&ModbusPort);
-      Uart_StartReceiver(&ModbusPort);
-      Timer = 0;
-      State = MODBUS_RX_READY;
+      Modbus_FrameBroken = TRUE;              // Dropped at the end of what follows
+    }
+    else
+    {
+      Modbus_FrameEnd();
     }
     break;
 
   default:
-    State = MODBUS_RX_READY;
     break;
   }
+}
 
+// t1.5 and t3.5 are 1.5 and 3.5 character times, fixed above 19200 baud. A character is seen by the DMA when its stop
+// bit is in, one character time after its start. The IDLE interrupt comes one character after the last, so from there
+// the timer runs t1.5 and t3.5 to see the characters that started before them.
+static void Modbus_SetBaudRate(uint16_t BaudIndx)
+{
+  uint32_t BaudRate = Modbus_BaudRates[BaudIndx];
+  uint32_t CharUs = (Uart_CharBits(&ModbusPort) * 1000000U + BaudRate - 1U) / BaudRate;
+  uint32_t T15Us = (BaudRate > MODBUS_FIXED_TIMING_BAUD) ? MODBUS_FIXED_T15_US : (3U * CharUs) / 2U;
+  uint32_t T35Us = (BaudRate > MODBUS_FIXED_TIMING_BAUD) ? MODBUS_FIXED_T35_US : (7U * CharUs) / 2U;
+  uint32_t Primask = __get_PRIMASK();
+
+  __disable_irq();                            // The timing is used by the Rx interrupts, above Scheduler_Lock()
+  Uart_SetBaudRate(&ModbusPort, BaudRate);
+  Modbus_T15Ticks = (uint16_t)T15Us;
+  Modbus_T35Ticks = (uint16_t)(T35Us - T15Us);
+  __set_PRIMASK(Primask);
+  Modbus_BaudIndx = (int16_t)BaudIndx;
 }
 
+// A new baud rate is taken into use between the requests, i.e. after the response to the write of the parameter
+static void Modbus_UpdateBaudRate(void)
+{
+  uint16_t BaudIndx = (uint16_t)Util_Min((uint16_t)FlashE2p_ReadMirror(E2P_MODBUS_BAUD_RATE), MODBUS_NUM_BAUD_RATES - 1U);
 
+  if (BaudIndx != Modbus_BaudIndx)
+  {
+    Modbus_SetBaudRate(BaudIndx);
+  }
+}
+
+void Modbus_Init(void)
+{
+  Modbus_IndexMap();
+
+  __HAL_RCC_TIM7_CLK_ENABLE();
+  MODBUS_TIMER->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+  MODBUS_TIMER->PSC = (2U * HAL_RCC_GetPCLK1Freq()) / MODBUS_TIMER_FREQ - 1U;   // APB1 timer clock is 2 x PCLK1
+  MODBUS_TIMER->EGR = TIM_EGR_UG;             // Load the prescaler
+  MODBUS_TIMER->SR &= ~TIM_SR_UIF;
+  MODBUS_TIMER->DIER = TIM_DIER_UIE;
+  HAL_NVIC_SetPriority(MODBUS_TIMER_IRQ, UART_RX_IRQ_PRIO, 0U);   // As the IDLE interrupt, they do not preempt each other
+  HAL_NVIC_EnableIRQ(MODBUS_TIMER_IRQ);
+  HAL_NVIC_SetPriority(MODBUS_SERVE_IRQ, MODBUS_SERVE_IRQ_PRIO, 0U);   // Below the frame timer, as Loop4ms
+  HAL_NVIC_EnableIRQ(MODBUS_SERVE_IRQ);
+
+  Modbus_UpdateBaudRate();
+  ModbusPort.OnTxComplete = Modbus_TxComplete;
+  ModbusPort.OnRxIdle = Modbus_RxIdle;
+}
+
+// Serve the request published by Modbus_FrameEnd() and queue the response, the TC interrupt sets RX_READY when it
+// has been sent. The turnaround probe is from the IDLE interrupt after the request, i.e. one character after its end,
+// to the queueing of the response.
+void CAN2_SCE_IRQHandler(void)
+{
+  uint16_t BytesReceived = Modbus_RequestLength;
+
+  if (BytesReceived == 0)
+  {
+    return;
+  }
+  __DMB();                                    // Read the request after its length
+  if (Modbus_ValidRequest(BytesReceived))
+  {
+    TIC(TICTOC_MODBUS_SERVE);
+    Modbus_ServeRequest(BytesReceived);
+    Modbus_TxTimer = 0;
+    Modbus_State = MODBUS_TX_WAIT_FOR_TC;     // Before the start, the TC interrupt sets RX_READY
+    Uart_Send(&ModbusPort, &Modbus_TxHeader);      // Back to back, the TC interrupt comes after the CRC
+    Uart_Send(&ModbusPort, &Modbus_TxPayload);
+    Uart_Send(&ModbusPort, &Modbus_TxCrc);
+#ifdef TIC_TOC
+    TicToc_Record(TICTOC_MODBUS_TURNAROUND, DWT->CYCCNT - Modbus_RequestCycles);
+#endif
+    TOC(TICTOC_MODBUS_SERVE);
+    TRACE_RECORD(TRACE_EVENT, TRACE_EVT_MODBUS_REQUEST, Modbus_Request[1]);   // Function code
+  }
+  Modbus_RequestLength = 0;                   // The response has its own buffers
+}
+
+// Same priority as the serve interrupt, they do not preempt each other
 void Modbus_4ms(void)
 {
-  Modbus_StateMachine();
+  switch (Modbus_State)
+  {
+  case MODBUS_RX_READY:
+    if (Modbus_RequestLength == 0)
+    {
+      Modbus_UpdateBaudRate();
+    }
+    break;
+
+  case MODBUS_TX_WAIT_FOR_TC:
+    if (Modbus_TxTimer++ > MODBUS_TIMEOUT)
+    {
+      Uart_StopTransmitter(&ModbusPort);
+      Modbus_State = MODBUS_RX_READY;
+    }
+    break;
+
+  default:
+    Modbus_State = MODBUS_RX_READY;
+    break;
+  }
 }
@@ -0,0 +1,250 @@
+/**
+******************************************************************************
+* @file    /Src/ModbusTcp.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Modbus TCP server on port 502, lwIP raw API in the context of Network_4ms(), i.e. the Network rate group.
+*          Each ADU is the MBAP header (transaction, protocol and unit identifier, length) and a PDU, which is served by
+*          Modbus_ServePdu() as the RTU requests. Several clients can be connected, a client may send its requests back to back.
+*          The received pbufs of a connection are queued until their requests are served, and the TCP window is only
+*          opened (tcp_recved) for the bytes served. So a client is held back by its window when the responses do not
+*          fit the send buffer, and the server does not need an Rx buffer of its own.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "lwip/tcp.h"
+#include "ProjectDefs.h"
+#include "ModbusTcp.h"
+#include "Modbus.h"
+#include "Scheduler.h"
+#include "Trace.h"
+
+#define MODBUS_TCP_PROTOCOL_ID    0       // Modbus
+#define MODBUS_TCP_HEADER_SIZE    7       // MBAP header, incl. the unit identifier
+#define MODBUS_TCP_MAX_ADU_SIZE   (MODBUS_TCP_HEADER_SIZE + MODBUS_MAX_PDU_SIZE)
+#define MODBUS_TCP_POLL_INTERVAL  2       // [500 ms] Retry of the requests waiting for the send buffer
+
+typedef struct {
+  struct tcp_pcb *Pcb;                    // NULL if the slot is free
+  struct pbuf *Queue;                     // Received, not yet served
+  uint16_t Offset;                        // Of the next request in Queue
+} ModbusTcp_Client;
+
+static struct tcp_pcb *ModbusTcp_ListenPcb;
+static ModbusTcp_Client ModbusTcp_Clients[MODBUS_TCP_MAX_CLIENTS];
+
+// lwIP runs in one context, so the buffers are shared by the connections
+static uint8_t ModbusTcp_Request[MODBUS_TCP_MAX_ADU_SIZE];
+static uint8_t ModbusTcp_Response[MODBUS_TCP_MAX_ADU_SIZE];
+
+
+// 16-bit field of the MBAP header, high byte first
+static uint16_t ModbusTcp_Word(const uint8_t *Data)
+{
+  return ((uint16_t)Data[0] << 8) | Data[1];
+}
+
+// Serves the complete requests in the queue, as long as the send buffer has room for a response. Returns FALSE if the
+// stream is not Modbus, the connection shall then be closed.
+static bool ModbusTcp_Serve(ModbusTcp_Client *Client)
+{
+  struct pbuf *Head;
+  uint16_t Available, Length, PduLength;
+  uint16_t Served = 0;
+  uint32_t Lock;
+  bool Ok = TRUE;
+
+  while ((Client->Queue != NULL) && ((Available = Client->Queue->tot_len - Client->Offset) >= MODBUS_TCP_HEADER_SIZE))
+  {
+    (void)pbuf_copy_partial(Client->Queue, ModbusTcp_Request, MODBUS_TCP_HEADER_SIZE, Client->Offset);
+    Length = ModbusTcp_Word(&ModbusTcp_Request[4]);          // Unit identifier and PDU
+    if ((ModbusTcp_Word(&ModbusTcp_Request[2]) != MODBUS_TCP_PROTOCOL_ID) || (Length < 2U) ||
+        (Length > MODBUS_MAX_PDU_SIZE + 1U))
+    {
+      Ok = FALSE;
+      break;
+    }
+    if ((Available < 6U + Length) ||                         // The rest has not arrived yet
+        (tcp_sndbuf(Client->Pcb) < MODBUS_TCP_MAX_ADU_SIZE) || (tcp_sndqueuelen(Client->Pcb) >= TCP_SND_QUEUELEN))
+    {
+      break;                                                  // Continued when more is received or sent
+    }
+    (void)pbuf_copy_partial(Client->Queue, ModbusTcp_Request, 6U + Length, Client->Offset);
+
+    // As the RTU requests, served at the priority of the 4 ms rate group, above the Network rate group
+    Lock = Scheduler_Lock();
+    PduLength = Modbus_ServePdu(&ModbusTcp_Request[MODBUS_TCP_HEADER_SIZE], Length - 1U,
+                                &ModbusTcp_Response[MODBUS_TCP_HEADER_SIZE]);
+    Scheduler_Unlock(Lock);
+    TRACE_RECORD(TRACE_EVENT, TRACE_EVT_MODBUS_REQUEST, ModbusTcp_Request[MODBUS_TCP_HEADER_SIZE]);   // Function code
+
+    memcpy(ModbusTcp_Response, ModbusTcp_Request, MODBUS_TCP_HEADER_SIZE);   // Transaction, protocol and unit identifier
+    ModbusTcp_Response[4] = (uint8_t)((PduLength + 1U) >> 8);
+    ModbusTcp_Response[5] = (uint8_t)(PduLength + 1U);
+    Client->Offset += 6U + Length;
+    Served += 6U + Length;
+    if (tcp_write(Client->Pcb, ModbusTcp_Response, MODBUS_TCP_HEADER_SIZE + PduLength, TCP_WRITE_FLAG_COPY) != ERR_OK)
+    {
+      break;                              // Out of memory, the response is lost and the client times out
+    }
+  }
+
+  // Release the pbufs served. Each holds the reference to the next, which is taken over by the queue.
+  while ((Client->Queue != NULL) && (Client->Offset >= Client->Queue->len))
+  {
+    Head = Client->Queue;
+    Client->Offset -= Head->len;
+    Client->Queue = Head->next;
+    Head->next = NULL;
+    Head->tot_len = Head->len;
+    (void)pbuf_free(Head);
+  }
+
+  if (Served > 0)
+  {
+    tcp_recved(Client->Pcb, Served);
+    (void)tcp_output(Client->Pcb);
+  }
+  return Ok;
+}
+
+static void ModbusTcp_Release(ModbusTcp_Client *Client)
+{
+  if (Client->Queue != NULL)
+  {
+    (void)pbuf_free(Client->Queue);
+  }
+  Client->Queue = NULL;
+  Client->Offset = 0;
+  Client->Pcb = NULL;
+}
+
+// Returns ERR_ABRT if the connection had to be aborted, the callback shall then return it to lwIP
+static err_t ModbusTcp_Close(ModbusTcp_Client *Client)
+{
+  struct tcp_pcb *Pcb = Client->Pcb;
+  err_t Err = ERR_OK;
+
+  tcp_arg(Pcb, NULL);
+  tcp_recv(Pcb, NULL);
+  tcp_sent(Pcb, NULL);
+  tcp_err(Pcb, NULL);
+  tcp_poll(Pcb, NULL, 0);
+  ModbusTcp_Release(Client);
+  if (tcp_close(Pcb) != ERR_OK)
+  {
+    tcp_abort(Pcb);
+    Err = ERR_ABRT;
+  }
+  return Err;
+}
+
+static err_t ModbusTcp_Recv(void *Arg, struct tcp_pcb *Pcb, struct pbuf *p, err_t Err)
+{
+  ModbusTcp_Client *Client = (ModbusTcp_Client *)Arg;
+
+  LWIP_UNUSED_ARG(Pcb);
+  if (p == NULL)                          // Closed by the client
+  {
+    return ModbusTcp_Close(Client);
+  }
+  if (Err != ERR_OK)
+  {
+    (void)pbuf_free(p);
+    return Err;
+  }
+
+  if (Client->Queue == NULL)
+  {
+    Client->Queue = p;
+  }
+  else
+  {
+    pbuf_cat(Client->Queue, p);
+  }
+  return ModbusTcp_Serve(Client) ? ERR_OK : ModbusTcp_Close(Client);
+}
+
+// Responses have been acknowledged, the requests waiting for room in the send buffer are served
+static err_t ModbusTcp_Sent(void *Arg, struct tcp_pcb *Pcb, u16_t Length)
+{
+  ModbusTcp_Client *Client = (ModbusTcp_Client *)Arg;
+
+  LWIP_UNUSED_ARG(Pcb);
+  LWIP_UNUSED_ARG(Length);
+  return ModbusTcp_Serve(Client) ? ERR_OK : ModbusTcp_Close(Client);
+}
+
+static err_t ModbusTcp_Poll(void *Arg, struct tcp_pcb *Pcb)
+{
+  return ModbusTcp_Sent(Arg, Pcb, 0);
+}
+
+// The pcb has already been freed by lwIP
+static void ModbusTcp_Error(void *Arg, err_t Err)
+{
+  LWIP_UNUSED_ARG(Err);
+  if (Arg != NULL)
+  {
+    ModbusTcp_Release((ModbusTcp_Client *)Arg);
+  }
+}
+
+static err_t ModbusTcp_Accept(void *Arg, struct tcp_pcb *NewPcb, err_t Err)
+{
+  ModbusTcp_Client *Client = NULL;
+  uint16_t Indx;
+
+  LWIP_UNUSED_ARG(Arg);
+  if ((Err != ERR_OK) || (NewPcb == NULL))
+  {
+    return ERR_VAL;
+  }
+  for (Indx = 0; (Indx < MODBUS_TCP_MAX_CLIENTS) && (Client == NULL); Indx++)
+  {
+    if (ModbusTcp_Clients[Indx].Pcb == NULL)
+    {
+      Client = &ModbusTcp_Clients[Indx];
+    }
+  }
+  if (Client == NULL)                     // All connections in use
+  {
+    tcp_abort(NewPcb);
+    return ERR_ABRT;
+  }
+
+  Client->Pcb = NewPcb;
+  Client->Queue = NULL;
+  Client->Offset = 0;
+  tcp_setprio(NewPcb, TCP_PRIO_MIN);
+  tcp_arg(NewPcb, Client);
+  tcp_recv(NewPcb, ModbusTcp_Recv);
+  tcp_sent(NewPcb, ModbusTcp_Sent);
+  tcp_err(NewPcb, ModbusTcp_Error);
+  tcp_poll(NewPcb, ModbusTcp_Poll, MODBUS_TCP_POLL_INTERVAL);
+  return ERR_OK;
+}
+
+void ModbusTcp_Init(void)
+{
+  struct tcp_pcb *Pcb = tcp_new();
+
+  if (Pcb == NULL)
+  {
+    return;
+  }
+  if (tcp_bind(Pcb, IP_ADDR_ANY, MODBUS_TCP_PORT) != ERR_OK)
+  {
+    (void)tcp_close(Pcb);
+    return;
+  }
+  ModbusTcp_ListenPcb = tcp_listen(Pcb);
+  if (ModbusTcp_ListenPcb != NULL)
+  {
+    tcp_accept(ModbusTcp_ListenPcb, ModbusTcp_Accept);
+  }
+}
@@ -14,6 +14,8 @@
 #include "Pwm.h"
 #include "SensorMgr.h"
 #include "FlashE2p.h"
+#include "TicToc.h"
+#include "IrqMon.h"
 
 /* Timer handler declaration */
 TIM_HandleTypeDef        Timer14Handle;
@@ -247,6 +249,10 @@ void NeoPixel_100ms(void)
 */
 void TIM8_TRG_COM_TIM14_IRQHandler(void)
 {
+#ifdef IRQ_MON
+  uint32_t EntryTicks = TIM14->CNT;        // Update event at CNT = 0. The monitor is called after the duty is written.
+#endif
+
   /* TIM Update event */
   if (__HAL_TIM_GET_FLAG(&Timer14Handle, TIM_FLAG_UPDATE) != RESET)
   {
@@ -254,6 +260,9 @@ void TIM8_TRG_COM_TIM14_IRQHandler(void)
     {
       //------------------ NeoPixel part starts ------------------
       TIM14->CCR1 = NeoTx.PreComputedDuty; // Note: Writing duty is very time critical. Shall be done within 0.4 us after IRQ occurs. Thus the value is precomputed
+      IRQMON_MARK(IRQMON_TIM14, TIM14->CNT);   // Checks the 0.4 us
+      IRQMON_ENTER(IRQMON_TIM14, EntryTicks);
+      TIC(TICTOC_TIM14_ISR);
 
       if (NeoTx.ColorBit != 0) {
         NeoTx.ColorBit--;
@@ -275,6 +284,8 @@ void TIM8_TRG_COM_TIM14_IRQHandler(void)
       }
       //------------------ END OF NeoPixel part ------------------
       __HAL_TIM_CLEAR_IT(&Timer14Handle, TIM_IT_UPDATE);
+      TOC(TICTOC_TIM14_ISR);
+      IRQMON_EXIT(IRQMON_TIM14);
     }
   }
 }
\ No newline at end of file
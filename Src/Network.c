@@ -15,17 +15,27 @@
 #include "ethernetif.h"
 #include "app_ethernet.h"
 #include "tcp_echoserver.h"
+#include "ModbusTcp.h"
 #include "Network.h"
 #include "Uart.h"
+#include "TicToc.h"
+#include "Scheduler.h"
+#include "BgJob.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#define NETWORK_MAX_FRAMES_PER_POLL  (2U * ETH_RXBUFNB)   // Bounds the time of a poll if frames keep arriving
+#define NETWORK_ARP_PRINT_POLLS      2500U                // [4 ms] The ARP table is printed every 10 s
+#define NETWORK_ARP_ENTRIES          5                    // Printed entries of the ARP table
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 struct netif gnetif; /* network interface structure */
 
 /* Private function prototypes -----------------------------------------------*/
 static void Netif_Config(void);
+static uint8_t Network_PrintArpStep(BgJob *Job);
+
+static BgJob Network_PrintArpJob = BGJOB("PrintArp", Network_PrintArpStep, NULL, NULL);
 
 /* Private functions ---------------------------------------------------------*/
 
@@ -39,41 +49,35 @@ void Network_Init(void)
   
   /* tcp echo server Init */
   tcp_echoserver_init();
+
+  /* Modbus TCP server on port 502 */
+  ModbusTcp_Init();
   
   /* Notify user about the netwoek interface config */
   User_notification(&gnetif);
 }
 
-void Network_1ms(void)
+void Network_4ms(void)
 {
-  /* Read a received packet from the Ethernet buffers and send it to the lwIP for handling */
-  ethernetif_input(&gnetif);
+  uint32_t Frames = 0;
+
+  /* Read the received packets from the Ethernet buffers and send them to the lwIP for handling, until the Rx
+     descriptors are empty. A frame not read in time is dropped by the MAC when all descriptors are in use. */
+  TIC(TICTOC_ETH_INPUT);
+  while ((Frames < NETWORK_MAX_FRAMES_PER_POLL) && ethernetif_input(&gnetif))
+  {
+    Frames++;
+  }
+  TOC(TICTOC_ETH_INPUT);
 
   /* Handle timeouts */
   sys_check_timeouts();
 
   static uint32_t count = 0;
   count++;
-  if (count % 100 == 0)
+  if (count % NETWORK_ARP_PRINT_POLLS == 0)
   {
-    uint8_t i = 0;
-    ip4_addr_t *ipaddr;
-    struct netif *netif;
-    struct eth_addr *eth_ret;
-    uint8_t r = 0;
-    UART_PRINTF("ARP table entries:\r\n");
-    for (i = 0; i < 5; i++) {
-      if (etharp_get_entry(i, &ipaddr, &netif, &eth_ret))
-      {
-        UART_PRINTF("MAC: %02X-%02X-%02X-%02X-%02X-%02X\r\n",
-          eth_ret->addr[0], eth_ret->addr[1], eth_ret->addr[2], eth_ret->addr[3], eth_ret->addr[4], eth_ret->addr[5]);
-        UART_PRINTF("IP: %d.%d.%d.%d\r\n", ip4_addr1(ipaddr), ip4_addr2(ipaddr), ip4_addr3(ipaddr), ip4_addr4(ipaddr));
-      }
-
-    }
-    
-
-
+    (void)BgJob_Start(&Network_PrintArpJob);    // Printed in the background, not in the rate group
   }
 
 #ifdef USE_DHCP
@@ -82,6 +86,43 @@ void Network_1ms(void)
 #endif 
 }
 
+// Prints one entry of the ARP table per step. The entry is copied with the Network rate group masked, since lwIP may
+// change the table while the background job runs.
+static uint8_t Network_PrintArpStep(BgJob *Job)
+{
+  ip4_addr_t *ipaddr;
+  struct netif *netif;
+  struct eth_addr *eth_ret;
+  ip4_addr_t Ip;
+  struct eth_addr Mac;
+  uint32_t Lock;
+  bool Valid;
+
+  if (Job->State == 0)
+  {
+    UART_PRINTF("ARP table entries:\r\n");
+  }
+
+  Lock = Scheduler_Lock();
+  Valid = etharp_get_entry((u8_t)Job->State, &ipaddr, &netif, &eth_ret) != 0;
+  if (Valid)
+  {
+    Ip = *ipaddr;
+    Mac = *eth_ret;
+  }
+  Scheduler_Unlock(Lock);
+
+  if (Valid)
+  {
+    UART_PRINTF("MAC: %02X-%02X-%02X-%02X-%02X-%02X\r\n",
+      Mac.addr[0], Mac.addr[1], Mac.addr[2], Mac.addr[3], Mac.addr[4], Mac.addr[5]);
+    UART_PRINTF("IP: %d.%d.%d.%d\r\n", ip4_addr1(&Ip), ip4_addr2(&Ip), ip4_addr3(&Ip), ip4_addr4(&Ip));
+  }
+
+  Job->State++;
+  return (Job->State >= NETWORK_ARP_ENTRIES) ? BGJOB_DONE : (uint8_t)(Job->State * 100U / NETWORK_ARP_ENTRIES);
+}
+
 /**
   * @brief  Configurates the network interface
   * @param  None
@@ -18,6 +18,9 @@
 #include "Util.h"
 #include "Crc.h"
 #include "Uart.h"
+#include "EventQueue.h"
+#include "IrqMon.h"
+#include "Trace.h"
 
 static volatile uint32_t RxBuff[RX_BUF_SIZE];
 static volatile uint32_t RxBuffIndx = 0;
@@ -165,7 +168,8 @@ static void RadioReceiver_CheckBuffer(void)
 }
 
 
-void RadioReceieve_100ms(void)
+// Posted by TIM5 when the silence after a message has been received, i.e. the message is checked immediately in the main loop
+static void RadioReceive_OnSilence(uint32_t Data)
 {
   RadioReceiver_CheckBuffer();
 }
@@ -177,14 +181,26 @@ void RadioReceieve_100ms(void)
 */
 void TIM5_IRQHandler(void)
 {  
+  uint32_t Capture;
+
+  IRQMON_ENTER(IRQMON_TIM5, 0);
+
   // TIM 5 Input Capture interrupt on Channel 1
   if (__HAL_TIM_GET_FLAG(&Timer5Handle, TIM_SR_CC1IF) != RESET)
   {
     if (__HAL_TIM_GET_IT_SOURCE(&Timer5Handle, TIM_DIER_CC1IE) != RESET)
     {
-      RxBuff[RxBuffIndx] = Timer5Handle.Instance->CCR1;        // CCxIF flag is cleared when reading CCRx register 
+      Capture = Timer5Handle.Instance->CCR1;                   // CCxIF flag is cleared when reading CCRx register 
+      IRQMON_LATENCY(IRQMON_TIM5, Timer5Handle.Instance->CNT - Capture);
+      RxBuff[RxBuffIndx] = Capture;
+      if (Capture - RxBuff[(RxBuffIndx - 1) % RX_BUF_SIZE] > RX_MIN_SILENCE)
+      {
+        (void)EventQueue_Post(&EventQueue_Prio9, RadioReceive_OnSilence, 0);   // If the queue is full the message is checked at next silence
+        TRACE_RECORD(TRACE_EVENT, TRACE_EVT_RADIO_SILENCE, RxBuffIndx);
+      }
       RxBuffIndx = (RxBuffIndx + 1) % RX_BUF_SIZE;
     }
   }
+  IRQMON_EXIT(IRQMON_TIM5);
 }
 
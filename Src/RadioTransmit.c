@@ -60,7 +60,7 @@ void RadioTransmit_Init(void)
 
 
   /*Configure the TIM13 IRQ priority */
-  HAL_NVIC_SetPriority(TIM8_UP_TIM13_IRQn, 13U, 0U);   // Interrupt prio number 13, i.e. low prio. 
+  HAL_NVIC_SetPriority(TIM8_UP_TIM13_IRQn, 9U, 0U);    // Interrupt prio number 9, above the rate groups (see Scheduler.h) to keep bit timing. 
 
   /* Enable the TIM13 global Interrupt */
   HAL_NVIC_EnableIRQ(TIM8_UP_TIM13_IRQn);
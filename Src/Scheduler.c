@@ -0,0 +1,435 @@
+/**
+******************************************************************************
+* @file    /Src/Scheduler.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Table driven rate group scheduler. The tasks are released from SysTick and executed either in the main loop
+*          or preemptively in a software interrupt (an unused peripheral IRQ vector pended by SysTick).
+*          For each task the scheduler keeps track of missed activations (released again before it started),
+*          execution time and start jitter. Time is measured with Timer 2 (10 MHz), see InputCapture.c
+*          When there is nothing to do the main loop sleeps in WFI. The idle time and the time used by each task
+*          are measured with the DWT cycle counter, which gives the CPU load.
+*          Also provides the primitives for exchanging data between the rate groups: a BASEPRI lock and a triple buffered mailbox.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ProjectDefs.h"
+#include "Scheduler.h"
+#include "InputCapture.h"
+#include "Util.h"
+#include "Uart.h"
+#include "Trace.h"
+#include <string.h>
+
+#define TIM2_TICKS_PER_US  (TIM2_CLOCK_FREQ / 1000000U)
+#define MAX_HYPER_PERIOD   10000U     // [ms] Limits the load analysis if the periods are badly chosen
+
+static Scheduler_Task *Scheduler_Tasks = NULL;
+static uint16_t Scheduler_NumTasks = 0;
+
+static uint32_t Scheduler_BusyCycles = 0;       // Net cycles of all finished task executions, used to remove preemption
+static uint32_t Scheduler_IdleCycles = 0;       // Cycles in WFI during the current load period
+static uint32_t Scheduler_LoadPeriodStart = 0;
+static uint16_t Scheduler_LoadTicks = 0;
+static uint16_t Scheduler_TotalLoad = 0;        // [0.1 %]
+
+
+void Scheduler_Init(Scheduler_Task *Tasks, uint16_t NumTasks)
+{
+  Scheduler_Task *Task;
+
+  for (Task = Tasks; Task < Tasks + NumTasks; Task++)
+  {
+    Task->OffsetMs %= Task->PeriodMs;
+    Task->TicksToRelease = (Task->OffsetMs == 0) ? Task->PeriodMs : Task->OffsetMs;
+    Task->Pending = FALSE;
+    Task->ReleaseTime = 0;
+    Task->Missed = 0;
+    Task->Activations = 0;
+    Task->BudgetOverruns = 0;
+    Task->ExecTime = 0;
+    Task->ExecTimeMax = 0;
+    Task->StartJitter = 0;
+    Task->StartJitterMax = 0;
+    Task->Cycles = 0;
+    Task->CpuLoad = 0;
+  }
+
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;   // Enable the DWT cycle counter, not reset since only differences are used
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  Scheduler_LoadPeriodStart = DWT->CYCCNT;
+
+  Scheduler_Tasks = Tasks;
+  Scheduler_NumTasks = Util_Min(NumTasks, SCHEDULER_MAX_TASKS);
+
+  for (Task = Tasks; Task < Tasks + Scheduler_NumTasks; Task++)
+  {
+    if (Task->IRQn != SCHEDULER_NO_IRQ)
+    {
+      HAL_NVIC_SetPriority(Task->IRQn, Util_Max(Task->Priority, SCHEDULER_PRIO_HIGHEST), 0U);
+      HAL_NVIC_EnableIRQ(Task->IRQn);
+    }
+  }
+}
+
+// Calculate the CPU load of the period that just ended and start a new one. The accumulators are also written by
+// lower prio contexts, which do that with interrupts disabled.
+static void Scheduler_UpdateLoad(void)
+{
+  Scheduler_Task *Task;
+  uint32_t Now = DWT->CYCCNT;
+  uint32_t PermilleCycles = (Now - Scheduler_LoadPeriodStart) / 1000U;
+
+  if (PermilleCycles == 0)
+  {
+    return;
+  }
+  for (Task = Scheduler_Tasks; Task < Scheduler_Tasks + Scheduler_NumTasks; Task++)
+  {
+    Task->CpuLoad = Util_Min(Task->Cycles / PermilleCycles, 1000U);
+    Task->Cycles = 0;
+  }
+  Scheduler_TotalLoad = 1000U - Util_Min(Scheduler_IdleCycles / PermilleCycles, 1000U);
+  Scheduler_IdleCycles = 0;
+  Scheduler_LoadPeriodStart = Now;
+}
+
+void Scheduler_Tick(void)
+{
+  Scheduler_Task *Task;
+  uint32_t Now = InputCapture_GetCurrentTime();
+
+  if (++Scheduler_LoadTicks >= SCHEDULER_LOAD_PERIOD_MS)
+  {
+    Scheduler_LoadTicks = 0;
+    Scheduler_UpdateLoad();
+  }
+
+  for (Task = Scheduler_Tasks; Task < Scheduler_Tasks + Scheduler_NumTasks; Task++)
+  {
+    if (--Task->TicksToRelease == 0)
+    {
+      Task->TicksToRelease = Task->PeriodMs;
+
+      if (Task->Pending)    // Previous activation has not even started, i.e. this one is lost
+      {
+        Task->Missed++;
+      }
+      else
+      {
+        Task->ReleaseTime = Now;
+        Task->Pending = TRUE;
+        if (Task->IRQn != SCHEDULER_NO_IRQ)
+        {
+          NVIC_SetPendingIRQ(Task->IRQn);   // Executes when the tick ISR returns, unless a higher prio rate group is running
+        }
+      }
+    }
+  }
+}
+
+// Execute one activation of the task and update its statistics
+static void Scheduler_Execute(Scheduler_Task *Task)
+{
+  uint32_t ReleaseTime, StartTime;
+  uint32_t StartCycles, StartBusyCycles, NetCycles;
+
+  __disable_irq();                // Release time and pending flag are written by SysTick, read them as a pair
+  ReleaseTime = Task->ReleaseTime;
+  Task->Pending = FALSE;          // Cleared before execution, so a release during execution is not counted as missed
+  StartCycles = DWT->CYCCNT;
+  StartBusyCycles = Scheduler_BusyCycles;
+  __enable_irq();
+
+  StartTime = InputCapture_GetCurrentTime();
+  TRACE_RECORD(TRACE_TASK_START, Task - Scheduler_Tasks, 0);
+  Task->Func();
+  TRACE_RECORD(TRACE_TASK_STOP, Task - Scheduler_Tasks, 0);
+  Task->ExecTime = (InputCapture_GetCurrentTime() - StartTime) / TIM2_TICKS_PER_US;   // Includes time preempted by higher prio
+
+  // Tasks that preempted this one have added their net cycles to BusyCycles meanwhile, subtract them to get the net cycles
+  // of this task. Time in peripheral interrupts is not removed, it is small compared to the rate groups.
+  __disable_irq();
+  NetCycles = (DWT->CYCCNT - StartCycles) - (Scheduler_BusyCycles - StartBusyCycles);
+  Scheduler_BusyCycles += NetCycles;
+  Task->Cycles += NetCycles;
+  __enable_irq();
+
+  Task->StartJitter = (StartTime - ReleaseTime) / TIM2_TICKS_PER_US;
+  Task->StartJitterMax = Util_Max(Task->StartJitterMax, Task->StartJitter);
+  Task->ExecTimeMax = Util_Max(Task->ExecTimeMax, Task->ExecTime);
+  if (Task->ExecTime > Task->BudgetUs)
+  {
+    Task->BudgetOverruns++;
+  }
+  Task->Activations++;
+}
+
+bool Scheduler_Run(void)
+{
+  Scheduler_Task *Task;
+
+  for (Task = Scheduler_Tasks; Task < Scheduler_Tasks + Scheduler_NumTasks; Task++)
+  {
+    if (Task->Pending && (Task->IRQn == SCHEDULER_NO_IRQ))
+    {
+      Scheduler_Execute(Task);
+      return TRUE;                    // Start over from the highest priority task
+    }
+  }
+  return FALSE;
+}
+
+void Scheduler_Idle(bool (*WorkPending)(void))
+{
+  Scheduler_Task *Task;
+  uint32_t StartCycles;
+
+  // With interrupts disabled WFI still wakes up on a pending interrupt, but the handler is not executed until they are
+  // enabled again. Thus a release can not be missed between the check below and WFI, and only sleep is counted as idle.
+  __disable_irq();
+  for (Task = Scheduler_Tasks; Task < Scheduler_Tasks + Scheduler_NumTasks; Task++)
+  {
+    if (Task->Pending && (Task->IRQn == SCHEDULER_NO_IRQ))
+    {
+      __enable_irq();
+      return;
+    }
+  }
+  if ((WorkPending != NULL) && WorkPending())
+  {
+    __enable_irq();
+    return;
+  }
+  StartCycles = DWT->CYCCNT;
+  __WFI();
+  Scheduler_IdleCycles += DWT->CYCCNT - StartCycles;
+  __enable_irq();
+}
+
+uint16_t Scheduler_CpuLoad(void)
+{
+  return Scheduler_TotalLoad;
+}
+
+// Common part of the software interrupt handlers. Executes the pending task(s) bound to the interrupt.
+static void Scheduler_IrqRun(IRQn_Type IRQn)
+{
+  Scheduler_Task *Task;
+
+  for (Task = Scheduler_Tasks; Task < Scheduler_Tasks + Scheduler_NumTasks; Task++)
+  {
+    if (Task->Pending && (Task->IRQn == IRQn))
+    {
+      Scheduler_Execute(Task);
+    }
+  }
+}
+
+// The CAN controllers are not used in this project, their interrupt vectors serve as software interrupts for the rate groups.
+// CAN2_SCE_IRQHandler serves the Modbus requests, see Modbus.c.
+void CAN1_TX_IRQHandler(void)
+{
+  Scheduler_IrqRun(CAN1_TX_IRQn);
+}
+
+void CAN1_RX0_IRQHandler(void)
+{
+  Scheduler_IrqRun(CAN1_RX0_IRQn);
+}
+
+void CAN1_RX1_IRQHandler(void)
+{
+  Scheduler_IrqRun(CAN1_RX1_IRQn);
+}
+
+void CAN1_SCE_IRQHandler(void)
+{
+  Scheduler_IrqRun(CAN1_SCE_IRQn);
+}
+
+void CAN2_TX_IRQHandler(void)
+{
+  Scheduler_IrqRun(CAN2_TX_IRQn);
+}
+
+void CAN2_RX0_IRQHandler(void)
+{
+  Scheduler_IrqRun(CAN2_RX0_IRQn);
+}
+
+void CAN2_RX1_IRQHandler(void)
+{
+  Scheduler_IrqRun(CAN2_RX1_IRQn);
+}
+
+uint32_t Scheduler_Lock(void)
+{
+  uint32_t PrevLock = __get_BASEPRI();
+
+  __set_BASEPRI_MAX(SCHEDULER_PRIO_HIGHEST << (8U - __NVIC_PRIO_BITS));   // Only raises the mask, i.e. nested locks are ok
+  return PrevLock;
+}
+
+void Scheduler_Unlock(uint32_t PrevLock)
+{
+  __set_BASEPRI(PrevLock);
+}
+
+void Scheduler_MailboxWrite(Scheduler_Mailbox *Mailbox, const void *Data)
+{
+  uint8_t Latest = Mailbox->Latest;
+  uint8_t Reading = Mailbox->Reading;
+  uint8_t Indx = 0;
+
+  // A reader that starts now picks Latest, which is not touched. If a read of an older buffer is ongoing, avoid that one too.
+  while ((Indx == Latest) || (Indx == Reading))
+  {
+    Indx++;
+  }
+  memcpy(&Mailbox->Buffer[Indx * Mailbox->Size], Data, Mailbox->Size);
+  __DMB();
+  Mailbox->Latest = Indx;                     // Publish
+}
+
+void Scheduler_MailboxRead(Scheduler_Mailbox *Mailbox, void *Data)
+{
+  uint8_t Indx;
+
+  do                                          // Claim the latest buffer. Retry if the writer published a new one meanwhile,
+  {                                           // since it may have chosen the buffer that was just claimed.
+    Indx = Mailbox->Latest;
+    Mailbox->Reading = Indx;
+    __DMB();
+  } while (Indx != Mailbox->Latest);
+
+  memcpy(Data, &Mailbox->Buffer[Indx * Mailbox->Size], Mailbox->Size);
+  Mailbox->Reading = SCHEDULER_MAILBOX_NO_BUFFER;
+}
+
+const char *Scheduler_TaskName(uint16_t TaskIndx)
+{
+  return (TaskIndx < Scheduler_NumTasks) ? Scheduler_Tasks[TaskIndx].Name : NULL;
+}
+
+uint16_t Scheduler_ReadStat(uint16_t Indx)
+{
+  const Scheduler_Task *Task;
+  uint32_t Value;
+
+  if (Indx >= Scheduler_NumTasks * SCHEDULER_NUM_STATS)
+  {
+    return 0;
+  }
+  Task = &Scheduler_Tasks[Indx / SCHEDULER_NUM_STATS];
+
+  switch (Indx % SCHEDULER_NUM_STATS)
+  {
+  case SCHEDULER_STAT_ACTIVATIONS:
+    return (uint16_t)Task->Activations;
+  case SCHEDULER_STAT_MISSED:
+    Value = Task->Missed;
+    break;
+  case SCHEDULER_STAT_BUDGET_OVERRUNS:
+    Value = Task->BudgetOverruns;
+    break;
+  case SCHEDULER_STAT_EXEC_TIME:
+    Value = Task->ExecTime;
+    break;
+  case SCHEDULER_STAT_EXEC_TIME_MAX:
+    Value = Task->ExecTimeMax;
+    break;
+  case SCHEDULER_STAT_JITTER_MAX:
+    Value = Task->StartJitterMax;
+    break;
+  case SCHEDULER_STAT_CPU_LOAD:
+    Value = Task->CpuLoad;
+    break;
+  default:
+    Value = 0;
+    break;
+  }
+  return (uint16_t)Util_Min(Value, 0xFFFFU);
+}
+
+static uint32_t Scheduler_Gcd(uint32_t a, uint32_t b)
+{
+  uint32_t Temp;
+
+  while (b != 0)
+  {
+    Temp = a % b;
+    a = b;
+    b = Temp;
+  }
+  return a;
+}
+
+// Least common multiple of the periods, i.e. the release pattern repeats after this number of ticks
+static uint32_t Scheduler_HyperPeriod(void)
+{
+  const Scheduler_Task *Task;
+  uint32_t HyperPeriod = 1;
+
+  for (Task = Scheduler_Tasks; Task < Scheduler_Tasks + Scheduler_NumTasks; Task++)
+  {
+    HyperPeriod = HyperPeriod / Scheduler_Gcd(HyperPeriod, Task->PeriodMs) * Task->PeriodMs;
+    if (HyperPeriod > MAX_HYPER_PERIOD)
+    {
+      return MAX_HYPER_PERIOD;
+    }
+  }
+  return HyperPeriod;
+}
+
+uint32_t Scheduler_PeakTickDemand(bool UseOffsets, uint32_t *PeakTick)
+{
+  const Scheduler_Task *Task;
+  uint32_t HyperPeriod = Scheduler_HyperPeriod();
+  uint32_t Tick, Offset, Demand;
+  uint32_t PeakDemand = 0;
+
+  *PeakTick = 0;
+  for (Tick = 0; Tick < HyperPeriod; Tick++)
+  {
+    Demand = 0;
+    for (Task = Scheduler_Tasks; Task < Scheduler_Tasks + Scheduler_NumTasks; Task++)
+    {
+      Offset = UseOffsets ? Task->OffsetMs : 0;
+      if (Tick % Task->PeriodMs == Offset)
+      {
+        Demand += Task->ExecTimeMax;
+      }
+    }
+    if (Demand > PeakDemand)
+    {
+      PeakDemand = Demand;
+      *PeakTick = Tick;
+    }
+  }
+  return PeakDemand;
+}
+
+// Print the task statistics to Terminal
+void Scheduler_PrintStats(void)
+{
+  const Scheduler_Task *Task;
+  uint32_t PeakDemand, PeakTick;
+  uint32_t PeakDemandNoOffsets, PeakTickNoOffsets;
+
+  UART_PRINTF("Task        Count  Missed  Overruns  Exec[us]  ExecMax[us]  JitterMax[us]  Load[%%]\r\n");
+  for (Task = Scheduler_Tasks; Task < Scheduler_Tasks + Scheduler_NumTasks; Task++)
+  {
+    UART_PRINTF("%-10s %6lu %7lu %9lu %9lu %12lu %14lu %6u.%u\r\n", Task->Name, Task->Activations, Task->Missed, Task->BudgetOverruns,
+                Task->ExecTime, Task->ExecTimeMax, Task->StartJitterMax, Task->CpuLoad / 10, Task->CpuLoad % 10);
+  }
+  UART_PRINTF("CPU load: %u.%u %% (rate groups + interrupts)\r\n", Scheduler_TotalLoad / 10, Scheduler_TotalLoad % 10);
+
+  PeakDemand = Scheduler_PeakTickDemand(TRUE, &PeakTick);
+  PeakDemandNoOffsets = Scheduler_PeakTickDemand(FALSE, &PeakTickNoOffsets);
+  UART_PRINTF("Worst case demand per tick: %lu us at tick %lu (without offsets: %lu us at tick %lu)\r\n",
+              PeakDemand, PeakTick, PeakDemandNoOffsets, PeakTickNoOffsets);
+}
@@ -0,0 +1,435 @@
+/**
+******************************************************************************
+* @file    /Src/Shell.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Command shell on the Terminal. The USART3 IDLE interrupt posts an event when characters have arrived, the event
+*          starts a background job that edits the line and executes the command in steps. Nothing is done in the rate
+*          groups, and a command that prints a lot (signals, statistics) is split so no step takes long.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ProjectDefs.h"
+#include "Shell.h"
+#include "Uart.h"
+#include "BgJob.h"
+#include "EventQueue.h"
+#include "Scheduler.h"
+#include "FlashE2p.h"
+#include "ExportedSignals.h"
+#include "TicToc.h"
+#include "IrqMon.h"
+#include "MemMon.h"
+#include "Trace.h"
+#include "Util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHELL_PROMPT           "> "
+#define SHELL_SIGNALS_PER_LINE 8
+
+#define SHELL_CTRL_C     0x03
+#define SHELL_BACKSPACE  0x08
+#define SHELL_ESCAPE     0x1B
+#define SHELL_DELETE     0x7F
+
+static bool Shell_Help(uint8_t Argc, char *Argv[], uint32_t *State);
+static bool Shell_Get(uint8_t Argc, char *Argv[], uint32_t *State);
+static bool Shell_Set(uint8_t Argc, char *Argv[], uint32_t *State);
+static bool Shell_Params(uint8_t Argc, char *Argv[], uint32_t *State);
+static bool Shell_Signals(uint8_t Argc, char *Argv[], uint32_t *State);
+static bool Shell_Stats(uint8_t Argc, char *Argv[], uint32_t *State);
+static bool Shell_Prof(uint8_t Argc, char *Argv[], uint32_t *State);
+#ifdef TRACE
+static bool Shell_Trace(uint8_t Argc, char *Argv[], uint32_t *State);
+#endif
+
+static const Shell_Command Shell_Commands[] =
+{
+  //            Name       Arguments                 Help                                                  Function
+  SHELL_COMMAND("help",    "",                       "List the commands",                                  Shell_Help),
+  SHELL_COMMAND("get",     "<param>",                "Read a parameter",                                   Shell_Get),
+  SHELL_COMMAND("set",     "<param> <value>",        "Write a parameter, it is saved to flash within 0.5 s", Shell_Set),
+  SHELL_COMMAND("params",  "",                       "List all parameters",                                Shell_Params),
+  SHELL_COMMAND("signals", "[first] [count]",        "Dump the exported signals (as read by Modbus)",      Shell_Signals),
+  SHELL_COMMAND("stats",   "",                       "Scheduler, event queue and background job statistics", Shell_Stats),
+  SHELL_COMMAND("prof",    "[reset]",                "Profiler, interrupt and memory statistics",          Shell_Prof),
+#ifdef TRACE
+  SHELL_COMMAND("trace",   "on|off|trigger [data]",  "Start or stop the trace recorder, or mark a point in it", Shell_Trace),
+#endif
+};
+#define SHELL_NUM_COMMANDS  (sizeof(Shell_Commands) / sizeof(Shell_Commands[0]))
+
+static char Shell_Line[SHELL_LINE_LEN];
+static uint8_t Shell_LineLen = 0;
+static uint8_t Shell_PrevByte = 0;
+static bool Shell_InEscape = FALSE;     // Skipping an escape sequence, e.g. the arrow keys
+
+static const Shell_Command *Shell_Running = NULL;
+static uint8_t Shell_Argc;
+static char *Shell_Argv[SHELL_MAX_ARGS];
+static uint32_t Shell_CmdState;
+
+static uint8_t Shell_Step(BgJob *Job);
+
+static BgJob Shell_Job = BGJOB("Shell", Shell_Step, NULL, NULL);
+
+
+static void Shell_Write(const char *Text)
+{
+  (void)Uart_WriteTerminal((const uint8_t *)Text, (uint16_t)strlen(Text));
+}
+
+// Decimal, or hex with 0x. Returns FALSE if Text is not a number or out of range.
+static bool Shell_ParseInt(const char *Text, int32_t Min, int32_t Max, int32_t *Value)
+{
+  char *End;
+  long Parsed = strtol(Text, &End, 0);
+
+  if ((End == Text) || (*End != '\0') || (Parsed < Min) || (Parsed > Max))
+  {
+    return FALSE;
+  }
+  *Value = (int32_t)Parsed;
+  return TRUE;
+}
+
+static bool Shell_Help(uint8_t Argc, char *Argv[], uint32_t *State)
+{
+  const Shell_Command *Command = &Shell_Commands[*State];
+
+  UART_PRINTF("%-8s %-22s %s\r\n", Command->Name, Command->Args, Command->Help);
+  return ++(*State) >= SHELL_NUM_COMMANDS;
+}
+
+static void Shell_PrintParameter(tE2Index Index)
+{
+  UART_PRINTF("E2P %u = %d  [min %d, max %d, default %d]%s\r\n", Index, FlashE2p_ReadMirror(Index),
+              FlashE2p_GetMinVal(Index), FlashE2p_GetMaxVal(Index), E2p_GetDefaultVal(Index),
+              FlashE2p_ReadSynchBit(Index) ? "" : " not saved yet");
+}
+
+static bool Shell_ParseParameter(const char *Text, tE2Index *Index)
+{
+  int32_t Value;
+
+  if (!Shell_ParseInt(Text, 0, E2P_NUM_PARAMETERS - 1, &Value))
+  {
+    UART_PRINTF("No parameter %s, 0..%u\r\n", Text, E2P_NUM_PARAMETERS - 1);
+    return FALSE;
+  }
+  *Index = (tE2Index)Value;
+  return TRUE;
+}
+
+static bool Shell_Get(uint8_t Argc, char *Argv[], uint32_t *State)
+{
+  tE2Index Index;
+
+  if (Argc != 2)
+  {
+    Shell_Write("Usage: get <param>\r\n");
+  }
+  else if (Shell_ParseParameter(Argv[1], &Index))
+  {
+    Shell_PrintParameter(Index);
+  }
+  return TRUE;
+}
+
+// Modbus writes the parameters at the priority of the 4 ms rate group and FlashE2p_500ms() saves them, so the mirror
+// and its synch bit are updated with the rate groups locked
+static bool Shell_Set(uint8_t Argc, char *Argv[], uint32_t *State)
+{
+  tE2Index Index;
+  int32_t Value;
+  uint32_t Lock;
+
+  if (Argc != 3)
+  {
+    Shell_Write("Usage: set <param> <value>\r\n");
+  }
+  else if (Shell_ParseParameter(Argv[1], &Index))
+  {
+    if (!Shell_ParseInt(Argv[2], FlashE2p_GetMinVal(Index), FlashE2p_GetMaxVal(Index), &Value))
+    {
+      UART_PRINTF("Invalid value %s, %d..%d\r\n", Argv[2], FlashE2p_GetMinVal(Index), FlashE2p_GetMaxVal(Index));
+      return TRUE;
+    }
+    Lock = Scheduler_Lock();
+    FlashE2p_UpdateParameter(Index, (int16_t)Value);
+    Scheduler_Unlock(Lock);
+    Shell_PrintParameter(Index);
+  }
+  return TRUE;
+}
+
+// State is the next parameter
+static bool Shell_Params(uint8_t Argc, char *Argv[], uint32_t *State)
+{
+  Shell_PrintParameter((tE2Index)*State);
+  return ++(*State) >= E2P_NUM_PARAMETERS;
+}
+
+// State is the number of signals printed, one line per step, from the latest snapshot of Loop20ms
+static bool Shell_Signals(uint8_t Argc, char *Argv[], uint32_t *State)
+{
+  char Text[SHELL_SIGNALS_PER_LINE * 6 + 8];
+  int32_t First = 0;
+  int32_t Count = ExportedSignals_Count();
+  uint16_t Indx, End, Last;
+  int Length;
+
+  if (((Argc >= 2) && !Shell_ParseInt(Argv[1], 0, ExportedSignals_Count() - 1, &First)) ||
+      ((Argc >= 3) && !Shell_ParseInt(Argv[2], 1, ExportedSignals_Count(), &Count)))
+  {
+    UART_PRINTF("Usage: signals [first] [count], %u signals\r\n", ExportedSignals_Count());
+    return TRUE;
+  }
+  Indx = (uint16_t)(First + *State);
+  Last = (uint16_t)Util_Min(First + Count, (int32_t)ExportedSignals_Count());
+  End = Util_Min(Indx + SHELL_SIGNALS_PER_LINE, Last);
+  Length = snprintf(Text, sizeof(Text), "%4u:", Indx);
+  for ( ; Indx < End; Indx++)
+  {
+    Length += snprintf(&Text[Length], sizeof(Text) - Length, " %5u", ExportedSignals_Read(Indx));
+  }
+  *State = Indx - First;
+  UART_PRINTF("%s\r\n", Text);
+  return Indx >= Last;
+}
+
+static bool Shell_Stats(uint8_t Argc, char *Argv[], uint32_t *State)
+{
+  switch ((*State)++)
+  {
+  case 0:
+    Scheduler_PrintStats();
+    return FALSE;
+  case 1:
+    EventQueue_PrintStats();
+    return FALSE;
+  default:
+    BgJob_PrintStats();
+    return TRUE;
+  }
+}
+
+static bool Shell_Prof(uint8_t Argc, char *Argv[], uint32_t *State)
+{
+  if ((Argc >= 2) && (strcmp(Argv[1], "reset") == 0))
+  {
+#ifdef TIC_TOC
+    TicToc_Reset();
+#endif
+    Shell_Write("Profiler reset\r\n");
+    return TRUE;
+  }
+
+  switch ((*State)++)
+  {
+  case 0:
+#ifdef TIC_TOC
+    TicToc_PrintStats();
+#endif
+    return FALSE;
+  case 1:
+#ifdef IRQ_MON
+    IrqMon_PrintStats();
+#endif
+    return FALSE;
+  default:
+#ifdef MEM_MON
+    MemMon_PrintStats();
+#endif
+    return TRUE;
+  }
+}
+
+#ifdef TRACE
+// The trace ring is the recorder: trigger marks the point to look for in the capture, off freezes the records before it
+static bool Shell_Trace(uint8_t Argc, char *Argv[], uint32_t *State)
+{
+  int32_t Data = 0;
+
+  if (Argc < 2)
+  {
+    // Only the state
+  }
+  else if (strcmp(Argv[1], "on") == 0)
+  {
+    Trace_Enable(TRUE);
+  }
+  else if (strcmp(Argv[1], "off") == 0)
+  {
+    Trace_Enable(FALSE);
+  }
+  else if ((strcmp(Argv[1], "trigger") == 0) && ((Argc < 3) || Shell_ParseInt(Argv[2], 0, 0xFFFF, &Data)))
+  {
+    TRACE_RECORD(TRACE_EVENT, TRACE_EVT_SHELL_TRIGGER, (uint16_t)Data);
+  }
+  else
+  {
+    Shell_Write("Usage: trace on|off|trigger [data]\r\n");
+    return TRUE;
+  }
+  UART_PRINTF("Trace %s\r\n", Trace_Enabled() ? "on" : "off");
+  return TRUE;
+}
+#endif
+
+// Split the line into words, in place, and start the command
+static void Shell_Execute(void)
+{
+  char *Next = Shell_Line;
+  uint16_t Indx;
+
+  Shell_Line[Shell_LineLen] = '\0';
+  Shell_LineLen = 0;
+  Shell_Argc = 0;
+  while (Shell_Argc < SHELL_MAX_ARGS)
+  {
+    while (*Next == ' ')
+    {
+      Next++;
+    }
+    if (*Next == '\0')
+    {
+      break;
+    }
+    Shell_Argv[Shell_Argc++] = Next;
+    while ((*Next != ' ') && (*Next != '\0'))
+    {
+      Next++;
+    }
+    if (*Next != '\0')
+    {
+      *Next++ = '\0';
+    }
+  }
+
+  if (Shell_Argc == 0)
+  {
+    Shell_Write(SHELL_PROMPT);
+    return;
+  }
+  for (Indx = 0; Indx < SHELL_NUM_COMMANDS; Indx++)
+  {
+    if (strcmp(Shell_Argv[0], Shell_Commands[Indx].Name) == 0)
+    {
+      Shell_Running = &Shell_Commands[Indx];
+      Shell_CmdState = 0;
+      return;
+    }
+  }
+  UART_PRINTF("Unknown command %s, type help\r\n" SHELL_PROMPT, Shell_Argv[0]);
+}
+
+// Line editing of one received character
+static void Shell_Edit(uint8_t Byte)
+{
+  char Echo[2] = { (char)Byte, '\0' };
+  uint8_t PrevByte = Shell_PrevByte;
+
+  Shell_PrevByte = Byte;
+  if (Shell_InEscape)
+  {
+    Shell_InEscape = (Byte == '[') || ((Byte >= '0') && (Byte <= '9')) || (Byte == ';');   // Ends with a letter or ~
+    return;
+  }
+
+  switch (Byte)
+  {
+  case '\n':
+    if (PrevByte == '\r')           // CR LF
+    {
+      break;
+    }
+    // Fall through
+  case '\r':
+    Shell_Write("\r\n");
+    Shell_Execute();
+    break;
+
+  case SHELL_BACKSPACE:
+  case SHELL_DELETE:
+    if (Shell_LineLen > 0)
+    {
+      Shell_LineLen--;
+      Shell_Write("\b \b");
+    }
+    break;
+
+  case SHELL_CTRL_C:
+    Shell_LineLen = 0;
+    Shell_Write("^C\r\n" SHELL_PROMPT);
+    break;
+
+  case SHELL_ESCAPE:
+    Shell_InEscape = TRUE;
+    break;
+
+  default:
+    if (Byte == '\t')
+    {
+      Byte = ' ';
+      Echo[0] = ' ';
+    }
+    if ((Byte >= ' ') && (Byte < SHELL_DELETE) && (Shell_LineLen < SHELL_LINE_LEN - 1))
+    {
+      Shell_Line[Shell_LineLen++] = (char)Byte;
+      Shell_Write(Echo);
+    }
+    break;
+  }
+}
+
+// Either a step of the running command, or the characters received up to the next command. Done when all characters
+// have been read, the next IDLE interrupt starts the job again.
+static uint8_t Shell_Step(BgJob *Job)
+{
+  uint8_t Byte;
+  uint16_t Count;
+
+  if (Shell_Running != NULL)
+  {
+    if (Shell_Running->Func(Shell_Argc, Shell_Argv, &Shell_CmdState))
+    {
+      Shell_Running = NULL;
+      Shell_Write(SHELL_PROMPT);
+    }
+    return 0;
+  }
+
+  for (Count = 0; (Count < SHELL_BYTES_PER_STEP) && (Shell_Running == NULL); Count++)
+  {
+    if (Uart_Read(&TerminalPort, &Byte, 1) == 0)
+    {
+      return BGJOB_DONE;
+    }
+    Shell_Edit(Byte);
+  }
+  return 0;
+}
+
+// Main loop. If the job is running it reads the new characters too.
+static void Shell_OnRxEvent(uint32_t Data)
+{
+  (void)BgJob_Start(&Shell_Job);
+}
+
+// USART3 interrupt, priority UART_RX_IRQ_PRIO
+static void Shell_OnRxIdle(UartPort *Port)
+{
+  (void)EventQueue_Post(&EventQueue_Prio9, Shell_OnRxEvent, 0);   // If the queue is full the characters are read at the next idle
+}
+
+void Shell_Init(void)
+{
+  TerminalPort.OnRxIdle = Shell_OnRxIdle;
+  Shell_Write("\r\nShell ready, type help\r\n" SHELL_PROMPT);
+}
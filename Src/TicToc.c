@@ -4,47 +4,157 @@
 * @author  Joakim Carlsson
 * @version V1.0
 * @date    20-Jan-2017
-* @brief   Use Timer 2 to measure elapsed time.  Timer 2 is a 32-bit counter which is setup in InputCapture.c
-*
+* @brief   Profiling of code regions with the DWT cycle counter (1 cycle = 1/180 us).
+*          Place TIC(ID) and TOC(ID) around the region, see TicToc.h. Each probe keeps min/max/mean and a log2 histogram.
+*          The DWT counter is enabled in Boot_RunSync().
 *
 ******************************************************************************
 */
 
 /* Includes ------------------------------------------------------------------*/
-#include "ErrorHandler.h"
+#include <string.h>
 #include "ProjectDefs.h"
 #include "TicToc.h"
+#include "Util.h"
 #include "Uart.h"
 
 #ifdef TIC_TOC  // Complete file in the #define
 
-volatile uint32_t TicToc_Tim13IrqStart;
-volatile uint32_t TicToc_Tim13IrqEnd;
+// The statistics are updated with BASEPRI at this priority, i.e. all interrupts below the NeoPixel TIM14 interrupt (5)
+// are masked. TIM14 is not delayed, its CCR1 write has a deadline of 0.4 us. It only records its own probe, which is
+// not recorded by any other context, so it can not interrupt an update of the same probe.
+#define TICTOC_LOCK_PRIO  6U
+
+static const char * const TicToc_ProbeNames[TICTOC_NUM_PROBES] =
+{
+  "SysTick ISR",
+  "PendSV ISR",
+  "TIM13 ISR",
+  "TIM14 ISR",
+  "Modbus Serve",
+  "Modbus Reply",
+  "Interpolate",
+  "Crc16",
+  "Eth Input",
+};
+
+static TicToc_Probe TicToc_Probes[TICTOC_NUM_PROBES];
+static uint32_t TicToc_Overhead = 0;    // [cycles] of an empty TIC/TOC
+
+
+// As Scheduler_Lock(), at TICTOC_LOCK_PRIO
+static uint32_t TicToc_Lock(void)
+{
+  uint32_t PrevLock = __get_BASEPRI();
 
+  __set_BASEPRI_MAX(TICTOC_LOCK_PRIO << (8U - __NVIC_PRIO_BITS));
+  return PrevLock;
+}
 
-// Use this function to print out time measurement data for testing/debugging
-void TicToc_20ms(void)
+void TicToc_Init(void)
 {
-/*
-  uint32_t CurrTick;
-  static uint32_t LastTick = 0;
-  int32_t StrLength;
+  uint32_t Start = DWT->CYCCNT;
 
-  CurrTick = Timer2Handle.Instance->CNT;
-  StrLength = sprintf(USART3_TxBuff, "CurrTick:\t%lu, LastTick:\t%lu, Elapsed Time:\t%lu\n", CurrTick, LastTick, CurrTick-LastTick );
+  TicToc_Overhead = DWT->CYCCNT - Start;
+  TicToc_Reset();
+}
 
-//  StrLength = sprintf(USART3_TxBuff, "Tim13IrqStart:\t%lu, Tim13IrqEnd:\t%lu, Elapsed Time:\t%lu\n", 
-//              TicToc_Tim13IrqStart, TicToc_Tim13IrqEnd, TicToc_Tim13IrqEnd - TicToc_Tim13IrqStart );
+// A TIM14 measurement that is recorded during the reset may be partly kept
+void TicToc_Reset(void)
+{
+  uint32_t Lock = TicToc_Lock();
 
-  // Print to Terminal 
-  HAL_UART_DMAStop(&USART3Handle);
-  HAL_UART_Transmit_DMA(&USART3Handle, USART3_TxBuff, StrLength);
+  (void)memset(TicToc_Probes, 0, sizeof(TicToc_Probes));
+  __set_BASEPRI(Lock);
+}
 
-  LastTick = CurrTick;
-*/
+// Probes are used at all interrupt priorities, also above the Scheduler_Lock() level, thus TICTOC_LOCK_PRIO
+void TicToc_Record(TicToc_ProbeId Id, uint32_t Cycles)
+{
+  TicToc_Probe *Probe = &TicToc_Probes[Id];
+  uint32_t Bin;
+  uint32_t Lock;
+
+  Cycles = (Cycles > TicToc_Overhead) ? Cycles - TicToc_Overhead : 0;
+  Bin = (Cycles != 0) ? 31U - __CLZ(Cycles) : 0;
+  Bin = (Bin > TICTOC_HIST_MIN_LOG2) ? Bin - TICTOC_HIST_MIN_LOG2 : 0;
+
+  Lock = TicToc_Lock();
+  if ((Probe->Count == 0) || (Cycles < Probe->Min))
+  {
+    Probe->Min = Cycles;
+  }
+  Probe->Max = Util_Max(Probe->Max, Cycles);
+  Probe->Sum += Cycles;
+  Probe->Count++;
+  Probe->Hist[Util_Min(Bin, TICTOC_HIST_BINS - 1)]++;
+  __set_BASEPRI(Lock);
+}
+
+static uint32_t TicToc_Mean(const TicToc_Probe *Probe)
+{
+  return (Probe->Count != 0) ? (uint32_t)(Probe->Sum / Probe->Count) : 0;
 }
 
+uint16_t TicToc_ReadStat(uint16_t Indx)
+{
+  const TicToc_Probe *Probe;
+  uint32_t Stat;
+
+  if (Indx >= TICTOC_NUM_PROBES * TICTOC_NUM_STATS)
+  {
+    return 0;
+  }
+  Probe = &TicToc_Probes[Indx / TICTOC_NUM_STATS];
+  Stat = Indx % TICTOC_NUM_STATS;
+
+  switch (Stat)
+  {
+  case TICTOC_STAT_COUNT:
+    return (uint16_t)Probe->Count;
+  case TICTOC_STAT_MIN_H:
+    return (uint16_t)(Probe->Min >> 16);
+  case TICTOC_STAT_MIN_L:
+    return (uint16_t)Probe->Min;
+  case TICTOC_STAT_MAX_H:
+    return (uint16_t)(Probe->Max >> 16);
+  case TICTOC_STAT_MAX_L:
+    return (uint16_t)Probe->Max;
+  case TICTOC_STAT_MEAN_H:
+    return (uint16_t)(TicToc_Mean(Probe) >> 16);
+  case TICTOC_STAT_MEAN_L:
+    return (uint16_t)TicToc_Mean(Probe);
+  default:
+    return (uint16_t)Util_Min(Probe->Hist[Stat - TICTOC_STAT_HIST], 0xFFFFU);
+  }
+}
 
+// Print the probe statistics to Terminal. Histogram bin n counts times from 2^(n + TICTOC_HIST_MIN_LOG2) cycles.
+void TicToc_PrintStats(void)
+{
+  const TicToc_Probe *Probe;
+  uint32_t Id, Bin;
 
+  UART_PRINTF("\r\nProbe            Count    Min[cyc]   Mean[cyc]    Max[cyc]  (overhead %lu cyc, %lu MHz)\r\n",
+              TicToc_Overhead, SystemCoreClock / 1000000U);
+  for (Id = 0; Id < TICTOC_NUM_PROBES; Id++)
+  {
+    Probe = &TicToc_Probes[Id];
+    if (Probe->Count == 0)
+    {
+      continue;
+    }
+    UART_PRINTF("%-12s %9lu %11lu %11lu %11lu\r\n  log2:", TicToc_ProbeNames[Id], Probe->Count, Probe->Min,
+                TicToc_Mean(Probe), Probe->Max);
+    for (Bin = 0; Bin < TICTOC_HIST_BINS; Bin++)
+    {
+      if (Probe->Hist[Bin] != 0)
+      {
+        UART_PRINTF(" %lu:%lu", Bin + TICTOC_HIST_MIN_LOG2, Probe->Hist[Bin]);
+      }
+    }
+    UART_PRINTF("\r\n");
+  }
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,148 @@
+/**
+******************************************************************************
+* @file    /Src/Trace.c
+* @author  Joakim Carlsson
+* @version V1.0
+* @date    16-Oct-2026
+* @brief   Binary event trace. Task start/stop, interrupt entry/exit, user events and log messages are stored as 8 byte records,
+*          timestamped with the DWT cycle counter, in a RAM ring. The ring is streamed on the Terminal by DMA, directly
+*          from the ring, in the gaps between the text transmissions (chained by the Terminal DMA interrupt in Uart.c).
+*          Adding a record takes a few cycles with interrupts disabled, no formatting is done on target.
+*
+******************************************************************************
+*/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ProjectDefs.h"
+#include "Trace.h"
+#include "Scheduler.h"
+#include "IrqMon.h"
+#include "Util.h"
+#include "Uart.h"
+
+#ifdef TRACE  // Complete file in the #define
+
+#define TRACE_RING_MASK  (TRACE_RING_SIZE - 1)
+
+static const char * const Trace_EventNames[TRACE_NUM_EVENTS] =
+{
+  "Modbus request",
+  "Radio silence",
+  "BgJob done",
+  "Shell trigger",
+};
+
+static Trace_Record Trace_Ring[TRACE_RING_SIZE];
+static volatile uint16_t Trace_Head = 0;        // Free running, next record to write
+static volatile uint16_t Trace_Tail = 0;        // Free running, first record not yet transmitted
+static uint16_t Trace_InFlight = 0;             // Records in the DMA transfer that is running
+static uint16_t Trace_Lost = 0;
+static volatile bool Trace_On = TRUE;
+
+extern const char __start_log_fmt[] __attribute__((weak));   // Linker: start of the section with the LOG() format strings
+
+
+// Call with interrupts disabled
+static void Trace_Put(Trace_Type Type, uint8_t Id, uint16_t Data, uint32_t Timestamp)
+{
+  Trace_Record *Record = &Trace_Ring[Trace_Head++ & TRACE_RING_MASK];
+
+  Record->Type = TRACE_RECORD_MARK | Type;
+  Record->Id = Id;
+  Record->Data = Data;
+  Record->Timestamp = Timestamp;
+}
+
+// Returns TRUE if there is room for Count records. One slot is kept free for the TRACE_LOST record, which is added first
+// when records have been lost. Call with interrupts disabled.
+static bool Trace_Reserve(uint16_t Count)
+{
+  if ((uint16_t)(Trace_Head - Trace_Tail) + Count >= TRACE_RING_SIZE)
+  {
+    Trace_Lost += Count;
+    return FALSE;
+  }
+  if (Trace_Lost != 0)
+  {
+    Trace_Put(TRACE_LOST, 0, Trace_Lost, DWT->CYCCNT);
+    Trace_Lost = 0;
+  }
+  return TRUE;
+}
+
+void Trace_Add(Trace_Type Type, uint8_t Id, uint16_t Data)
+{
+  uint32_t Primask = __get_PRIMASK();
+
+  __disable_irq();                      // Records are added from all priorities
+  if (Trace_On && Trace_Reserve(1))
+  {
+    Trace_Put(Type, Id, Data, DWT->CYCCNT);
+  }
+  __set_PRIMASK(Primask);
+}
+
+void Trace_AddLog(const char *Fmt, uint8_t NumArgs, const uint32_t *Args)
+{
+  uint8_t Indx;
+  uint32_t Primask = __get_PRIMASK();
+
+  __disable_irq();
+  if (Trace_On && Trace_Reserve(1 + NumArgs))
+  {
+    Trace_Put(TRACE_LOG, NumArgs, (uint16_t)(Fmt - __start_log_fmt), DWT->CYCCNT);
+    for (Indx = 0; Indx < NumArgs; Indx++)
+    {
+      Trace_Put(TRACE_LOG_ARG, Indx, 0, Args[Indx]);
+    }
+  }
+  __set_PRIMASK(Primask);
+}
+
+void Trace_Enable(bool Enable)
+{
+  Trace_On = Enable;
+}
+
+bool Trace_Enabled(void)
+{
+  return Trace_On;
+}
+
+uint16_t Trace_NextBlock(const uint8_t **Data)
+{
+  // One contiguous block, up to the end of the ring
+  Trace_InFlight = Util_Min((uint16_t)(Trace_Head - Trace_Tail), TRACE_RING_SIZE - (Trace_Tail & TRACE_RING_MASK));
+  *Data = (const uint8_t *)&Trace_Ring[Trace_Tail & TRACE_RING_MASK];
+  return Trace_InFlight * sizeof(Trace_Record);
+}
+
+void Trace_BlockSent(void)
+{
+  Trace_Tail += Trace_InFlight;         // The producers may reuse it
+  Trace_InFlight = 0;
+}
+
+void Trace_PrintNames(void)
+{
+  const char *Name;
+  uint16_t Indx;
+
+  UART_PRINTF("#trace F %lu\r\n", SystemCoreClock);
+  for (Indx = 0; (Name = Scheduler_TaskName(Indx)) != NULL; Indx++)
+  {
+    UART_PRINTF("#trace T %u %s\r\n", Indx, Name);
+  }
+#ifdef IRQ_MON
+  for (Indx = 0; Indx < IRQMON_NUM_IRQS; Indx++)
+  {
+    UART_PRINTF("#trace I %u %s\r\n", Indx, IrqMon_Irqs[Indx].Name);
+  }
+#endif
+  for (Indx = 0; Indx < TRACE_NUM_EVENTS; Indx++)
+  {
+    UART_PRINTF("#trace E %u %s\r\n", Indx, Trace_EventNames[Indx]);
+  }
+}
+
+#endif
@@ -4,13 +4,16 @@
 * @author  Joakim Carlsson
 * @version V1.0
 * @date    14-Jan-2017
-* @brief   USART3 Tx is setup and configured with DMA
-* To print message do the following:
-* Use sprintf to format text and put it in USART3_TxBuff (respect the size of the buffer USART3_BUFF_SIZE)
-* Then call HAL_UART_Transmit_DMA with uarthandle, TxBuff and length of message
+* @brief   UART driver with DMA on both Rx and Tx. The ports are rows of Uart_Configs: USART3 (Terminal) and USART6
+* (Modbus). Another port, e.g. an RS-485 link, is a row with its pins, DMA streams and buffers, and a line of
+* UART_IRQ_HANDLERS. The owner of a port is told of received frames and completed transmissions by its callbacks.
+* Transmission is scatter-gather: descriptors of buffers owned by the caller are queued and sent back to back by DMA,
+* without copies (Uart_Send, Uart_SendTerminal).
+* To print to the Terminal use UART_PRINTF, with the arguments of printf. The text is formatted on the stack of the
+* caller and copied to the Terminal Tx ring (USART3_TxBuff). The transfer is started at once when the Terminal is idle,
+* otherwise the DMA transfer complete interrupt chains it after the running one. No caller waits for the UART.
 * Example:
-* StrLength = sprintf(USART3_TxBuff, "\n\r UART Sprintf Example: Buffer is printed to the UART using DMA. Print %ld\n\r", number);
-* HAL_UART_Transmit_DMA(&USART3Handle, USART3_TxBuff, StrLength);
+* UART_PRINTF("\n\r UART printf Example: Buffer is printed to the UART using DMA. Print %ld\n\r", number);
 ******************************************************************************
 */
 
@@ -18,13 +21,20 @@
 #include "ErrorHandler.h"
 #include "ProjectDefs.h"
 #include "Uart.h"
+#include "Scheduler.h"
+#include "Trace.h"
+#include "Util.h"
 
 
-/* UART handler declaration */
-
-/* Buffers */
+/* Ports ---------------------------------------------------------------------*/
 #define USART6_BUFF_SIZE  512
 
+#ifdef TRACE
+#define UART_TERMINAL_BAUD_RATE  TRACE_BAUD_RATE
+#else
+#define UART_TERMINAL_BAUD_RATE  115200
+#endif
+
 uint8_t USART3_TxBuff[USART3_BUFF_SIZE] = { 0 };
 uint8_t USART3_RxBuff[USART3_BUFF_SIZE] = { 0 };
 
@@ -34,7 +44,47 @@ uint8_t USART6_RxBuff[USART6_BUFF_SIZE] = { 0 };
 UartPort ModbusPort;
 UartPort TerminalPort;
 
-static void Uart_InitHW(void);
+// All ports, initialized by Uart_Init(). A new port also needs its interrupt handlers, see UART_IRQ_HANDLERS below.
+static const Uart_Config Uart_Configs[] =
+{
+  { // Modbus: USART6, Rx on PG9, Tx on PG14
+    .Port = &ModbusPort, .Usart = USART6, .UsartIrq = USART6_IRQn,
+    .BaudRate = 9600, .Parity = UART_PARITY_NONE, .StopBits = UART_STOPBITS_1,
+    .DmaRx = DMA2_Stream1, .DmaRxChannel = DMA_CHANNEL_5, .DmaRxIrq = DMA2_Stream1_IRQn,
+    .DmaTx = DMA2_Stream7, .DmaTxChannel = DMA_CHANNEL_5, .DmaTxIrq = DMA2_Stream7_IRQn,
+    .GpioPort = GPIOG, .GpioPins = GPIO_PIN_9 | GPIO_PIN_14, .GpioMode = GPIO_MODE_AF_PP, .GpioAlternate = GPIO_AF8_USART6,
+    .DePort = NULL, .DePin = 0,
+    .RxBuffer = USART6_RxBuff, .RxSize = USART6_BUFF_SIZE, .TxBuffer = USART6_TxBuff, .TxSize = USART6_BUFF_SIZE,
+  },
+  { // Terminal: USART3, Tx on PD8, Rx on PD9 (ST-LINK virtual COM port)
+    .Port = &TerminalPort, .Usart = USART3, .UsartIrq = USART3_IRQn,
+    .BaudRate = UART_TERMINAL_BAUD_RATE, .Parity = UART_PARITY_NONE, .StopBits = UART_STOPBITS_1,
+    .DmaRx = DMA1_Stream1, .DmaRxChannel = DMA_CHANNEL_4, .DmaRxIrq = DMA1_Stream1_IRQn,
+    .DmaTx = DMA1_Stream3, .DmaTxChannel = DMA_CHANNEL_4, .DmaTxIrq = DMA1_Stream3_IRQn,
+    .GpioPort = GPIOD, .GpioPins = GPIO_PIN_8 | GPIO_PIN_9, .GpioMode = GPIO_MODE_AF_OD, .GpioAlternate = GPIO_AF7_USART3,
+    .DePort = NULL, .DePin = 0,
+    .RxBuffer = USART3_RxBuff, .RxSize = USART3_BUFF_SIZE, .TxBuffer = USART3_TxBuff, .TxSize = USART3_BUFF_SIZE,
+  },
+};
+
+// Terminal Tx, one descriptor at a time: text of the ring TerminalPort.Tx, buffers of Uart_SendTerminal and trace
+// records. Changed with the DMA interrupt masked by Scheduler_Lock().
+static Uart_TxDesc Uart_TerminalText;                // Chunk of the ring
+#ifdef TRACE
+static Uart_TxDesc Uart_TerminalTrace;               // Block of the trace ring
+#endif
+static Uart_TxDesc *Uart_TerminalSending = NULL;     // Queued on TerminalPort, NULL when the Terminal is idle
+static Uart_TxDesc *Uart_TerminalWaitHead = NULL;    // Uart_SendTerminal, waiting for the text written before them
+static Uart_TxDesc *Uart_TerminalWaitTail = NULL;
+static bool Uart_TerminalFull = FALSE;               // Text has been dropped since the last message that fitted
+static uint32_t Uart_TerminalBytesSent = 0;          // All output, counted when queued, for the benchmark
+static uint32_t Uart_TerminalIdleCycles = 0;         // DWT cycle counter when the last transfer of a sequence completed
+
+static void Uart_TerminalTextSent(Uart_TxDesc *Desc);
+#ifdef TRACE
+static void Uart_TerminalTraceSent(Uart_TxDesc *Desc);
+#endif
+static void Uart_TerminalTxDone(UartPort *Port);
 
 static void DMA_ClearAllFlags(DMA_Stream_TypeDef *DmaStream)
 {
@@ -87,208 +137,377 @@ static void DMA_ClearAllFlags(DMA_Stream_TypeDef *DmaStream)
 
 void Uart_Init(void)
 {
-  /*##-1- Configure the U(S)ART peripheral ######################################*/
-  /* Put the USART peripheral in the Asynchronous mode (UART Mode) */
-  /*
-  USART3Handle.Instance = USART3;
-  USART3Handle.Init.BaudRate = 115200;
-  USART3Handle.Init.WordLength = UART_WORDLENGTH_8B;
-  USART3Handle.Init.StopBits = UART_STOPBITS_1;
-  USART3Handle.Init.Parity = UART_PARITY_NONE; //UART_PARITY_ODD;
-  USART3Handle.Init.HwFlowCtl = UART_HWCONTROL_NONE;
-  USART3Handle.Init.Mode = UART_MODE_TX_RX;
-  USART3Handle.Init.OverSampling = UART_OVERSAMPLING_16;
-  */
-  ModbusPort.Rx.Buffer = USART6_RxBuff;
-  ModbusPort.Rx.Size = USART6_BUFF_SIZE;
-  ModbusPort.Tx.Buffer = USART6_TxBuff;
-  ModbusPort.Tx.Size = USART6_BUFF_SIZE;
-
-  TerminalPort.Rx.Buffer = USART3_RxBuff;
-  TerminalPort.Rx.Size = USART3_BUFF_SIZE;
-  TerminalPort.Tx.Buffer = USART3_TxBuff;
-  TerminalPort.Tx.Size = USART3_BUFF_SIZE;
-
-  Uart_InitHW();
-  
-  //(void)HAL_HalfDuplex_Init(&USART3Handle);
+  uint16_t Indx;
 
+  for (Indx = 0; Indx < sizeof(Uart_Configs) / sizeof(Uart_Configs[0]); Indx++)
+  {
+    Uart_InitPort(&Uart_Configs[Indx]);
+  }
+  Uart_TerminalText.OnSent = Uart_TerminalTextSent;
+#ifdef TRACE
+  Uart_TerminalTrace.OnSent = Uart_TerminalTraceSent;
+#endif
+  TerminalPort.OnTxDmaDone = Uart_TerminalTxDone;
+}
+
+static void Uart_EnableClocks(const Uart_Config *Config)
+{
+  switch ((uint32_t)Config->Usart)
+  {
+  case (uint32_t)USART1: __HAL_RCC_USART1_CLK_ENABLE(); break;
+  case (uint32_t)USART2: __HAL_RCC_USART2_CLK_ENABLE(); break;
+  case (uint32_t)USART3: __HAL_RCC_USART3_CLK_ENABLE(); break;
+  case (uint32_t)UART4:  __HAL_RCC_UART4_CLK_ENABLE();  break;
+  case (uint32_t)UART5:  __HAL_RCC_UART5_CLK_ENABLE();  break;
+  case (uint32_t)USART6: __HAL_RCC_USART6_CLK_ENABLE(); break;
+  default: Error_Handler(); break;
+  }
+
+  switch ((uint32_t)Config->GpioPort)
+  {
+  case (uint32_t)GPIOA: __HAL_RCC_GPIOA_CLK_ENABLE(); break;
+  case (uint32_t)GPIOB: __HAL_RCC_GPIOB_CLK_ENABLE(); break;
+  case (uint32_t)GPIOC: __HAL_RCC_GPIOC_CLK_ENABLE(); break;
+  case (uint32_t)GPIOD: __HAL_RCC_GPIOD_CLK_ENABLE(); break;
+  case (uint32_t)GPIOE: __HAL_RCC_GPIOE_CLK_ENABLE(); break;
+  case (uint32_t)GPIOG: __HAL_RCC_GPIOG_CLK_ENABLE(); break;
+  default: Error_Handler(); break;
+  }
+
+  if (Config->DmaRx >= DMA2_Stream0)
+  {
+    __HAL_RCC_DMA2_CLK_ENABLE();
+  }
+  else
+  {
+    __HAL_RCC_DMA1_CLK_ENABLE();
+  }
+  if (Config->DmaTx >= DMA2_Stream0)
+  {
+    __HAL_RCC_DMA2_CLK_ENABLE();
+  }
+  else
+  {
+    __HAL_RCC_DMA1_CLK_ENABLE();
+  }
+}
+
+// USART1 and USART6 are on APB2, the others on APB1
+static uint32_t Uart_PclkFreq(const UartPort *Port)
+{
+  return ((Port->Usart == USART1) || (Port->Usart == USART6)) ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+}
+
+void Uart_SetBaudRate(UartPort *Port, uint32_t BaudRate)
+{
+  Port->Usart->BRR = UART_BRR_SAMPLING16(Uart_PclkFreq(Port), BaudRate);
+}
+
+uint32_t Uart_GetBaudRate(const UartPort *Port)
+{
+  return Uart_PclkFreq(Port) / Port->Usart->BRR;
+}
+
+uint16_t Uart_CharBits(const UartPort *Port)
+{
+  return 10U + ((Port->Config->Parity != UART_PARITY_NONE) ? 1U : 0U) + ((Port->Config->StopBits == UART_STOPBITS_2) ? 1U : 0U);
 }
 
 /**
-*        This function configures the hardware resources needed for the UART:
+*        Configures the hardware resources of a port and starts its receiver:
 *           - Peripheral's clock enable
 *           - Peripheral's GPIO Configuration
 *           - USART configuration
 *           - DMA configuration for Tx and Rx
 */
-static void Uart_InitHW(void)
+void Uart_InitPort(const Uart_Config *Config)
 {
+  UartPort *Port = Config->Port;
   GPIO_InitTypeDef  GPIO_InitStruct;
 
-  static DMA_HandleTypeDef  hdmatx_usart3, hdmarx_usart3;
-
-  /*##-1- Enable peripherals and GPIO Clocks #################################*/
-  /* Enable GPIO TX/RX clock */
-  __HAL_RCC_GPIOD_CLK_ENABLE();
-  __HAL_RCC_GPIOG_CLK_ENABLE();
-
-  /* Enable USARTx clock */
-  __HAL_RCC_USART3_CLK_ENABLE();
-  __HAL_RCC_USART6_CLK_ENABLE();
+  Port->Config = Config;
+  Port->Usart = Config->Usart;
+  Port->DMAStream_Rx = Config->DmaRx;
+  Port->DMAStream_Tx = Config->DmaTx;
+  Port->Rx.Buffer = Config->RxBuffer;
+  Port->Rx.Size = Config->RxSize;
+  Port->Tx.Buffer = Config->TxBuffer;
+  Port->Tx.Size = Config->TxSize;
 
-  /* Enable DMA1 clock for USART3 and DMA2 clock for USART6 */
-  __HAL_RCC_DMA1_CLK_ENABLE();
-  __HAL_RCC_DMA2_CLK_ENABLE();
+  //##-1- Enable peripherals and GPIO Clocks #################################
+  Uart_EnableClocks(Config);
 
-  
   //##-2- Configure peripheral GPIO ##########################################
-  // USART3 TX/RX GPIO pin configuration. TX on Pin 8 and RX on Pin 9.
-  GPIO_InitStruct.Mode = GPIO_MODE_AF_OD;
+  GPIO_InitStruct.Mode = Config->GpioMode;
   GPIO_InitStruct.Pull = GPIO_PULLUP;
   GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
-  GPIO_InitStruct.Alternate = GPIO_AF7_USART3;
-  GPIO_InitStruct.Pin = GPIO_PIN_8 |  GPIO_PIN_9;
-  HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
-
-  // USART6 TX GPIO pin configuration. TX on Pin 14 and RX on Pin 9.
-  GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
-  GPIO_InitStruct.Pull = GPIO_PULLUP;
-  GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
-  GPIO_InitStruct.Alternate = GPIO_AF8_USART6;
-  GPIO_InitStruct.Pin = GPIO_PIN_9 | GPIO_PIN_14;
-  HAL_GPIO_Init(GPIOG, &GPIO_InitStruct);
-
-  //##-3- Configure ModbusPort: USART 6, Rx using DMA2 Stream 1 (channel 5) and Tx using DMA2 Stream 7 (channel 5) ##
-  uint32_t BaudRate = 9600;
+  GPIO_InitStruct.Alternate = Config->GpioAlternate;
+  GPIO_InitStruct.Pin = Config->GpioPins;
+  HAL_GPIO_Init(Config->GpioPort, &GPIO_InitStruct);
 
-  ModbusPort.Usart = USART6;
-  ModbusPort.DMAStream_Rx = DMA2_Stream1;
-  ModbusPort.DMAStream_Tx = DMA2_Stream7;
+  if (Config->DePort != NULL)       // RS-485 driver enable, its GPIO clock is enabled by the board setup
+  {
+    HAL_GPIO_WritePin(Config->DePort, Config->DePin, GPIO_PIN_RESET);
+    GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Alternate = 0;
+    GPIO_InitStruct.Pin = Config->DePin;
+    HAL_GPIO_Init(Config->DePort, &GPIO_InitStruct);
+  }
 
-  ModbusPort.Usart->BRR = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK2Freq(), BaudRate);  // USART6 uses APB2 bus
-  ModbusPort.Usart->CR2 = 0x0;
-  ModbusPort.Usart->CR3 = USART_CR3_DMAR;
-  ModbusPort.Usart->CR1 = USART_CR1_UE | USART_CR1_RE; /* | USART_CR1_TE */
+  //##-3- Configure the USART ################################################
+  Port->Usart->CR1 = 0x0;
+  Uart_SetBaudRate(Port, Config->BaudRate);
+  Port->Usart->CR2 = Config->StopBits;
+  Port->Usart->CR3 = USART_CR3_DMAR;
+  // The parity bit is the MSB of the word, so 8 data bits with parity is a 9 bit word
+  Port->Usart->CR1 = USART_CR1_UE | Config->Parity | ((Config->Parity != UART_PARITY_NONE) ? USART_CR1_M : 0U);
   // Reg. GTPR  Keep at reset val
 
+  //##-4- Configure the DMA streams ##########################################
   // ------ Rx Stream ------
-  ModbusPort.DMAStream_Rx->CR &= ~DMA_SxCR_EN;      // Make sure stream is disabled before writing to it's registers
-  DMA_ClearAllFlags(ModbusPort.DMAStream_Rx);
-  ModbusPort.DMAStream_Rx->PAR = (uint32_t)&(ModbusPort.Usart->DR);
-  ModbusPort.DMAStream_Rx->M0AR = (uint32_t)ModbusPort.Rx.Buffer;
-  ModbusPort.DMAStream_Rx->NDTR = ModbusPort.Rx.Size;
+  Port->DMAStream_Rx->CR &= ~DMA_SxCR_EN;      // Make sure stream is disabled before writing to it's registers
+  DMA_ClearAllFlags(Port->DMAStream_Rx);
+  Port->DMAStream_Rx->PAR = (uint32_t)&(Port->Usart->DR);
+  Port->DMAStream_Rx->M0AR = (uint32_t)Port->Rx.Buffer;
+  Port->DMAStream_Rx->NDTR = Port->Rx.Size;
   // Reg. M1AR   Not used
   // Reg. FCR    Keep at reset val
-  ModbusPort.DMAStream_Rx->CR = DMA_CHANNEL_5 | DMA_PRIORITY_VERY_HIGH | DMA_MINC_ENABLE | DMA_PERIPH_TO_MEMORY /*| DMA_IT_TC | DMA_IT_TE | DMA_IT_DME*/;
-
-  ModbusPort.DMAStream_Rx->CR |= DMA_SxCR_EN;    // Enable Rx stream    
+  Port->DMAStream_Rx->CR = Config->DmaRxChannel | DMA_PRIORITY_VERY_HIGH | DMA_MINC_ENABLE | DMA_PERIPH_TO_MEMORY |
+                           DMA_CIRCULAR | DMA_IT_HT | DMA_IT_TC;
 
   // ------ Tx Stream ------
-  ModbusPort.DMAStream_Tx->CR &= ~DMA_SxCR_EN;      // Make sure stream is disabled before writing to it's registers
-  DMA_ClearAllFlags(ModbusPort.DMAStream_Tx);
-
-  ModbusPort.DMAStream_Tx->PAR = (uint32_t)&(ModbusPort.Usart->DR);
-  ModbusPort.DMAStream_Tx->M0AR = (uint32_t)ModbusPort.Tx.Buffer;
-  ModbusPort.DMAStream_Tx->NDTR = 0;
+  Port->DMAStream_Tx->CR &= ~DMA_SxCR_EN;      // Make sure stream is disabled before writing to it's registers
+  DMA_ClearAllFlags(Port->DMAStream_Tx);
+  Port->DMAStream_Tx->PAR = (uint32_t)&(Port->Usart->DR);
+  Port->DMAStream_Tx->M0AR = (uint32_t)Port->Tx.Buffer;
+  Port->DMAStream_Tx->NDTR = 0;
   // Reg. M1AR   Not used
   // Reg. FCR    Keep at reset val
-  ModbusPort.DMAStream_Tx->CR = DMA_CHANNEL_5 | DMA_PRIORITY_VERY_HIGH | DMA_MINC_ENABLE | DMA_MEMORY_TO_PERIPH;
-
+  Port->DMAStream_Tx->CR = Config->DmaTxChannel | DMA_PRIORITY_VERY_HIGH | DMA_MINC_ENABLE | DMA_MEMORY_TO_PERIPH | DMA_IT_TC;
 
-  //##-4- Configure TerminalPort: USART 3, Rx using DMA1 Stream 1 (channel 4) and Tx using DMA1 Stream 3 (channel 4) ##
-  BaudRate = 115200;
+  //##-5- Interrupts #########################################################
+  HAL_NVIC_SetPriority(Config->UsartIrq, UART_RX_IRQ_PRIO, 0U);
+  HAL_NVIC_SetPriority(Config->DmaRxIrq, UART_RX_IRQ_PRIO, 0U);
+  HAL_NVIC_SetPriority(Config->DmaTxIrq, UART_TX_IRQ_PRIO, 0U);
+  HAL_NVIC_EnableIRQ(Config->UsartIrq);
+  HAL_NVIC_EnableIRQ(Config->DmaRxIrq);
+  HAL_NVIC_EnableIRQ(Config->DmaTxIrq);
 
-  TerminalPort.Usart = USART3;
-  TerminalPort.DMAStream_Rx = DMA1_Stream1;
-  TerminalPort.DMAStream_Tx = DMA1_Stream3;
-
-  TerminalPort.Usart->BRR = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK1Freq(), BaudRate);  // USART3 uses APB2 bus ???
-  TerminalPort.Usart->CR2 = 0x0;
-  TerminalPort.Usart->CR3 = USART_CR3_DMAR;
-  TerminalPort.Usart->CR1 = USART_CR1_UE | USART_CR1_RE; /* | USART_CR1_TE */
-  // Reg. GTPR  Keep at reset val
+  Uart_StartReceiver(Port);
+}
 
-  // ------ Rx Stream ------
-  TerminalPort.DMAStream_Rx->CR &= ~DMA_SxCR_EN;      // Make sure stream is disabled before writing to it's registers
-  DMA_ClearAllFlags(TerminalPort.DMAStream_Rx);
+// Disables DMA Rx stream and Receiver
+void Uart_StopReceiver(UartPort *Port)
+{
+  Port->DMAStream_Rx->CR &= ~DMA_SxCR_EN;   
+  DMA_ClearAllFlags(Port->DMAStream_Rx);
 
-  TerminalPort.DMAStream_Rx->PAR = (uint32_t)&(TerminalPort.Usart->DR);
-  TerminalPort.DMAStream_Rx->M0AR = (uint32_t)TerminalPort.Rx.Buffer;
-  TerminalPort.DMAStream_Rx->NDTR = TerminalPort.Rx.Size;
-  // Reg. M1AR   Not used
-  // Reg. FCR    Keep at reset val
-  TerminalPort.DMAStream_Rx->CR = DMA_CHANNEL_4 | DMA_PRIORITY_VERY_HIGH | DMA_MINC_ENABLE | DMA_PERIPH_TO_MEMORY /*| DMA_IT_TC | DMA_IT_TE | DMA_IT_DME*/;
-  TerminalPort.DMAStream_Rx->CR |= DMA_SxCR_EN;    // Enable Rx stream
+  Port->Usart->CR3 &= ~USART_CR3_DMAR;
+  Port->Usart->CR1 &= ~(USART_CR1_RE | USART_CR1_IDLEIE);
+}
 
-  // ------ Tx Stream ------
-  TerminalPort.DMAStream_Tx->CR &= ~DMA_SxCR_EN;      // Make sure stream is disabled before writing to it's registers
-  DMA_ClearAllFlags(TerminalPort.DMAStream_Tx);
+// (Re)starts the Receiver and the circular DMA stream, with the Rx buffer empty
+void Uart_StartReceiver(UartPort *Port)
+{
+  Port->DMAStream_Rx->CR &= ~DMA_SxCR_EN;        // Must disable stream before writing to it's registers
+  DMA_ClearAllFlags(Port->DMAStream_Rx);
+  Port->DMAStream_Rx->NDTR = Port->Rx.Size;      // Reload to full size
 
-  TerminalPort.DMAStream_Tx->PAR = (uint32_t)&(TerminalPort.Usart->DR);
-  TerminalPort.DMAStream_Tx->M0AR = (uint32_t)TerminalPort.Tx.Buffer;
-  TerminalPort.DMAStream_Tx->NDTR = 0;
-  // Reg. M1AR   Not used
-  // Reg. FCR    Keep at reset val
-  TerminalPort.DMAStream_Tx->CR = DMA_CHANNEL_4 | DMA_PRIORITY_VERY_HIGH | DMA_MINC_ENABLE | DMA_MEMORY_TO_PERIPH;
+  Port->Rx.Indx = 0;
+  Port->Rx.Tail = 0;
+  Port->RxWritten = 0;
+  Port->RxRead = 0;
+  memset((void *)Port->RxFrameEnds, 0, sizeof(Port->RxFrameEnds));
+  Port->RxFramesIn = 0;
+  Port->RxFramesOut = 0;
+  
+  Port->Usart->CR1 |= USART_CR1_RE | USART_CR1_IDLEIE;
+  Port->Usart->CR3 |= USART_CR3_DMAR;
   
-  /*
-  hdmatx_usart3.Instance = DMA1_Stream3;
-  hdmatx_usart3.Init.Channel = DMA_CHANNEL_4;          // USART3_TX is on stream 3, channel 4
-  hdmatx_usart3.Init.Direction = DMA_MEMORY_TO_PERIPH;
-  hdmatx_usart3.Init.PeriphInc = DMA_PINC_DISABLE;
-  hdmatx_usart3.Init.MemInc = DMA_MINC_ENABLE;
-  hdmatx_usart3.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
-  //hdmatx_usart3.Init.MemDataAlignment = DMA_MDATAALIGN_WORD; // In Direct mode source and destination data widths are equal and defined by PSIZE
-  hdmatx_usart3.Init.Mode = DMA_NORMAL; //DMA_CIRCULAR;  
-  hdmatx_usart3.Init.Priority = DMA_PRIORITY_VERY_HIGH;
-  hdmatx_usart3.Init.FIFOMode = DMA_FIFOMODE_DISABLE;            // i.e. Direct mode 
-  hdmatx_usart3.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_HALFFULL; // Dont think this matters since Direct Mode is used
-  hdmatx_usart3.Init.MemBurst = DMA_MBURST_SINGLE;               // Burst transfers are not possible in Direct mode
-  hdmatx_usart3.Init.PeriphBurst = DMA_PBURST_SINGLE;
+  Port->DMAStream_Rx->CR |= DMA_SxCR_EN;        // Enable stream
+}
 
-  HAL_DMA_Init(&hdmatx_usart3);
+// Counts the bytes written by the DMA since the last call. Called from the interrupts of the port, which are at least
+// twice per lap of the buffer (HT, TC).
+static void Uart_RxUpdate(UartPort *Port)
+{
+  uint16_t Pos = Port->Rx.Size - Port->DMAStream_Rx->NDTR;    // NDTR is reloaded when it reaches 0
 
-  // Associate the initialized DMA handle to the Usart handle 
-  __HAL_LINKDMA(&USART3Handle, hdmatx, hdmatx_usart3);
-  */
+  Port->RxWritten += (uint16_t)(Pos + Port->Rx.Size - Port->Rx.Indx) % Port->Rx.Size;
+  Port->Rx.Indx = Pos;
 }
 
-// Checks if a message has been received (by testing IDLE LINE Flag) and if so returns the number of bytes received
-uint16_t Uart_MessageReceived(UartPort *Port)
+// Queue the end of a frame. When the queue is full the newest frame is extended instead.
+static void Uart_RxFrameEnd(UartPort *Port)
 {
-  uint16_t BytesReceived = 0;
+  uint8_t Newest = (uint8_t)(Port->RxFramesIn - 1U) % UART_RX_FRAMES;
 
-  if (Port->Usart->SR & USART_SR_IDLE)
+  if (Port->RxWritten == Port->RxFrameEnds[Newest])
   {
-    uint32_t TempReg = Port->Usart->DR;                    // To clear IDLE LINE FLAG
-    BytesReceived = Port->Rx.Size - Port->DMAStream_Rx->NDTR;
+    return;                                     // Idle without new bytes, e.g. when the receiver is enabled
   }
+  if ((uint8_t)(Port->RxFramesIn - Port->RxFramesOut) >= UART_RX_FRAMES)
+  {
+    Port->RxFrameEnds[Newest] = Port->RxWritten;
+  }
+  else
+  {
+    Port->RxFrameEnds[Port->RxFramesIn % UART_RX_FRAMES] = Port->RxWritten;
+    Port->RxFramesIn++;
+  }
+  if (Port->OnRxIdle != NULL)
+  {
+    Port->OnRxIdle(Port);
+  }
+}
 
-  return BytesReceived;
+// IDLE or overrun ends a frame. TC (enabled by the Tx DMA interrupt when the queue runs empty) ends a transmission:
+// the RS-485 driver is released and the owner of the port told.
+static void Uart_UsartIrq(UartPort *Port)
+{
+  uint32_t Status = Port->Usart->SR;
+
+  if (Status & (USART_SR_IDLE | USART_SR_ORE))
+  {
+    (void)Port->Usart->DR;                      // Read of SR and then DR clears the flags
+    Uart_RxUpdate(Port);
+    Uart_RxFrameEnd(Port);
+  }
+  if ((Status & USART_SR_TC) && (Port->Usart->CR1 & USART_CR1_TCIE))
+  {
+    Port->Usart->CR1 &= ~USART_CR1_TCIE;
+    if (Port->TxHead == NULL)                   // Else a gap in the queue, TCIE is set again when it runs empty
+    {
+      if (Port->Config->DePort != NULL)
+      {
+        HAL_GPIO_WritePin(Port->Config->DePort, Port->Config->DePin, GPIO_PIN_RESET);
+      }
+      if (Port->OnTxComplete != NULL)
+      {
+        Port->OnTxComplete(Port);
+      }
+    }
+  }
 }
 
-// Disables DMA Rx stream and Receiver
-void Uart_StopReceiver(UartPort *Port)
+static void Uart_RxDmaIrq(UartPort *Port)
 {
-  Port->DMAStream_Rx->CR &= ~DMA_SxCR_EN;   
   DMA_ClearAllFlags(Port->DMAStream_Rx);
+  Uart_RxUpdate(Port);
+}
 
-  Port->Usart->CR3 &= ~USART_CR3_DMAR;
-  Port->Usart->CR1 &= ~USART_CR1_RE;
+static void Uart_TxStart(UartPort *Port, const Uart_TxDesc *Desc);
+
+// The DMA has written the last byte of the first descriptor to DR, the USART still shifts out the last character.
+// The next one is started at once, it waits for TXE.
+static void Uart_TxDmaIrq(UartPort *Port)
+{
+  Uart_TxDesc *Done = Port->TxHead;
+
+  DMA_ClearAllFlags(Port->DMAStream_Tx);
+  if (Done == NULL)                             // Stopped
+  {
+    return;
+  }
+  Port->TxHead = Done->Next;
+  if (Port->TxHead != NULL)
+  {
+    Uart_TxStart(Port, Port->TxHead);
+  }
+  if (Done->OnSent != NULL)
+  {
+    Done->OnSent(Done);
+  }
+  if (Port->OnTxDmaDone != NULL)
+  {
+    Port->OnTxDmaDone(Port);
+  }
+  if ((Port->TxHead == NULL) && ((Port->OnTxComplete != NULL) || (Port->Config->DePort != NULL)))
+  {
+    Port->Usart->CR1 |= USART_CR1_TCIE;         // Interrupts at once if the last character has already left
+  }
 }
 
-// (Re)starts the Receiver and DMA stream
-void Uart_StartReceiver(UartPort *Port)
+// The interrupt handlers of a port, one line per row of Uart_Configs
+#define UART_IRQ_HANDLERS(PORT, USART_HANDLER, DMA_RX_HANDLER, DMA_TX_HANDLER) \
+  void USART_HANDLER(void)  { Uart_UsartIrq(&(PORT)); } \
+  void DMA_RX_HANDLER(void) { Uart_RxDmaIrq(&(PORT)); } \
+  void DMA_TX_HANDLER(void) { Uart_TxDmaIrq(&(PORT)); }
+
+UART_IRQ_HANDLERS(ModbusPort,   USART6_IRQHandler, DMA2_Stream1_IRQHandler, DMA2_Stream7_IRQHandler)
+UART_IRQ_HANDLERS(TerminalPort, USART3_IRQHandler, DMA1_Stream1_IRQHandler, DMA1_Stream3_IRQHandler)
+
+// Consume Bytes, copying them to Data unless it is NULL
+static void Uart_RxConsume(UartPort *Port, uint8_t *Data, uint32_t Bytes)
 {
-  Port->DMAStream_Rx->CR &= ~DMA_SxCR_EN;        // Must disable stream before writing to it's registers
-  DMA_ClearAllFlags(Port->DMAStream_Rx);
-  Port->DMAStream_Rx->NDTR = Port->Rx.Size;      // Reload to full size
-  
-  Port->Usart->CR1 |= USART_CR1_RE;
-  Port->Usart->CR3 |= USART_CR3_DMAR;
-  
-  Port->DMAStream_Rx->CR |= DMA_SxCR_EN;        // Enable stream
+  uint16_t First = Util_Min(Bytes, (uint32_t)(Port->Rx.Size - Port->Rx.Tail));
+
+  if (Data != NULL)
+  {
+    memcpy(Data, &Port->Rx.Buffer[Port->Rx.Tail], First);
+    memcpy(Data + First, Port->Rx.Buffer, Bytes - First);
+  }
+  Port->Rx.Tail = (uint16_t)((Port->Rx.Tail + Bytes) % Port->Rx.Size);
+  Port->RxRead += Bytes;
+}
+
+// TRUE if the DMA has lapped the consumer. All that is received is then discarded.
+static bool Uart_RxOverrun(UartPort *Port)
+{
+  uint32_t Written = Port->RxWritten;
+
+  if (Written - Port->RxRead > Port->Rx.Size)
+  {
+    Port->RxOverruns++;
+    Port->RxRead = Written;
+    Port->Rx.Tail = (uint16_t)(Written % Port->Rx.Size);
+    Port->RxFramesOut = Port->RxFramesIn;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+uint16_t Uart_ReadFrame(UartPort *Port, uint8_t *Data, uint16_t MaxBytes)
+{
+  uint32_t Length, Copied;
+
+  if ((Port->RxFramesOut == Port->RxFramesIn) || Uart_RxOverrun(Port))
+  {
+    return 0;
+  }
+  Length = Port->RxFrameEnds[Port->RxFramesOut % UART_RX_FRAMES] - Port->RxRead;
+  Port->RxFramesOut++;
+
+  Copied = Util_Min(Length, MaxBytes);
+  Uart_RxConsume(Port, Data, Copied);
+  Uart_RxConsume(Port, NULL, Length - Copied);   // Truncated
+  return Uart_RxOverrun(Port) ? 0 : (uint16_t)Copied;   // Overwritten while copied?
+}
+
+uint16_t Uart_Read(UartPort *Port, uint8_t *Data, uint16_t MaxBytes)
+{
+  uint32_t Copied;
+
+  if (Uart_RxOverrun(Port))
+  {
+    return 0;
+  }
+  Copied = Util_Min(Port->RxWritten - Port->RxRead, MaxBytes);
+  Uart_RxConsume(Port, Data, Copied);
+
+  // Frames read as a stream are done with
+  while ((Port->RxFramesOut != Port->RxFramesIn) &&
+         ((int32_t)(Port->RxFrameEnds[Port->RxFramesOut % UART_RX_FRAMES] - Port->RxRead) <= 0))
+  {
+    Port->RxFramesOut++;
+  }
+  return Uart_RxOverrun(Port) ? 0 : (uint16_t)Copied;
+}
+
+uint16_t Uart_RxDmaPosition(const UartPort *Port)
+{
+  return Port->Rx.Size - Port->DMAStream_Rx->NDTR;
 }
 
 // Checks if transmission of a message has finished (by testing the TC flag)
@@ -307,38 +526,85 @@ bool Uart_TransmissionComplete(UartPort *Port)
 // Disables DMA Tx stream and Transmitter
 void Uart_StopTransmitter(UartPort *Port)
 {
+  uint32_t Lock = Scheduler_Lock();
+
   Port->DMAStream_Tx->CR &= ~DMA_SxCR_EN;
   DMA_ClearAllFlags(Port->DMAStream_Tx);
+  Port->TxHead = NULL;
+  Scheduler_Unlock(Lock);
 
   Port->Usart->CR3 &= ~USART_CR3_DMAT;
-  Port->Usart->CR1 &= ~USART_CR1_TE;
+  Port->Usart->CR1 &= ~(USART_CR1_TE | USART_CR1_TCIE);
 }
 
-// (Re)starts the Transmitter and DMA stream if BytesToSend > 0
-void Uart_StartTransmitter(UartPort *Port, uint16_t BytesToSend)
+// Starts the DMA transfer of a descriptor, after the previous one
+static void Uart_TxStart(UartPort *Port, const Uart_TxDesc *Desc)
 {
-  if (BytesToSend > 0)                           // Is there anything to transmit?
+  Port->DMAStream_Tx->CR &= ~DMA_SxCR_EN;      // Must disable stream before writing to it's registers
+  DMA_ClearAllFlags(Port->DMAStream_Tx);
+  Port->DMAStream_Tx->M0AR = (uint32_t)Desc->Data;
+  Port->DMAStream_Tx->NDTR = Desc->Length;
+
+  Port->Usart->SR &= ~USART_SR_TC;             // Set again when the last character has been sent
+  if (Port->Config->DePort != NULL)
   {
-    Port->DMAStream_Tx->CR &= ~DMA_SxCR_EN;      // Must disable stream before writing to it's registers
-    DMA_ClearAllFlags(Port->DMAStream_Tx);
-    Port->DMAStream_Tx->NDTR = BytesToSend;
+    HAL_GPIO_WritePin(Port->Config->DePort, Port->Config->DePin, GPIO_PIN_SET);    // Drive the RS-485 bus
+  }
+  Port->Usart->CR1 |= USART_CR1_TE;
+  Port->Usart->CR3 |= USART_CR3_DMAT;
 
-    Port->Usart->CR1 |= USART_CR1_TE;
-    Port->Usart->CR3 |= USART_CR3_DMAT;
+  Port->DMAStream_Tx->CR |= DMA_SxCR_EN;        // Enable stream
+}
 
-    Port->DMAStream_Tx->CR |= DMA_SxCR_EN;        // Enable stream
+// Append to the queue, started at once if the transmitter is idle. Call with the Tx DMA interrupt masked.
+static void Uart_TxQueue(UartPort *Port, Uart_TxDesc *Desc)
+{
+  Desc->Next = NULL;
+  if (Port->TxHead == NULL)
+  {
+    Port->TxHead = Desc;
+    Uart_TxStart(Port, Desc);
+  }
+  else
+  {
+    Port->TxTail->Next = Desc;
   }
+  Port->TxTail = Desc;
+}
+
+void Uart_Send(UartPort *Port, Uart_TxDesc *Desc)
+{
+  uint32_t Lock;
+
+  if (Desc->Length == 0)                         // The DMA would never complete it
+  {
+    if (Desc->OnSent != NULL)
+    {
+      Desc->OnSent(Desc);
+    }
+    return;
+  }
+  Lock = Scheduler_Lock();
+  Uart_TxQueue(Port, Desc);
+  Scheduler_Unlock(Lock);
+}
+
+// Sends BytesToSend of the Tx buffer
+void Uart_StartTransmitter(UartPort *Port, uint16_t BytesToSend)
+{
+  Port->TxBufferDesc.Data = Port->Tx.Buffer;
+  Port->TxBufferDesc.Length = BytesToSend;
+  Port->TxBufferDesc.OnSent = NULL;
+  Uart_Send(Port, &Port->TxBufferDesc);
 }
 
 static void Uart_TestUart(void)
 {
-  uint16_t ByteCount =  Uart_MessageReceived(&ModbusPort);
+  uint16_t ByteCount =  Uart_ReadFrame(&ModbusPort, ModbusPort.Tx.Buffer, ModbusPort.Tx.Size);   // Echoed
   static bool TxMode = FALSE;
 
   if(ByteCount > 0)
   {
-    Uart_StopReceiver(&ModbusPort);
-
     // Check message
     Uart_PrintRegisters();
     HAL_GPIO_TogglePin(GPIOB, GPIO_PIN_14);
@@ -346,8 +612,7 @@ static void Uart_TestUart(void)
     // Print to Terminal
     for (int i = 0; i < ByteCount; i++)
     {
-      ModbusPort.Tx.Buffer[i] = ModbusPort.Rx.Buffer[i];
-      UART_PRINTF("%X", USART6_RxBuff[i]);
+      UART_PRINTF("%X", ModbusPort.Tx.Buffer[i]);
     }
     Uart_TransmitTerminalBuffer();
 
@@ -360,7 +625,6 @@ static void Uart_TestUart(void)
     {
       TxMode = FALSE;
       Uart_StopTransmitter(&ModbusPort);
-      Uart_StartReceiver(&ModbusPort);
     }
   }
 }
@@ -393,34 +657,326 @@ void Uart_PrintRegisters(void)
   UART_PRINTF("LIFCR: %X\r\n", DMA2->LIFCR);
 }
 
-// Call this function to print out the data stored in the Terminal Buffer
+static uint16_t Uart_RingUsed(const Buffer_t *Ring)
+{
+  uint16_t Tail = Ring->Tail;
+
+  return (Ring->Indx >= Tail) ? (Ring->Indx - Tail) : (Ring->Size - Tail + Ring->Indx);
+}
+
+// One byte is never used, so a full ring can be told from an empty one
+static uint16_t Uart_RingFree(const Buffer_t *Ring)
+{
+  return Ring->Size - 1U - Uart_RingUsed(Ring);
+}
+
+// Copy to the ring, wrapping at the end. Call with enough room free.
+static void Uart_RingWrite(Buffer_t *Ring, const uint8_t *Data, uint16_t Length)
+{
+  uint16_t First = Util_Min(Length, Ring->Size - Ring->Indx);
+
+  memcpy(&Ring->Buffer[Ring->Indx], Data, First);
+  memcpy(Ring->Buffer, Data + First, Length - First);
+  Ring->Indx = (Ring->Indx + Length) % Ring->Size;
+}
+
+// Queues the next descriptor: the text up to the end of the ring (at most UART_TERMINAL_CHUNK), a buffer of
+// Uart_SendTerminal when the text before it has been sent, or a block of trace records when there is nothing else.
+// Call with the DMA interrupt masked and nothing queued.
+static void Uart_TerminalStartNext(void)
+{
+  Buffer_t *Ring = &TerminalPort.Tx;
+  Uart_TxDesc *Waiting = Uart_TerminalWaitHead;
+  uint16_t Tail = Ring->Tail;
+  uint16_t End = (Waiting != NULL) ? Waiting->RingMark : Ring->Indx;
+  uint16_t Count = (End >= Tail) ? (End - Tail) : (Ring->Size - Tail);
+#ifdef TRACE
+  const uint8_t *Records;
+#endif
+
+  if (Count != 0)
+  {
+    Uart_TerminalText.Data = &Ring->Buffer[Tail];
+    Uart_TerminalText.Length = Util_Min(Count, UART_TERMINAL_CHUNK);
+    Uart_TerminalSending = &Uart_TerminalText;
+  }
+  else if (Waiting != NULL)
+  {
+    Uart_TerminalWaitHead = Waiting->Next;
+    Uart_TerminalSending = Waiting;
+  }
+#ifdef TRACE
+  else if ((Count = Trace_NextBlock(&Records)) != 0)
+  {
+    Uart_TerminalTrace.Data = Records;
+    Uart_TerminalTrace.Length = Count;
+    Uart_TerminalSending = &Uart_TerminalTrace;
+  }
+#endif
+  else
+  {
+    Uart_TerminalIdleCycles = DWT->CYCCNT;
+    return;
+  }
+  Uart_TerminalBytesSent += Uart_TerminalSending->Length;
+  Uart_TxQueue(&TerminalPort, Uart_TerminalSending);
+}
+
+// OnSent of the text: release the chunk
+static void Uart_TerminalTextSent(Uart_TxDesc *Desc)
+{
+  Buffer_t *Ring = &TerminalPort.Tx;
+
+  Ring->Tail = (Ring->Tail + Desc->Length) % Ring->Size;
+}
+
+#ifdef TRACE
+static void Uart_TerminalTraceSent(Uart_TxDesc *Desc)
+{
+  Trace_BlockSent();
+}
+#endif
+
+// Terminal Tx DMA transfer complete, after OnSent of the descriptor: chain the next one. The USART still shifts out
+// the last character, the next transfer waits for TXE.
+static void Uart_TerminalTxDone(UartPort *Port)
+{
+  if (Uart_TerminalSending != NULL)
+  {
+    Uart_TerminalSending = NULL;
+    Uart_TerminalStartNext();
+  }
+}
+
+bool Uart_WriteTerminal(const uint8_t *Data, uint16_t Length)
+{
+  static const char BufferFull[] = "\r\nBUFFER_FULL\r\n";
+  Buffer_t *Ring = &TerminalPort.Tx;
+  bool Written = FALSE;
+  uint32_t Lock;
+
+  if (Ring->Buffer == NULL)           // Before Uart_Init()
+  {
+    return FALSE;
+  }
+
+  Lock = Scheduler_Lock();            // Written from several rate groups, released by the DMA interrupt
+  if (Length + UART_TERMINAL_RESERVE <= Uart_RingFree(Ring))
+  {
+    Uart_RingWrite(Ring, Data, Length);
+    Uart_TerminalFull = FALSE;
+    Written = TRUE;
+  }
+  else if (!Uart_TerminalFull)        // Mark the first message lost, the reserve is kept for this
+  {
+    Uart_RingWrite(Ring, (const uint8_t *)BufferFull, sizeof(BufferFull) - 1U);
+    Uart_TerminalFull = TRUE;
+  }
+
+  if (Uart_TerminalSending == NULL)
+  {
+    Uart_TerminalStartNext();
+  }
+  Scheduler_Unlock(Lock);
+  return Written;
+}
+
+bool Uart_SendTerminal(Uart_TxDesc *Desc)
+{
+  uint32_t Lock;
+
+  if (TerminalPort.Tx.Buffer == NULL)  // Before Uart_Init()
+  {
+    return FALSE;
+  }
+  if (Desc->Length == 0)               // The DMA would never complete it
+  {
+    if (Desc->OnSent != NULL)
+    {
+      Desc->OnSent(Desc);
+    }
+    return TRUE;
+  }
+
+  Lock = Scheduler_Lock();
+  Desc->RingMark = TerminalPort.Tx.Indx;
+  Desc->Next = NULL;
+  if (Uart_TerminalWaitHead == NULL)
+  {
+    Uart_TerminalWaitHead = Desc;
+  }
+  else
+  {
+    Uart_TerminalWaitTail->Next = Desc;
+  }
+  Uart_TerminalWaitTail = Desc;
+
+  if (Uart_TerminalSending == NULL)
+  {
+    Uart_TerminalStartNext();
+  }
+  Scheduler_Unlock(Lock);
+  return TRUE;
+}
+
 void Uart_TransmitTerminalBuffer(void)
 {
-  if (Uart_TransmissionComplete(&TerminalPort))    // Check if (previous) Transmission is complete
+  uint32_t Lock = Scheduler_Lock();
+
+  if (Uart_TerminalSending == NULL)
   {
-    Uart_StartTransmitter(&TerminalPort, TerminalPort.Tx.Indx);
-    TerminalPort.Tx.Indx = 0;
+    Uart_TerminalStartNext();
   }
+  Scheduler_Unlock(Lock);
 }
 
 bool Uart_TerminalBufferEmpty(void)
 {
-  return TerminalPort.Tx.Indx == 0;
+  return TerminalPort.Tx.Indx == TerminalPort.Tx.Tail;
+}
+
+uint16_t Uart_TerminalFree(void)
+{
+  uint16_t Free;
+
+  if (TerminalPort.Tx.Buffer == NULL)  // Before Uart_Init()
+  {
+    return 0;
+  }
+  Free = Uart_RingFree(&TerminalPort.Tx);
+  return Free - Util_Min(Free, UART_TERMINAL_RESERVE);
 }
 
-void Uart_printf(const char *SourceFilename, int SourceLineno, const char *CFormatString, ...) 
+// Formatted on the stack, so the ring is locked only for the copy
+void Uart_printf(const char *SourceFilename, int SourceLineno, const char *CFormatString, ...)
 {
+  char Text[UART_PRINTF_MAX_LEN];
   va_list aptr;
-  Buffer_t *buff = &TerminalPort.Tx;
-  int16_t endIndx = buff->Size - 16;
+  int Length;
 
   va_start(aptr, CFormatString);
-  if (buff->Indx < endIndx) {
-    //buff->Indx += snprintf(buff->Buffer + buff->Indx, (endIndx - buff->Indx), "%s, line: %d  ", SourceFilename, SourceLineno);
-    buff->Indx += vsnprintf(buff->Buffer + buff->Indx, (endIndx - buff->Indx), CFormatString, aptr);
-    if (buff->Indx >= endIndx)
-      buff->Indx += snprintf(buff->Buffer + buff->Indx, 16, "\r\nBUFFER_FULL\r\n");
-  }
+  //Length = snprintf(Text, sizeof(Text), "%s, line: %d  ", SourceFilename, SourceLineno);
+  Length = vsnprintf(Text, sizeof(Text), CFormatString, aptr);
   va_end(aptr);
 
-}
\ No newline at end of file
+  if (Length > 0)
+  {
+    (void)Uart_WriteTerminal((const uint8_t *)Text, Util_Min((uint16_t)Length, sizeof(Text) - 1U));
+  }
+}
+
+#ifdef UART_BENCHMARK
+
+// The Terminal is flooded with text at each baud rate, the throughput is the bytes transmitted from the first write
+// until the ring is empty again. It shows the gaps between the chained DMA transfers, ideally it is the line rate.
+#define UART_BENCH_TIME_MS        500     // Approximate duration of each measurement
+#define UART_BENCH_MIN_PERMILLE   950     // PASS if all baud rates reach 95 % of the line rate
+
+typedef enum {
+  UART_BENCH_START = 0,
+  UART_BENCH_WRITE,
+  UART_BENCH_DRAIN,
+  UART_BENCH_DONE,
+} Uart_BenchState;
+
+static const uint32_t Uart_BenchBaudRates[] = { 115200, 230400, 460800, 921600, 1843200 };
+#define UART_BENCH_NUM_RATES  (sizeof(Uart_BenchBaudRates) / sizeof(Uart_BenchBaudRates[0]))
+
+static Uart_BenchState Uart_BenchPhase = UART_BENCH_START;
+static uint8_t Uart_BenchIndx = 0;        // Baud rate measured
+static uint32_t Uart_BenchBaudRate;       // Of the application, restored when done
+static uint32_t Uart_BenchLines;          // Left to write
+static uint32_t Uart_BenchStartCycles;
+static uint32_t Uart_BenchStartBytes;
+static uint32_t Uart_BenchBytesPerSec[UART_BENCH_NUM_RATES];
+static uint16_t Uart_BenchPermille[UART_BENCH_NUM_RATES];
+
+
+// Nothing in the ring or the DMA, and the last character is on the line
+static bool Uart_BenchIdle(void)
+{
+  return (Uart_TerminalSending == NULL) && Uart_TerminalBufferEmpty() && Uart_TransmissionComplete(&TerminalPort);
+}
+
+static void Uart_BenchPrint(void)
+{
+  bool Pass = TRUE;
+  uint16_t Indx;
+
+  UART_PRINTF("\r\nUart benchmark, Terminal throughput with continuous output:\r\n");
+  for (Indx = 0; Indx < UART_BENCH_NUM_RATES; Indx++)
+  {
+    UART_PRINTF("%8lu baud: %7lu bytes/s, %3u.%u %% of line rate\r\n", Uart_BenchBaudRates[Indx],
+                Uart_BenchBytesPerSec[Indx], Uart_BenchPermille[Indx] / 10U, Uart_BenchPermille[Indx] % 10U);
+    Pass = Pass && (Uart_BenchPermille[Indx] >= UART_BENCH_MIN_PERMILLE);
+  }
+  UART_PRINTF("Uart benchmark: %s\r\n", Pass ? "PASS" : "FAIL");
+}
+
+// Refills the ring often enough to never let it run empty: half of it lasts 22 ms at the highest baud rate
+void Uart_Benchmark_4ms(void)
+{
+  static const char Line[] = "UartBench 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz\r\n";
+  uint32_t Lock, Cycles, Bytes, LineRate;
+
+  switch (Uart_BenchPhase)
+  {
+  case UART_BENCH_START:
+    if (!Uart_BenchIdle())
+    {
+      break;
+    }
+    if (Uart_BenchIndx == 0)
+    {
+      Uart_BenchBaudRate = Uart_GetBaudRate(&TerminalPort);
+    }
+    else if (Uart_BenchIndx >= UART_BENCH_NUM_RATES)
+    {
+      Uart_SetBaudRate(&TerminalPort, Uart_BenchBaudRate);
+      Uart_BenchPrint();
+      Uart_BenchPhase = UART_BENCH_DONE;
+      break;
+    }
+    Uart_SetBaudRate(&TerminalPort, Uart_BenchBaudRates[Uart_BenchIndx]);
+    Uart_BenchLines = (Uart_BenchBaudRates[Uart_BenchIndx] / 10U) * UART_BENCH_TIME_MS / 1000U / (sizeof(Line) - 1U);
+
+    Lock = Scheduler_Lock();
+    Uart_BenchStartCycles = DWT->CYCCNT;
+    Uart_BenchStartBytes = Uart_TerminalBytesSent;
+    Scheduler_Unlock(Lock);
+    Uart_BenchPhase = UART_BENCH_WRITE;
+    // Fall through, start at once
+
+  case UART_BENCH_WRITE:
+    // Half of the ring is left to the other output
+    while ((Uart_BenchLines > 0) && (Uart_RingFree(&TerminalPort.Tx) > TerminalPort.Tx.Size / 2U))
+    {
+      (void)Uart_WriteTerminal((const uint8_t *)Line, sizeof(Line) - 1U);
+      Uart_BenchLines--;
+    }
+    if (Uart_BenchLines == 0)
+    {
+      Uart_BenchPhase = UART_BENCH_DRAIN;
+    }
+    break;
+
+  case UART_BENCH_DRAIN:
+    if (!Uart_BenchIdle())
+    {
+      break;
+    }
+    Cycles = Uart_TerminalIdleCycles - Uart_BenchStartCycles;
+    Bytes = Uart_TerminalBytesSent - Uart_BenchStartBytes;
+    LineRate = Uart_GetBaudRate(&TerminalPort) / 10U;     // 8N1: 10 bits per byte
+    Uart_BenchBytesPerSec[Uart_BenchIndx] = (uint32_t)(((uint64_t)Bytes * SystemCoreClock) / Util_Max(Cycles, 1U));
+    Uart_BenchPermille[Uart_BenchIndx] = (uint16_t)Util_Min((Uart_BenchBytesPerSec[Uart_BenchIndx] * 1000ULL) / LineRate, 0xFFFFU);
+    Uart_BenchIndx++;
+    Uart_BenchPhase = UART_BENCH_START;
+    break;
+
+  default:
+    break;
+  }
+}
+
+#endif
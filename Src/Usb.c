@@ -10,9 +10,14 @@
 #include "ErrorHandler.h"
 #include "Usb.h"
 #include "Uart.h"
+#include "Log.h"
+#include "BgJob.h"
+#include "Util.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#define USB_CONNECT_TIME_MAX  250     // [ms] Max time per 500 ms to run the host state machine while a device is connecting
+#define USB_WRITE_CHUNK       512     // [bytes] Written to the file per background step
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 FATFS USBDISKFatFs;          /* File system object for USB disk logical drive */
@@ -28,14 +33,27 @@ typedef enum {
 
 MSC_ApplicationTypeDef AppliState = APPLICATION_IDLE;
 
+// Steps of the background job
+typedef enum {
+  USB_JOB_PROCESS = 0,      // Run the host state machine
+  USB_JOB_OPEN,
+  USB_JOB_WRITE,
+  USB_JOB_CLOSE,
+} Usb_JobStateTypeDef;
+
 /* Private function prototypes -----------------------------------------------*/ 
 static void USBH_UserProcess(USBH_HandleTypeDef *phost, uint8_t id);
-static void MSC_Application(void);
+static uint8_t Usb_JobStep(BgJob *Job);
+static uint8_t MSC_Application(BgJob *Job);
+
+static BgJob Usb_Job = BGJOB("Usb", Usb_JobStep, NULL, NULL);
+static uint32_t Usb_JobStartTick = 0;
 
 /* Private functions ---------------------------------------------------------*/
 char *wtext = "This is STM32 working with FatFs\n/* Register the file system object to the FatFs module */\n/* Create and Open a new text file object with write access */\n/* Write data to the text file */\n";
 char buffer[4096];
 uint32_t bufferIndx = 0;
+static uint32_t writeIndx = 0;
 
 /**
   * @brief  Main program
@@ -56,104 +74,112 @@ void Usb_Init(void)
     /*##-4- Start Host Process ###############################################*/
     USBH_Start(&hUSBHost);
 
-    UART_PRINTF("Usb Host started, ms: %d\r\n", HAL_GetTick());
+    LOG("Usb Host started, ms: %d\r\n", HAL_GetTick());
   } 
 }
 
 /*##-5- Run Application (Blocking mode) ##################################*/
+// The USB host and the file system are only used from the background job, i.e. in the idle time of the main loop,
+// so the 500 ms loop is not delayed by the USB stick.
 void Usb_500ms(void)
 {
-  uint32_t startTic = HAL_GetTick();
-
-  /* USB Host Background task. When connecting USB device, need to run state machine in while loop to speed up, but yield after 250ms */
-  do {
-    USBH_Process(&hUSBHost);
-  } while (AppliState == APPLICATION_CONNECTING && HAL_GetTick() - startTic < 250);
+  if (!BgJob_Active(&Usb_Job))
+  {
+    Usb_JobStartTick = HAL_GetTick();
+    (void)BgJob_Start(&Usb_Job);
+  }
 
   HAL_GPIO_WritePin(GPIOB, GPIO_PIN_0, GPIO_PIN_SET);
-  
-  /* Mass Storage Application State Machine */
-  switch (AppliState)
-  {
-  case APPLICATION_RUNNING:
-    MSC_Application();
-    break;
+}
 
-  case APPLICATION_IDLE:
-  default:
-    break;
+static uint8_t Usb_JobStep(BgJob *Job)
+{
+  if (Job->State == USB_JOB_PROCESS)
+  {
+    /* USB Host Background task. When connecting USB device, need to run state machine repeatedly to speed up, but yield after 250ms */
+    USBH_Process(&hUSBHost);
+    if ((AppliState == APPLICATION_CONNECTING) && (HAL_GetTick() - Usb_JobStartTick < USB_CONNECT_TIME_MAX))
+    {
+      return 0;
+    }
+    if (AppliState != APPLICATION_RUNNING)
+    {
+      return BGJOB_DONE;
+    }
   }
+
+  /* Mass Storage Application State Machine */
+  return MSC_Application(Job);
 }
 
 /**
-  * @brief  Main routine for Mass Storage Class
-  * @param  None
-  * @retval None
+  * @brief  Main routine for Mass Storage Class, one step per call
+  * @param  Job: Background job, State tells the step
+  * @retval Progress [%]
   */
-static void MSC_Application(void)
+static uint8_t MSC_Application(BgJob *Job)
 {
   FRESULT res;                                          /* FatFs function common result code */
-  uint32_t byteswritten, bytesread;                     /* File write/read counts */
-
-  strcpy(&buffer[bufferIndx], wtext);
-  bufferIndx += strlen(wtext);
-  
-  if (bufferIndx < 3600)
-    return;
+  uint32_t byteswritten;                                /* File write count */
+  uint32_t bytestowrite;
 
-  /* Register the file system object to the FatFs module */
-  if(f_mount(&USBDISKFatFs, (TCHAR const*)USBDISKPath, 0) != FR_OK)
+  switch (Job->State)
   {
-    /* FatFs Initialization Error */
-    Error_Handler();
-  }
-  else
-  { 
+  case USB_JOB_PROCESS:
+    strcpy(&buffer[bufferIndx], wtext);
+    bufferIndx += strlen(wtext);
+
+    if (bufferIndx < 3600)
+      return BGJOB_DONE;
+
+    Job->State = USB_JOB_OPEN;
+    return 10;
+
+  case USB_JOB_OPEN:
+    /* Register the file system object to the FatFs module */
+    if(f_mount(&USBDISKFatFs, (TCHAR const*)USBDISKPath, 0) != FR_OK)
+    {
+      /* FatFs Initialization Error */
+      Error_Handler();
+    }
     /* Create and Open a new text file object with write access */
     if(f_open(&MyFile, "STM32.TXT", FA_OPEN_ALWAYS | FA_WRITE) != FR_OK)
     {
       /* 'STM32.TXT' file Open for write Error */
       Error_Handler();
     }
-    else
-    {
-      /* Move to end of the file to append data */
-      res = f_lseek(&MyFile, f_size(&MyFile));
+    /* Move to end of the file to append data */
+    res = f_lseek(&MyFile, f_size(&MyFile));
 
-      /* Write data to the text file */
-      res = f_write(&MyFile, buffer, bufferIndx, (void *)&byteswritten);
-      bufferIndx = 0;
+    writeIndx = 0;
+    Job->State = USB_JOB_WRITE;
+    return 20;
 
-      if((byteswritten == 0) || (res != FR_OK))
-      {
-        /* 'STM32.TXT' file Write or EOF Error */
-        Error_Handler();
-      }
-      else
-      {
-        /* Close the open text file */
-        f_close(&MyFile);
-        HAL_GPIO_TogglePin(GPIOB, GPIO_PIN_7);
-
-        /* Open the text file object with read access */
-        //if(f_open(&MyFile, "STM32.TXT", FA_READ) != FR_OK)
-        //{
-        //  /* 'STM32.TXT' file Open for read Error */
-        //  Error_Handler();
-        //}
-        //else
-        //{
-        //  /* Read data from the text file */
-        //  res = f_read(&MyFile, rtext, sizeof(rtext), (void *)&bytesread);
-        //  
-        //  /* Close the open text file */
-        //  f_close(&MyFile);
-      }
+  case USB_JOB_WRITE:
+    /* Write data to the text file, a chunk at a time */
+    bytestowrite = Util_Min(bufferIndx - writeIndx, USB_WRITE_CHUNK);
+    res = f_write(&MyFile, &buffer[writeIndx], bytestowrite, (void *)&byteswritten);
+
+    if((byteswritten == 0) || (res != FR_OK))
+    {
+      /* 'STM32.TXT' file Write or EOF Error */
+      Error_Handler();
     }
+    writeIndx += byteswritten;
+    if (writeIndx >= bufferIndx)
+    {
+      bufferIndx = 0;
+      Job->State = USB_JOB_CLOSE;
+    }
+    return 20 + (70 * writeIndx) / 3600;
+
+  case USB_JOB_CLOSE:
+  default:
+    /* Close the open text file */
+    f_close(&MyFile);
+    HAL_GPIO_TogglePin(GPIOB, GPIO_PIN_7);
+    return BGJOB_DONE;
   }
-  
-  /* Unlink the USB disk I/O driver */
-  //FATFS_UnLinkDriver(USBDISKPath);
 }
 
 /**
@@ -168,7 +194,7 @@ static void USBH_UserProcess(USBH_HandleTypeDef *phost, uint8_t id)
   { 
   case HOST_USER_CONNECTION:
     AppliState = APPLICATION_CONNECTING;
-    UART_PRINTF("Usb HOST_USER_CONNECTION, ms: %d\r\n", HAL_GetTick());
+    LOG("Usb HOST_USER_CONNECTION, ms: %d\r\n", HAL_GetTick());
     break;
 
   case HOST_USER_SELECT_CONFIGURATION:
@@ -182,14 +208,14 @@ static void USBH_UserProcess(USBH_HandleTypeDef *phost, uint8_t id)
     f_mount(NULL, (TCHAR const*)"", 0);
     
     if (id == HOST_USER_DISCONNECTION)
-      UART_PRINTF("Usb HOST_USER_DISCONNECTION, ms: %d\r\n", HAL_GetTick());
+      LOG("Usb HOST_USER_DISCONNECTION, ms: %d\r\n", HAL_GetTick());
     else
-      UART_PRINTF("Usb HOST_USER_UNRECOVERED_ERROR, ms: %d\r\n", HAL_GetTick());
+      LOG("Usb HOST_USER_UNRECOVERED_ERROR, ms: %d\r\n", HAL_GetTick());
     break;
     
   case HOST_USER_CLASS_ACTIVE:
     AppliState = APPLICATION_RUNNING;
-    UART_PRINTF("Usb HOST_USER_CLASS_ACTIVE, ms: %d\r\n", HAL_GetTick());
+    LOG("Usb HOST_USER_CLASS_ACTIVE, ms: %d\r\n", HAL_GetTick());
     break;
     
   default:
@@ -10,6 +10,7 @@
 */
 
 #include "Util.h"
+#include "TicToc.h"
 #include <stdlib.h>
 
 #define MULTIPLIER  (4096)
@@ -37,6 +38,8 @@ int32_t Util_Interpolate(int32_t x, const int16_t Xaxis[], const int16_t Yaxis[]
   uint32_t Idx;
   uint32_t i_xMax = maxIndex;
   uint32_t i_xMin = 0;
+  int32_t Result;
+  TIC(TICTOC_UTIL_INTERPOLATE);
 
   if (Xaxis[0] > Xaxis[maxIndex]) { // If Xaxis values are decreasing
     i_xMax = 0;
@@ -62,7 +65,10 @@ int32_t Util_Interpolate(int32_t x, const int16_t Xaxis[], const int16_t Yaxis[]
 
   frac = MULTIPLIER*(x - Xaxis[i_xMin]) / (Xaxis[i_xMax] - Xaxis[i_xMin]);  // Fixed point calculation
 
-  return ((MULTIPLIER - frac)*Yaxis[i_xMin] + frac*Yaxis[i_xMax]) / MULTIPLIER;
+  Result = ((MULTIPLIER - frac)*Yaxis[i_xMin] + frac*Yaxis[i_xMax]) / MULTIPLIER;
+
+  TOC(TICTOC_UTIL_INTERPOLATE);
+  return Result;
 }
 
 int32_t Util_Interpolate2D(int32_t x, int32_t y, const int16_t Xaxis[], const int16_t Yaxis[], int16_t map[], uint32_t xArrayLen, uint32_t yArrayLen)
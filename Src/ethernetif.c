@@ -49,6 +49,7 @@
 #include "ethernetif.h"
 #include <string.h>
 #include "Uart.h"
+#include "Log.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -282,11 +283,7 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
     bufferoffset = bufferoffset + byteslefttocopy;
     framelength = framelength + byteslefttocopy;
 
-    UART_PRINTF("In ethernetif low_level_output, len %d\r\n", framelength);
-    for (int16_t i = 0; i < framelength; i++) {
-      UART_PRINTF("0x%02X ", buffer[i]);
-    }
-    UART_PRINTF("\r\n");
+    LOG("Eth output: len %u, type 0x%04X, to ..:%02X:%02X\r\n", framelength, (buffer[12] << 8) | buffer[13], buffer[4], buffer[5]);
   }
   
   /* Prepare transmit descriptors to give to DMA */ 
@@ -310,7 +307,8 @@ error:
 
 /**
   * @brief Should allocate a pbuf and transfer the bytes of the incoming
-  * packet from the interface into the pbuf.
+  * packet from the interface into the pbuf. Call when HAL_ETH_GetReceivedFrame()
+  * has found a frame, its descriptors are given back to the DMA.
   *
   * @param netif the lwip network interface structure for this ethernetif
   * @return a pbuf filled with the received packet (including MAC header)
@@ -328,9 +326,6 @@ static struct pbuf * low_level_input(struct netif *netif)
   uint32_t byteslefttocopy = 0;
   uint32_t i=0;
   
-  if (HAL_ETH_GetReceivedFrame(&EthHandle) != HAL_OK)
-    return NULL;
-  
   /* Obtain the size of the packet and put it into the "len" variable. */
   len = EthHandle.RxFrameInfos.length;
   buffer = (uint8_t *)EthHandle.RxFrameInfos.buffer;
@@ -340,11 +335,7 @@ static struct pbuf * low_level_input(struct netif *netif)
     /* We allocate a pbuf chain of pbufs from the Lwip buffer pool */
     p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
 
-    UART_PRINTF("In ethernetif low_level_input, len %d\r\n", len);
-    for (int16_t i = 0; i < len; i++) {
-      UART_PRINTF("0x%02X ", buffer[i]);
-    }
-    UART_PRINTF("\r\n");
+    LOG("Eth input: len %u, type 0x%04X, from ..:%02X:%02X\r\n", len, (buffer[12] << 8) | buffer[13], buffer[10], buffer[11]);
   }
   
   if (p != NULL)
@@ -410,17 +401,22 @@ static struct pbuf * low_level_input(struct netif *netif)
   * the appropriate input function is called.
   *
   * @param netif the lwip network interface structure for this ethernetif
+  * @return 1 if a frame was taken from the Rx descriptors (also if it was
+  *         dropped for lack of pbufs), 0 if there was none
   */
-void ethernetif_input(struct netif *netif)
+u8_t ethernetif_input(struct netif *netif)
 {
   err_t err;
   struct pbuf *p;
   
+  if (HAL_ETH_GetReceivedFrame(&EthHandle) != HAL_OK)
+    return 0;
+
   /* move received packet into a new pbuf */
   p = low_level_input(netif);
     
-  /* no packet could be read, silently ignore this */
-  if (p == NULL) return;
+  /* no pbuf for the packet, it is dropped */
+  if (p == NULL) return 1;
     
   /* entry point to the LwIP stack */
   err = netif->input(p, netif);
@@ -431,6 +427,7 @@ void ethernetif_input(struct netif *netif)
     pbuf_free(p);
     p = NULL;
   }
+  return 1;
 }
 
 /**
@@ -20,19 +20,32 @@
 #include "Uart.h"
 #include "InputCapture.h"
 #include "TicToc.h"
+#include "IrqMon.h"
+#include "MemMon.h"
+#include "Log.h"
+#include "Trace.h"
 #include "NeoPixel.h"
 #include "MotorDriver.h"
 #include "SpeedSensor.h"
 #include "RadioReceive.h"
 #include "FlashE2p.h"
 #include "Modbus.h"
+#include "ExportedSignals.h"
+#include "Shell.h"
 #include "Rtc.h"
 #include "Usb.h"
 #include "Network.h"
+#include "Scheduler.h"
+#include "EventQueue.h"
+#include "BgJob.h"
+#include "Boot.h"
 
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#ifndef TICK_IN_SYSTICK      // Define to execute the 1 ms work directly in SysTick, e.g. to compare ISR times (TICTOC_SYSTICK_ISR and TICTOC_PENDSV_ISR)
+#define TICK_BOTTOM_HALF
+#endif
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 
@@ -46,47 +59,102 @@ static void SystemClock_Config(void);
 
 extern __IO uint32_t uwTick;
 
-static volatile uint32_t LoopCnt = 0;
-static volatile bool Pending4ms = FALSE;
-static volatile bool Pending20ms = FALSE;
-static volatile bool Pending100ms = FALSE;
-static volatile bool Pending500ms = FALSE;
 static volatile bool InitDone = FALSE;
 
 static void Loop1ms(void);
+static void Loop4ms(void);
+static void Loop20ms(void);
+static void Loop100ms(void);
+static void Loop500ms(void);
+static void LoopNetwork(void);
+
+// Rate groups, each executed preemptively in its own software interrupt with rate monotonic priority, i.e. the fastest
+// rate group has the highest priority. Data shared between rate groups shall be protected, see Scheduler_Lock() and Scheduler_Mailbox.
+// The offsets make sure that no two rate groups are released on the same tick: 4 ms runs on ticks 0, 4, 8..
+// and since the other periods are multiples of 4, offsets 1, 2 and 3 can never coincide with it or with each other.
+// The exception is Network, which polls lwIP every 4 ms at the lowest priority, in the time left by the control rate
+// groups. It shares offset 3 with Loop500ms, i.e. it waits for Loop500ms every 500 ms.
+static Scheduler_Task Main_Tasks[] =
+{
+  //                 Name           Function     Period [ms]  Offset [ms]  Budget [us]  Software IRQ    Priority
+  SCHEDULER_IRQ_TASK("Loop4ms",     Loop4ms,     4,           0,           1000,        CAN1_TX_IRQn,   10),
+  SCHEDULER_IRQ_TASK("Loop20ms",    Loop20ms,    20,          1,           4000,        CAN1_RX0_IRQn,  11),
+  SCHEDULER_IRQ_TASK("Loop100ms",   Loop100ms,   100,         2,           10000,       CAN1_RX1_IRQn,  12),
+  SCHEDULER_IRQ_TASK("Loop500ms",   Loop500ms,   500,         3,           50000,       CAN1_SCE_IRQn,  13),
+  SCHEDULER_IRQ_TASK("Network",     LoopNetwork, 4,           3,           2000,        CAN2_TX_IRQn,   14),
+};
 
 // Called from SysTick_Handler, i.e. Timer Interrupt (1 ms). Redefinition of HAL_IncTick in stm32f4xx_hal.c
+// This is the top half, it only updates the HAL time base so SysTick is short and HAL timeouts are not delayed.
+// The 1 ms work is deferred to the bottom half in PendSV, which executes directly after, unless a higher prio IRQ is active.
 void HAL_IncTick(void)  
 {
   uwTick++;
   
   if (InitDone)
   {
-    LoopCnt++;
-    Loop1ms();              // The 1 ms loop executes in the interrupt, but the slower loops run in the main loop.
+#ifdef TICK_BOTTOM_HALF
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+#else
+    Main_TickBottomHalf();
+#endif
   }
+}
 
-  if (!(LoopCnt % 4))
+// Called from PendSV_Handler, prio 9, i.e. below SysTick and the time critical IRQs but above all rate groups.
+void Main_TickBottomHalf(void)
+{
+  Loop1ms();
+  Scheduler_Tick();         // Release the rate groups that are due
+}
+
+// Work for the main loop, checked before it goes to sleep
+static bool Main_WorkPending(void)
+{
+  return EventQueue_Pending() || BgJob_Pending();
+}
+
+// The statistics printout is too long for the 500 ms loop, it is printed in the background, one part per step.
+static uint8_t Main_PrintStatsStep(BgJob *Job)
+{
+  switch (Job->State++)
   {
-    Pending4ms = TRUE;
-    if (!(LoopCnt % 20))
-    {
-      Pending20ms = TRUE;
-      if (!(LoopCnt % 100))
-      {
-        Pending100ms = TRUE;
-        if (LoopCnt >= 500)
-        {
-          Pending500ms = TRUE;
-          LoopCnt = 0;
-        }
-      }
-    }
+  case 0:
+    Scheduler_PrintStats();
+    return 20;
+  case 1:
+    EventQueue_PrintStats();
+    return 40;
+  case 2:
+    BgJob_PrintStats();
+    return 60;
+  case 3:
+#ifdef IRQ_MON
+    IrqMon_PrintStats();
+#endif
+    return 80;
+  case 4:
+#ifdef MEM_MON
+    MemMon_PrintStats();
+#endif
+    return 85;
+  case 5:
+#ifdef TRACE
+    Trace_PrintNames();   // Again, for a trace capture started after boot
+#endif
+    return 90;
+  default:
+#ifdef TIC_TOC
+    TicToc_PrintStats();
+#endif
+    return BGJOB_DONE;
   }
 }
 
+static BgJob Main_PrintStatsJob = BGJOB("PrintStats", Main_PrintStatsStep, NULL, NULL);
+
 //----------------------------------------
-static void Main_Init(void)
+static void Main_GpioInit(void)
 {
   /* -1- Enable GPIO Clock (to be able to program the configuration registers) */
   __HAL_RCC_GPIOB_CLK_ENABLE();
@@ -98,26 +166,38 @@ static void Main_Init(void)
 
   GPIO_InitStruct.Pin = GPIO_PIN_0 | GPIO_PIN_7 | GPIO_PIN_14;
   HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
-
-  Uart_Init();
-  UART_PRINTF("\r\nUart_Init()\r\n");
-  
-  FlashE2p_Init();
-  RTC_Init();
-
-  InputCapture_Init();
-  Pwm_Init();
-  RadioTransmit_Init();
-  Adc_Init();
-  NeoPixel_Init();
-
-  SpeedSensor_Init();
-  MotorDriver_Init();
-  
-  Usb_Init();
-  Network_Init();
 }
 
+// Boot sequence. The Sync phases are executed in table order before the rate groups start, put only what the control
+// path needs there. Deferred phases are executed in the background after the rate groups have started, thus the modules
+// they initialize must be guarded with Boot_Ready() in the rate groups.
+// FlashE2p is Sync since the parameters are needed by the control path, and an erase of the sector stalls all Flash fetches.
+static Boot_Phase Main_BootPhases[] =
+{
+  //         Name            Init function       Mode
+#ifdef TIC_TOC
+  BOOT_PHASE("TicToc",       TicToc_Init,        BOOT_SYNC),
+#endif
+  BOOT_PHASE("Gpio",         Main_GpioInit,      BOOT_SYNC),
+  BOOT_PHASE("Uart",         Uart_Init,          BOOT_SYNC),
+  BOOT_PHASE("Shell",        Shell_Init,         BOOT_SYNC),
+  BOOT_PHASE("FlashE2p",     FlashE2p_Init,      BOOT_SYNC),
+  BOOT_PHASE("Modbus",       Modbus_Init,        BOOT_SYNC),   // After FlashE2p, the baud rate is a parameter
+  BOOT_PHASE("InputCapture", InputCapture_Init,  BOOT_SYNC),
+  BOOT_PHASE("Pwm",          Pwm_Init,           BOOT_SYNC),
+  BOOT_PHASE("Adc",          Adc_Init,           BOOT_SYNC),
+  BOOT_PHASE("SpeedSensor",  SpeedSensor_Init,   BOOT_SYNC),
+  BOOT_PHASE("MotorDriver",  MotorDriver_Init,   BOOT_SYNC),
+  BOOT_PHASE("RadioTransmit",RadioTransmit_Init, BOOT_SYNC),
+  BOOT_PHASE("NeoPixel",     NeoPixel_Init,      BOOT_SYNC),
+#ifdef IRQ_MON
+  BOOT_PHASE("IrqMon",       IrqMon_Init,        BOOT_SYNC),   // After the timers it monitors
+#endif
+  BOOT_PHASE("Rtc",          RTC_Init,           BOOT_DEFERRED),   // Waits for the LSE oscillator
+  BOOT_PHASE("Usb",          Usb_Init,           BOOT_DEFERRED),
+  BOOT_PHASE("Network",      Network_Init,       BOOT_DEFERRED),   // Waits for the Ethernet PHY
+};
+
 static void Main_PrintToTerminal(void)
 {
 	static int16_t indx = 0;
@@ -132,17 +212,25 @@ static void Main_PrintToTerminal(void)
 
   case 1:
     Uart_PrintRegisters();
-    RTC_CalendarShow(&timeBuff, &dateBuff);
-    UART_PRINTF("RTC: %s %s\r\n", dateBuff, timeBuff);
+    if (Boot_Ready(RTC_Init))
+    {
+      RTC_CalendarShow(&timeBuff, &dateBuff);
+      UART_PRINTF("RTC: %s %s\r\n", dateBuff, timeBuff);
+    }
     indx++;
     break;
 
   default:
+    if (++indx >= 22)         // Every 10 s
+    {
+      (void)BgJob_Start(&Main_PrintStatsJob);   // Transmitted by the next 500 ms loop
+      indx = 2;
+    }
     break;
   }
 
   if (!Uart_TerminalBufferEmpty()) {
-    UART_PRINTF("Time %.1f\r\n", HAL_GetTick() / 1000.0);
+    LOG("Time %.1f\r\n", HAL_GetTick() / 1000.0);
     Uart_TransmitTerminalBuffer();    // Start transmission to Terminal
   }
 }
@@ -159,6 +247,13 @@ static void Loop4ms(void)
   SpeedSensor_4ms();
 
   Modbus_4ms();
+
+#ifdef TRACE
+  Uart_TransmitTerminalBuffer();      // Trace records do not start the Terminal when added
+#endif
+#ifdef UART_BENCHMARK
+  Uart_Benchmark_4ms();
+#endif
 }
 
 static void Loop20ms(void)
@@ -175,9 +270,7 @@ static void Loop20ms(void)
 
   Uart_20ms();
 
-#ifdef TIC_TOC
-  TicToc_20ms();
-#endif
+  ExportedSignals_20ms();
 }
 
 static void Loop100ms(void)
@@ -187,10 +280,6 @@ static void Loop100ms(void)
   RadioTransmit_100ms();
 
   NeoPixel_100ms();
-
-  RadioReceieve_100ms();
-
-  Network_1ms();
 }
 
 static void Loop500ms(void)
@@ -203,11 +292,26 @@ static void Loop500ms(void)
 
   FlashE2p_500ms();
 
-  Usb_500ms();
+#ifdef MEM_MON
+  MemMon_500ms();
+#endif
+
+  if (Boot_Ready(Usb_Init))
+  {
+    Usb_500ms();
+  }
 
   Main_PrintToTerminal();
 }
 
+static void LoopNetwork(void)
+{
+  if (Boot_Ready(Network_Init))
+  {
+    Network_4ms();
+  }
+}
+
 /**
   * @brief  Main program.
   * @param  None
@@ -230,35 +334,28 @@ int main(void)
   /* Configure the system clock to 180 MHz */
   SystemClock_Config();
   
-  Main_Init();
+  Boot_RunSync(Main_BootPhases, sizeof(Main_BootPhases) / sizeof(Main_BootPhases[0]));
 
-  UART_PRINTF("Init Done. Tick: %d\r\n", HAL_GetTick());
+  UART_PRINTF("\r\nControl path up. Tick: %d\r\n", HAL_GetTick());
   Uart_TransmitTerminalBuffer();    // Should be executed immediately after initialization    
   
+  HAL_NVIC_SetPriority(PendSV_IRQn, 9U, 0U);   // SysTick bottom half, see HAL_IncTick()
+  Scheduler_Init(Main_Tasks, sizeof(Main_Tasks) / sizeof(Main_Tasks[0]));
+#ifdef TRACE
+  Trace_PrintNames();
+#endif
+
   // Init functions finished
   InitDone = TRUE;
+  Boot_StartDeferred();
 
   while (1)
   {
-    if (Pending4ms)
-    {		  
-      Loop4ms();
-      Pending4ms = FALSE;
-    }
-    if (Pending20ms)
-    {
-	    Loop20ms();
-	    Pending20ms = FALSE;
-    }
-    if (Pending100ms)
-    {
-	    Loop100ms();
-	    Pending100ms = FALSE;
-    }
-    if (Pending500ms)
+    // Events posted by interrupts, then rate groups not bound to a software interrupt, if any, then background jobs,
+    // then the deferred log messages. A message logged just before the sleep is expanded after the next interrupt.
+    if (!EventQueue_DispatchNext() && !Scheduler_Run() && !BgJob_Run() && !Log_Flush())
     {
-      Loop500ms();
-	    Pending500ms = FALSE;
+      Scheduler_Idle(Main_WorkPending);                   // Sleep until next interrupt
     }
   }
 }
@@ -38,9 +38,11 @@
   */
 
 /* Includes ------------------------------------------------------------------*/
+#include "main.h"
 #include "stm32f4xx_it.h"
 #include "RadioTransmit.h"
 #include "TicToc.h"
+#include "IrqMon.h"
 #include "NeoPixel.h"
 #include "Uart.h"
 
@@ -143,6 +145,11 @@ void DebugMon_Handler(void)
   */
 void PendSV_Handler(void)
 {
+  TIC(TICTOC_PENDSV_ISR);
+
+  Main_TickBottomHalf();
+
+  TOC(TICTOC_PENDSV_ISR);
 }
 
 /**
@@ -152,7 +159,13 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
+  IRQMON_ENTER(IRQMON_SYSTICK, SysTick->LOAD - SysTick->VAL);
+  TIC(TICTOC_SYSTICK_ISR);
+
   HAL_IncTick();
+
+  TOC(TICTOC_SYSTICK_ISR);
+  IRQMON_EXIT(IRQMON_SYSTICK);
 }
 
 /******************************************************************************/
@@ -169,22 +182,22 @@ void SysTick_Handler(void)
   */
 void TIM8_UP_TIM13_IRQHandler(void)
 {
-#ifdef TIC_TOC
-  TicToc_Tim13IrqStart = Timer2Handle.Instance->CNT;
-#endif
+  IRQMON_ENTER(IRQMON_TIM13, Timer13Handle.Instance->CNT);   // Update event at CNT = 0
+  TIC(TICTOC_TIM13_ISR);
 
   HAL_TIM_IRQHandler(&Timer13Handle);
 
-#ifdef TIC_TOC
-  TicToc_Tim13IrqEnd = Timer2Handle.Instance->CNT;
-#endif
+  TOC(TICTOC_TIM13_ISR);
+  IRQMON_EXIT(IRQMON_TIM13);
 }
 
 void OTG_FS_IRQHandler(void)
 {
+  IRQMON_ENTER(IRQMON_OTG_FS, 0);
   //UART_PRINTF("OTG_FS_IRQ begin, Tick: %d\r\n", HAL_GetTick());
   HAL_HCD_IRQHandler(&hhcd);
   //UART_PRINTF("OTG_FS_IRQ end, Tick: %d\r\n", HAL_GetTick());
+  IRQMON_EXIT(IRQMON_OTG_FS);
 }
 
 // NOTE: TIM8_TRG_COM_TIM14_IRQHandler is in NeoPixel.c
@@ -193,4 +206,8 @@ void OTG_FS_IRQHandler(void)
 
 // TIM5_IRQHandler  // Handled in RadioReceive.c
 
+// USARTx_IRQHandler and the DMA stream handlers of the UART ports  // Handled in Uart.c, see UART_IRQ_HANDLERS
+
+// TIM7_IRQHandler  // Handled in Modbus.c, RTU frame timing
+
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/